@@ -0,0 +1,49 @@
+# EmbedShaders.cmake
+#
+# Turn the shader sources into a constexpr table compiled into the executables
+# Included from a CMakeLists.txt it defines embed_shaders(); run with cmake -P
+# it does the actual generation, so it is redone whenever a shader changes
+
+if(CMAKE_SCRIPT_MODE_FILE)
+	# Every stage and shared include, by the name Shader knows it by
+	file(GLOB SHADERS RELATIVE ${SOURCE_DIR}
+		${SOURCE_DIR}/vs/*.c ${SOURCE_DIR}/fs/*.c ${SOURCE_DIR}/common/*.c)
+	list(SORT SHADERS)
+
+	set(CONTENT "// EmbeddedShaders.h\n//\n// Generated by cmake/EmbedShaders.cmake, do not edit\n\n")
+	string(APPEND CONTENT "#ifndef EMBEDDED_SHADERS_H\n#define EMBEDDED_SHADERS_H\n\n#include <string_view>\n\n")
+	string(APPEND CONTENT "namespace EmbeddedShaders {\n\tstruct File\n\t{\n\t\tstd::string_view name;\n\t\tstd::string_view code;\n\t};\n\n")
+	string(APPEND CONTENT "\tinline constexpr File Files[] {\n")
+	foreach(SHADER ${SHADERS})
+		file(READ ${SOURCE_DIR}/${SHADER} CODE)
+		string(APPEND CONTENT "\t\t{ \"${SHADER}\", R\"glsl(${CODE})glsl\" },\n")
+	endforeach()
+	string(APPEND CONTENT "\t};\n} // namespace EmbeddedShaders\n\n#endif\n")
+
+	# Only touch the header when it changes, so unrelated edits rebuild nothing
+	file(WRITE ${OUTPUT}.tmp "${CONTENT}")
+	execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+	file(REMOVE ${OUTPUT}.tmp)
+	return()
+endif()
+
+# Generate EmbeddedShaders.h from the shaders in SOURCE_DIR, and make every
+# executable added afterwards depend on it
+function(embed_shaders SOURCE_DIR)
+	set(OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/generated)
+	set(OUTPUT ${OUTPUT_DIR}/EmbeddedShaders.h)
+	# (new shader files are picked up on the next configure)
+	file(GLOB SHADERS
+		${SOURCE_DIR}/vs/*.c ${SOURCE_DIR}/fs/*.c ${SOURCE_DIR}/common/*.c)
+	add_custom_command(
+		OUTPUT ${OUTPUT}
+		COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT_DIR}
+		COMMAND ${CMAKE_COMMAND} -DSOURCE_DIR=${SOURCE_DIR} -DOUTPUT=${OUTPUT}
+			-P ${CMAKE_SOURCE_DIR}/cmake/EmbedShaders.cmake
+		DEPENDS ${SHADERS} ${CMAKE_SOURCE_DIR}/cmake/EmbedShaders.cmake
+		COMMENT "Embedding shaders from ${SOURCE_DIR}")
+	add_custom_target(EmbeddedShaders DEPENDS ${OUTPUT})
+	set(EMBEDDED_SHADERS_TARGET EmbeddedShaders PARENT_SCOPE)
+	include_directories(${OUTPUT_DIR})
+	add_compile_definitions(EMBEDDED_SHADERS)
+endfunction()
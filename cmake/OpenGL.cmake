@@ -9,6 +9,9 @@ find_package(OpenGL REQUIRED)
 # GLFW3
 find_package(glfw3 REQUIRED)
 
+# Worker threads
+find_package(Threads REQUIRED)
+
 # Macro to add a simple executable
 macro(add_executable_cpp NAME)
 	set(BIN "${NAME}.bin")
@@ -17,7 +20,12 @@ macro(add_executable_cpp NAME)
 	add_executable(${BIN} ${CPP})
 	
 	# Be sure to link against OpenGL etc.
-	target_link_libraries(${BIN} ${OPENGL_LIBRARIES} glad glfw ${CMAKE_DL_LIBS})
+	target_link_libraries(${BIN} ${OPENGL_LIBRARIES} glad glfw Threads::Threads ${CMAKE_DL_LIBS})
+
+	# Shaders compiled in with embed_shaders() have to be generated first
+	if(EMBEDDED_SHADERS_TARGET)
+		add_dependencies(${BIN} ${EMBEDDED_SHADERS_TARGET})
+	endif()
 
 	# Also use the standard compiler flags
 	#target_compile_options(${BIN} PRIVATE ${CUSTOM_WARNING_LEVEL})
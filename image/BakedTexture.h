@@ -0,0 +1,294 @@
+// BakedTexture.h
+//
+// Header-only baked textures: images decoded, flipped, expanded and mipmapped
+// ahead of time (see TextureBaker.cpp), so loading one is an mmap, immutable
+// storage, and one glTexSubImage2D per level straight out of the mapping, with
+// no decoding or copies
+//
+// A baked file is a Header, one Level per mip level, then the pixels of each
+// level starting on a 16 byte boundary; rows are bottom first, and padded to
+// four bytes so they upload with the default GL_UNPACK_ALIGNMENT
+//
+// Baking uses stb_image; the including program provides the implementation
+
+#ifndef BAKED_TEXTURE_H
+#define BAKED_TEXTURE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glad/glad.h>
+
+#include "MipGenerator.h"
+#include "stb_image.h"
+#include "Texture.h"
+
+// Where the baked textures are kept, unless the build says otherwise
+#ifndef BAKED_TEXTURE_DIR
+#define BAKED_TEXTURE_DIR "baked_textures"
+#endif
+
+class BakedTexture
+{
+public:
+	// "BTEX", bumped when the layout changes
+	static constexpr std::uint32_t Magic { 0x58455442 };
+	static constexpr std::uint32_t Version { 1 };
+
+	// Header flags
+	static constexpr std::uint32_t Srgb { 1 };
+
+	struct Header
+	{
+		std::uint32_t magic { Magic };
+		std::uint32_t version { Version };
+		std::uint32_t width { 0 };
+		std::uint32_t height { 0 };
+		std::uint32_t channels { 0 };   // 3 or 4
+		std::uint32_t levels { 0 };
+		std::uint32_t flags { 0 };
+		std::uint32_t reserved { 0 };
+	};
+
+	struct Level
+	{
+		std::uint32_t width { 0 };
+		std::uint32_t height { 0 };
+		std::uint64_t offset { 0 };     // from the start of the file
+		std::uint64_t size { 0 };
+	};
+
+	// The baked file for an image, e.g. textures/container.jpg -> baked_textures/container.jpg.btex
+	static std::filesystem::path PathFor(const std::filesystem::path& image) {
+		return std::filesystem::path(BAKED_TEXTURE_DIR) / (image.filename().string() + ".btex");
+	}
+
+	// Bytes in one row of a level, padded to the default unpack alignment
+	static std::size_t RowBytes(int width, int channels) {
+		const std::size_t bytes = static_cast<std::size_t>(width) * static_cast<std::size_t>(channels);
+		return (bytes + 3) & ~static_cast<std::size_t>(3);
+	}
+
+	// Decode an image and write it out baked; false if it could not be read or written
+	static bool Bake(const std::filesystem::path& image, const std::filesystem::path& output, const TextureOptions& options = {}) {
+		int width { 0 };
+		int height { 0 };
+		int fileChannels { 0 };
+		unsigned char* pixels = stbi_load(image.c_str(), &width, &height, &fileChannels, options.channels);
+		if (pixels == nullptr)
+		{
+			std::cout << "ERROR::BAKED_TEXTURE::LOAD_FAILED: " << image << "\n";
+			return false;
+		}
+		const int channels = (options.channels != 0) ? options.channels : fileChannels;
+		// grey becomes RGB and grey with alpha RGBA, so every texture is one of two formats
+		const int baked = (channels == 2 || channels == 4) ? 4 : 3;
+
+		// Level 0: flipped, expanded and padded
+		std::vector<std::vector<unsigned char>> levels(1);
+		levels[0].resize(RowBytes(width, baked) * static_cast<std::size_t>(height));
+		for (int y = 0; y < height; y++)
+		{
+			const int source = options.flip ? height - 1 - y : y;
+			const unsigned char* in = pixels + static_cast<std::size_t>(source) * static_cast<std::size_t>(width * channels);
+			unsigned char* out = levels[0].data() + static_cast<std::size_t>(y) * RowBytes(width, baked);
+			for (int x = 0; x < width; x++, in += channels, out += baked)
+			{
+				Expand(in, channels, out);
+			}
+		}
+		stbi_image_free(pixels);
+
+		// Every further level from the one before; there is no GPU here, so that means the CPU
+		std::vector<Level> table { { static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), 0, levels[0].size() } };
+		if (options.mipmaps)
+		{
+			MipGenerator::Options mipOptions;
+			mipOptions.filter = (options.mipFilter == MipFilter::Gpu) ? MipFilter::Box : options.mipFilter;
+			mipOptions.srgb = options.srgb;
+			for (auto& level : MipGenerator::Chain(levels[0].data(), width, height, baked, RowBytes(width, baked), mipOptions))
+			{
+				table.push_back({ static_cast<std::uint32_t>(level.width), static_cast<std::uint32_t>(level.height), 0, level.pixels.size() });
+				levels.push_back(std::move(level.pixels));
+			}
+		}
+
+		Header header;
+		header.width = static_cast<std::uint32_t>(width);
+		header.height = static_cast<std::uint32_t>(height);
+		header.channels = static_cast<std::uint32_t>(baked);
+		header.levels = static_cast<std::uint32_t>(table.size());
+		header.flags = options.srgb ? Srgb : 0;
+		std::uint64_t offset = AlignUp(sizeof(Header) + table.size() * sizeof(Level));
+		for (auto& level : table)
+		{
+			level.offset = offset;
+			offset = AlignUp(offset + level.size);
+		}
+
+		// Written next to the target and renamed, so a reader never maps half a file
+		std::error_code ec;
+		std::filesystem::create_directories(output.parent_path(), ec);
+		auto temporary = output;
+		temporary += ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(Level)));
+			for (std::size_t i = 0; i < table.size(); i++)
+			{
+				file.seekp(static_cast<std::streamoff>(table[i].offset));
+				file.write(reinterpret_cast<const char*>(levels[i].data()), static_cast<std::streamsize>(levels[i].size()));
+			}
+			if (!file)
+			{
+				std::cout << "ERROR::BAKED_TEXTURE::WRITE_FAILED: " << output << "\n";
+				return false;
+			}
+		}
+		std::filesystem::rename(temporary, output, ec);
+		return !ec;
+	}
+
+	// Map a baked file; check with operator bool
+	explicit BakedTexture(const std::filesystem::path& path) {
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return;
+		}
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(Header)))
+		{
+			length = static_cast<std::size_t>(info.st_size);
+			void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			data = (mapped == MAP_FAILED) ? nullptr : static_cast<const unsigned char*>(mapped);
+		}
+		close(fd);
+		if (data != nullptr && !Valid())
+		{
+			std::cout << "ERROR::BAKED_TEXTURE::INVALID_FILE: " << path << "\n";
+			Unmap();
+		}
+	}
+
+	~BakedTexture() {
+		Unmap();
+	}
+
+	BakedTexture(BakedTexture&& other) noexcept
+		: data(std::exchange(other.data, nullptr)), length(std::exchange(other.length, 0)) {
+	}
+	BakedTexture& operator=(BakedTexture&& other) noexcept {
+		std::swap(data, other.data);
+		std::swap(length, other.length);
+		return *this;
+	}
+	BakedTexture(const BakedTexture&) = delete;
+	BakedTexture& operator=(const BakedTexture&) = delete;
+
+	explicit operator bool() const {
+		return data != nullptr;
+	}
+
+	// What the file holds
+	const Header& header() const {
+		return *reinterpret_cast<const Header*>(data);
+	}
+	const Level& level(std::uint32_t i) const {
+		return reinterpret_cast<const Level*>(data + sizeof(Header))[i];
+	}
+	const unsigned char* pixels(std::uint32_t i) const {
+		return data + level(i).offset;
+	}
+	TextureInfo Info() const {
+		return { static_cast<int>(header().width), static_cast<int>(header().height), static_cast<int>(header().channels) };
+	}
+
+	// Create a texture with every level straight from the mapping
+	unsigned int Upload(const TextureOptions& options = {}) const {
+		unsigned int texture { 0 };
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.magFilter);
+
+		const int channels = static_cast<int>(header().channels);
+		TextureStorage(GL_TEXTURE_2D, static_cast<int>(header().levels), channels, (header().flags & Srgb) != 0,
+			static_cast<int>(header().width), static_cast<int>(header().height));
+		for (std::uint32_t i = 0; i < header().levels; i++)
+		{
+			const auto& info = level(i);
+			glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), 0, 0, static_cast<GLsizei>(info.width),
+				static_cast<GLsizei>(info.height), TextureFormat(channels), GL_UNSIGNED_BYTE, pixels(i));
+		}
+		return texture;
+	}
+
+private:
+	static std::uint64_t AlignUp(std::uint64_t offset) {
+		return (offset + 15) & ~static_cast<std::uint64_t>(15);
+	}
+
+	// One texel from 1-4 channels to 3 or 4
+	static void Expand(const unsigned char* in, int channels, unsigned char* out) {
+		switch (channels)
+		{
+		case 1: out[0] = out[1] = out[2] = in[0]; break;
+		case 2: out[0] = out[1] = out[2] = in[0]; out[3] = in[1]; break;
+		case 3: std::memcpy(out, in, 3); break;
+		default: std::memcpy(out, in, 4); break;
+		}
+	}
+
+	// The header and level table have to agree with the file size
+	bool Valid() const {
+		const auto& head = header();
+		if (head.magic != Magic || head.version != Version || (head.channels != 3 && head.channels != 4) || head.levels == 0
+			|| sizeof(Header) + head.levels * sizeof(Level) > length)
+		{
+			return false;
+		}
+		for (std::uint32_t i = 0; i < head.levels; i++)
+		{
+			const auto& info = level(i);
+			if (info.offset + info.size > length || info.size < RowBytes(static_cast<int>(info.width), static_cast<int>(head.channels)) * info.height)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Unmap() {
+		if (data != nullptr)
+		{
+			munmap(const_cast<unsigned char*>(data), length);
+		}
+		data = nullptr;
+		length = 0;
+	}
+
+	const unsigned char* data { nullptr };
+	std::size_t length { 0 };
+};
+
+static_assert(sizeof(BakedTexture::Header) == 32, "the baked header is read straight from the file");
+static_assert(sizeof(BakedTexture::Level) == 24, "the baked level table is read straight from the file");
+
+#endif
@@ -0,0 +1,197 @@
+// BakedTextureBenchmark.cpp
+//
+// Compare loading every image in TEXTURE_DIR the usual way (stbi_load with a
+// flip, glTexImage2D, glGenerateMipmap) against its baked file (mmap and one
+// glTexImage2D per level), cold (file dropped from the page cache first) and warm
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "BakedTexture.h"
+#include "Texture.h"
+#include "Timeline.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Default number of warm loads of each file, overridable from the command line
+	constexpr int DefaultRuns { 20 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// Ask the kernel to forget a file's cached pages, so the next read goes to disk
+	void DropFromPageCache(const std::filesystem::path& path)
+	{
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd >= 0)
+		{
+			fdatasync(fd);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			close(fd);
+		}
+	}
+
+	// Before: decode, flip, upload and build the mips on the GPU
+	unsigned int LoadImage(const std::filesystem::path& path)
+	{
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load(true);
+		unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+		stbi_set_flip_vertically_on_load(false);
+		if (data == nullptr)
+		{
+			return 0;
+		}
+		unsigned int texture { 0 };
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, TextureInternalFormat(channels, false), width, height, 0, TextureFormat(channels),
+			GL_UNSIGNED_BYTE, data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		stbi_image_free(data);
+		return texture;
+	}
+
+	// After: map the baked file and upload every level as it is
+	unsigned int LoadBaked(const std::filesystem::path& path)
+	{
+		const BakedTexture baked(path);
+		return baked ? baked.Upload() : 0;
+	}
+
+	// Milliseconds for one load, including the driver finishing the upload
+	template<typename Load>
+	double Time(Load load, const std::filesystem::path& path)
+	{
+		const auto start = Clock::now();
+		unsigned int texture = load(path);
+		glFinish();
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		glDeleteTextures(1, &texture);
+		return elapsed.count();
+	}
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("BakedTextureBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	// Usage: BakedTextureBenchmark.bin [warm runs]
+	const int runs { (argc > 1) ? std::max(1, std::atoi(argv[1])) : DefaultRuns };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "BakedTextureBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+
+	// Bake anything TextureBaker has not, or whose image has changed since
+	std::vector<std::filesystem::path> images;
+	for (const auto& entry : std::filesystem::directory_iterator(TEXTURE_DIR))
+	{
+		if (!entry.is_regular_file())
+		{
+			continue;
+		}
+		const auto baked = BakedTexture::PathFor(entry.path());
+		std::error_code ec;
+		if ((std::filesystem::last_write_time(baked, ec) < entry.last_write_time() || ec)
+			&& !BakedTexture::Bake(entry.path(), baked))
+		{
+			// Nothing baked to load, so leave it out of the comparison
+			std::cout << entry.path().filename().string() << ": bake failed, skipped\n";
+			continue;
+		}
+		images.push_back(entry.path());
+	}
+
+	// Time both paths for every image
+	double totals[4] {};
+	for (const auto& image : images)
+	{
+		const auto baked = BakedTexture::PathFor(image);
+
+		DropFromPageCache(image);
+		const double coldImage = Time(LoadImage, image);
+		DropFromPageCache(baked);
+		const double coldBaked = Time(LoadBaked, baked);
+
+		double warmImage { 0.0 };
+		double warmBaked { 0.0 };
+		for (int run = 0; run < runs; run++)
+		{
+			warmImage += Time(LoadImage, image);
+			warmBaked += Time(LoadBaked, baked);
+		}
+		warmImage /= runs;
+		warmBaked /= runs;
+
+		std::cout << image.filename().string() << "\n";
+		std::cout << "  cold  stbi_load : " << coldImage << " ms, baked : " << coldBaked << " ms ("
+			<< (coldImage / coldBaked) << "x)\n";
+		std::cout << "  warm  stbi_load : " << warmImage << " ms, baked : " << warmBaked << " ms ("
+			<< (warmImage / warmBaked) << "x, average of " << runs << ")\n";
+		totals[0] += coldImage;
+		totals[1] += coldBaked;
+		totals[2] += warmImage;
+		totals[3] += warmBaked;
+	}
+
+	// Report the results
+	std::cout << images.size() << " textures\n";
+	std::cout << "  cold total : " << totals[0] << " ms -> " << totals[1] << " ms\n";
+	std::cout << "  warm total : " << totals[2] << " ms -> " << totals[3] << " ms\n";
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,307 @@
+// CompositeCache.h
+//
+// Header-only cache of pre-blended textures
+// The example fragment shaders mix two textures by a constant factor at every
+// pixel of every frame; when neither the textures nor the factor change, the
+// blend only has to be done once. Acquire() renders it into a texture of its
+// own, through a framebuffer, the first time both sources have loaded, and the
+// program can then switch to its COMPOSITED permutation, which samples one
+// texture instead of two
+//
+//	auto& composites = CompositeCache::Instance();
+//	const unsigned int blended = composites.Acquire(texture1, texture2);
+//	if (blended != 0)  // 0 until both have loaded; keep drawing with both
+//	{
+//		glActiveTexture(GL_TEXTURE0);
+//		glBindTexture(GL_TEXTURE_2D, blended);
+//	}
+//
+// A different factor rebuilds the composite, a different pair of textures is
+// a different composite, and Invalidate() throws away every composite made
+// from a texture whose pixels were changed in place. Clear() before the
+// context goes away
+
+#ifndef COMPOSITE_CACHE_H
+#define COMPOSITE_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CreateShader.h"
+#include "Texture.h"
+#include "TextureCache.h"
+
+class CompositeCache
+{
+public:
+	// The factor common/textures.c blends with unless told otherwise
+	static constexpr float DefaultFactor { 0.2f };
+
+	// One cache per process (and per context)
+	static CompositeCache& Instance() {
+		static CompositeCache cache;
+		return cache;
+	}
+
+	CompositeCache(const CompositeCache&) = delete;
+	CompositeCache& operator=(const CompositeCache&) = delete;
+
+	// The texture holding mix(a, b, factor), made the first time it is asked for;
+	// 0 while either source is still loading
+	// Making it leaves texture units 0 and 1 bound to the sources
+	unsigned int Acquire(const TextureHandle& a, const TextureHandle& b, float factor = DefaultFactor) {
+		const auto found = std::find_if(entries.begin(), entries.end(),
+			[&](const Entry& entry) { return entry.a.ID() == a.ID() && entry.b.ID() == b.ID(); });
+		if (found != entries.end() && found->factor == factor)
+		{
+			// a hit is a composite asked for again after it was built; the same
+			// request repeated every frame counts once, not once a frame
+			if (!found->reused)
+			{
+				found->reused = true;
+				hits++;
+			}
+			return found->texture;
+		}
+		if (!a.Ready() || !b.Ready())
+		{
+			return 0;
+		}
+		Entry entry;
+		if (found != entries.end())
+		{
+			// Same sources, new factor: draw over the old composite
+			entry = std::move(*found);
+			entries.erase(found);
+		}
+		else
+		{
+			entry.a = a;
+			entry.b = b;
+		}
+		entry.factor = factor;
+		entry.reused = false;
+		if (!Composite(entry))
+		{
+			Delete(entry);
+			return 0;
+		}
+		builds++;
+		entries.push_back(std::move(entry));
+		return entries.back().texture;
+	}
+
+	// Throw away every composite made from this texture, after its pixels have changed
+	void Invalidate(unsigned int source) {
+		for (auto it = entries.begin(); it != entries.end();)
+		{
+			if (it->a.ID() == source || it->b.ID() == source)
+			{
+				Delete(*it);
+				it = entries.erase(it);
+				invalidations++;
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	// Delete every composite, and let go of the sources; for shutdown
+	void Clear() {
+		for (auto& entry : entries)
+		{
+			Delete(entry);
+		}
+		entries.clear();
+		if (VAO != 0)
+		{
+			glDeleteVertexArrays(1, &VAO);
+			glDeleteBuffers(1, &VBO);
+			glDeleteFramebuffers(1, &FBO);
+			VAO = VBO = FBO = 0;
+		}
+	}
+
+	// Statistics
+	unsigned int Builds() const {
+		return builds;
+	}
+	// Composites that were asked for again after being built, instead of rebuilt
+	unsigned int Hits() const {
+		return hits;
+	}
+	unsigned int Invalidations() const {
+		return invalidations;
+	}
+	std::size_t Composites() const {
+		return entries.size();
+	}
+	void Print() const {
+		std::cout << "Composite cache: " << entries.size() << " composites, " << builds << " builds, " << hits
+			<< " hits, " << invalidations << " invalidations\n";
+	}
+
+private:
+	CompositeCache() = default;
+
+	// One blend; the handles keep both sources from being evicted (and their names reused)
+	struct Entry
+	{
+		TextureHandle a;
+		TextureHandle b;
+		float factor { DefaultFactor };
+		unsigned int texture { 0 };
+		int width { 0 };
+		int height { 0 };
+		bool reused { false };  // looked up again since it was built
+	};
+
+	void Delete(Entry& entry) {
+		if (entry.texture != 0)
+		{
+			glDeleteTextures(1, &entry.texture);
+			entry.texture = 0;
+		}
+	}
+
+	// The quad and framebuffer every composite is drawn with, made on first use
+	void Setup() {
+		if (VAO != 0)
+		{
+			return;
+		}
+		constexpr float Corners[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(Corners), Corners, GL_STATIC_DRAW);
+		// the corner doubles as the texture coordinate
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(1);
+		glGenFramebuffers(1, &FBO);
+	}
+
+	// Draw mix(a, b, factor) into the entry's texture, sized and sampled like a
+	bool Composite(Entry& entry) {
+		Setup();
+
+		// Size, sampling and colour space all come from the sources
+		int widthA { 0 }, heightA { 0 }, widthB { 0 }, heightB { 0 }, format { 0 };
+		int wrapS { GL_REPEAT }, wrapT { GL_REPEAT }, minFilter { GL_LINEAR }, magFilter { GL_LINEAR };
+		glBindTexture(GL_TEXTURE_2D, entry.b.ID());
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &widthB);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &heightB);
+		glBindTexture(GL_TEXTURE_2D, entry.a.ID());
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &widthA);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &heightA);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrapS);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &wrapT);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &minFilter);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &magFilter);
+		const int width = std::max(widthA, widthB);
+		const int height = std::max(heightA, heightB);
+		const bool srgb = (format == GL_SRGB8 || format == GL_SRGB8_ALPHA8);
+
+		// Storage is immutable, so a new size needs a new texture
+		if (entry.texture != 0 && (entry.width != width || entry.height != height))
+		{
+			Delete(entry);
+		}
+		if (entry.texture == 0)
+		{
+			glGenTextures(1, &entry.texture);
+			glBindTexture(GL_TEXTURE_2D, entry.texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+			TextureStorage(GL_TEXTURE_2D, MipLevels(width, height), 4, srgb, width, height);
+			entry.width = width;
+			entry.height = height;
+		}
+
+		// Whatever the caller had bound, to put back afterwards
+		int framebuffer { 0 }, program { 0 }, vertexArray { 0 }, viewport[4] {};
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+		glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		const GLenum capabilities[] = { GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST, GL_CULL_FACE };
+		bool enabled[std::size(capabilities)];
+		for (std::size_t i = 0; i < std::size(capabilities); i++)
+		{
+			enabled[i] = glIsEnabled(capabilities[i]);
+			glDisable(capabilities[i]);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, entry.texture, 0);
+		const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		if (complete)
+		{
+			// The same fragment shader the scenes use, with the factor baked in
+			// (the factor is written in the classic locale: a decimal comma would not be GLSL)
+			std::ostringstream mix;
+			mix.imbue(std::locale::classic());
+			mix << entry.factor;
+			Shader blend = Shader::Load("vs/quad.c", "fs/texture.c", { { "MIX_FACTOR", mix.str() } });
+			blend.use();
+			blend.setVec4("quad", -1.0f, -1.0f, 2.0f, 2.0f);
+			blend.setInt("texture1", 0);
+			blend.setInt("texture2", 1);
+			entry.a.Bind(0);
+			entry.b.Bind(1);
+			glActiveTexture(GL_TEXTURE0);
+			glViewport(0, 0, width, height);
+			glBindVertexArray(VAO);
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			glUseProgram(static_cast<unsigned int>(program));
+			glDeleteProgram(blend.ID);
+			glBindTexture(GL_TEXTURE_2D, entry.texture);
+			glGenerateMipmap(GL_TEXTURE_2D);
+			entry.a.Bind(0);
+		}
+		else
+		{
+			std::cout << "ERROR::COMPOSITE_CACHE::FRAMEBUFFER_INCOMPLETE\n";
+		}
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, static_cast<unsigned int>(framebuffer));
+		glBindVertexArray(static_cast<unsigned int>(vertexArray));
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		for (std::size_t i = 0; i < std::size(capabilities); i++)
+		{
+			if (enabled[i])
+			{
+				glEnable(capabilities[i]);
+			}
+		}
+		return complete;
+	}
+
+	std::vector<Entry> entries;
+	unsigned int VAO { 0 };
+	unsigned int VBO { 0 };
+	unsigned int FBO { 0 };
+	unsigned int builds { 0 };
+	unsigned int hits { 0 };
+	unsigned int invalidations { 0 };
+};
+
+#endif
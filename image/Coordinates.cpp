@@ -2,9 +2,25 @@
 //
 // Test moving the camera
 // https://learnopengl.com/Getting-started/Coordinate-Systems
+//
+// Given a count, draws that many containers on a grid, either instanced (one
+// draw, with a model matrix per instance in a vertex buffer) or with a draw
+// and a uniform buffer range bind per container; I switches between the two,
+// and the frame time is reported once a second. The view and projection are
+// uploaded once a frame in the Frame block of FrameBlocks.h, and every model
+// once at startup in an Object block each
+//
+// Usage: Coordinates.bin [instances]
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <optional>
+#include <sstream>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -13,7 +29,13 @@
 #include <glad/glad.h> // Must be included before glfw3
 #include <GLFW/glfw3.h>
 
+#include "CompositeCache.h"
 #include "CreateShader.h"
+#include "FrameBlocks.h"
+#include "ShaderWatcher.h"
+#include "TextureCache.h"
+#include "Timeline.h"
+#include "VertexLayout.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -26,6 +48,25 @@ namespace {
 	// Screen height and width
 	constexpr int ScreenWidth { 800 };
 	constexpr int ScreenHeight { 600 };
+
+	// Distance between neighbouring containers on the grid
+	constexpr float Spacing { 1.5f };
+
+	// A corner of the container, 12 bytes instead of 5 floats
+	struct Vertex
+	{
+		Half3 position;
+		UNorm16x2 texCoord;
+		static constexpr auto Attributes() {
+			return std::make_tuple(VertexAttribute("aPos", &Vertex::position),
+				VertexAttribute("aTexCoord", &Vertex::texCoord));
+		}
+	};
+
+	// Draw every container with one instanced draw, or one draw each
+	bool instanced { true };
+
+	using Clock = std::chrono::steady_clock;
 } // anonymous namespace
 
 // Callback function definitions
@@ -36,16 +77,26 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 Movement movement;
 
 // Main function
-int main()
+int main(int argc, char** argv)
 {
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("Coordinates");
+	TIMELINE_BEGIN("startup");
+
+	const int instances { (argc > 1) ? std::max(1, std::atoi(argv[1])) : 1 };
+
 	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
 	glfwInit();
+	TIMELINE_END();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
 	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "LearnOpenGL", nullptr, nullptr);
+	TIMELINE_END();
 	if (window == nullptr)
 	{
 		std::cout << "Failed to create GLFW window\n";
@@ -59,23 +110,39 @@ int main()
 	glfwSetKeyCallback(window, key_callback);
 
 	// Make sure GLAD loads
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
 	{
 		std::cout << "Failed to initialize GLAD\n";
 		glfwTerminate();
 		return EXIT_FAILURE;
 	}
-
-	// Build and compile our shader programs
-	Shader ourShader("vs/coordinates.c", "fs/transform.c");
+	// Measure the draws, not the display
+	glfwSwapInterval(0);
+
+	// The Frame block's declaration, which the vertex shader includes
+	RegisterFrameBlocks();
+
+	// Build and compile our shader programs, indexed [instanced][composited]:
+	// the model matrix from an Object block or a per-instance attribute, and two
+	// textures blended per pixel or one pre-blended texture once both have loaded
+	Shader shaders[2][2] = {
+		{ Shader::Load("vs/coordinates_ubo.c", "fs/transform.c"),
+			Shader::Load("vs/coordinates_ubo.c", "fs/transform.c", { { "COMPOSITED", "1" } }) },
+		{ Shader::Load("vs/coordinates_ubo.c", "fs/transform.c", { { "INSTANCED", "1" } }),
+			Shader::Load("vs/coordinates_ubo.c", "fs/transform.c", { { "INSTANCED", "1" }, { "COMPOSITED", "1" } }) },
+	};
+	Shader& ourShader = shaders[0][0];
 
 	// Texture coordiates
-	float vertices[] = {
-	// positions          // texture coords
-		0.5f,  0.5f, 0.0f,   1.0f, 1.0f, // top right
-		0.5f, -0.5f, 0.0f,   1.0f, 0.0f, // bottom right
-		-0.5f, -0.5f, 0.0f,   0.0f, 0.0f, // bottom left
-		-0.5f,  0.5f, 0.0f,   0.0f, 1.0f  // top left
+	const Vertex vertices[] = {
+	// positions                  // texture coords
+		{ { 0.5f,  0.5f, 0.0f },   { 1.0f, 1.0f } }, // top right
+		{ { 0.5f, -0.5f, 0.0f },   { 1.0f, 0.0f } }, // bottom right
+		{ { -0.5f, -0.5f, 0.0f },  { 0.0f, 0.0f } }, // bottom left
+		{ { -0.5f,  0.5f, 0.0f },  { 0.0f, 1.0f } }  // top left
 	};
 	unsigned int indices[] = {
 		0, 1, 3, // first triangle
@@ -111,116 +178,187 @@ int main()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// texture coord attribute
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-
-	// load and create a texture
-	unsigned int texture1;
-	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1);
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	int width, height, nrChannels;
-	stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-	const auto Texture1Path = std::filesystem::path(TEXTURE_DIR) / "container.jpg";
-	unsigned char* data = stbi_load(Texture1Path.c_str(), &width, &height, &nrChannels, 0);
-	if (!data)
+	// position and texture coord attributes, from the Vertex struct
+	VertexLayout<Vertex>::Apply(ourShader);
+
+	// The first container is the original one, at the origin; the rest fill a
+	// cube behind it, each turned a little differently
+	const int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(instances))));
+	const auto identity = glm::mat4(1.0f);
+	std::vector<glm::mat4> models(static_cast<std::size_t>(instances));
+	const auto centred = [](int k) { return static_cast<float>((k + 1) / 2 * ((k % 2 != 0) ? 1 : -1)); }; // 0, 1, -1, 2, -2...
+	for (int i = 0; i < instances; i++)
 	{
-		std::cout << "Failed to load texture\n";
-		return EXIT_FAILURE;
+		const glm::vec3 position(Spacing * centred(i % side), Spacing * centred((i / side) % side),
+			-Spacing * static_cast<float>(i / (side * side)));
+		const auto moved = glm::translate(identity, position);
+		const auto turned = glm::rotate(moved, glm::radians(static_cast<float>(i * 37 % 360)), glm::vec3(0.0f, 1.0f, 0.0f));
+		models[static_cast<std::size_t>(i)] = glm::rotate(turned, glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 	}
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(data);
-
-	// load and create a second texture
-	unsigned int texture2;
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	const auto Texture2Path = std::filesystem::path(TEXTURE_DIR) / "awesomeface.png";
-	data = stbi_load(Texture2Path.c_str(), &width, &height, &nrChannels, 0);
-	if (!data)
+
+	// model matrix attribute, one per instance: a mat4 takes four vec4 slots,
+	// one per column, from the location of aModel up
+	unsigned int instanceVBO;
+	glGenBuffers(1, &instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, models.size() * sizeof(glm::mat4), models.data(), GL_STATIC_DRAW);
+	const Shader& instancedShader = shaders[1][0];
+	const auto modelAttribute = instancedShader.attribute("aModel");
+	for (int column = 0; modelAttribute && column < 4; column++)
 	{
-		std::cout << "Failed to load texture\n";
-		return EXIT_FAILURE;
+		const Attribute slot { modelAttribute.location + column, GL_FLOAT_VEC4 };
+		instancedShader.vertexAttribPointer(slot, 4, GL_FLOAT, false, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(static_cast<GLuint>(slot.location), 1);
 	}
-	// note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the data type is of GL_RGBA
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(data);
+
+	// Load both textures in the background; each shows a placeholder until it is ready
+	// (awesomeface.png has an alpha channel, which the loader picks up from the file)
+	auto& textures = TextureCache::Instance();
+	const auto texture1 = textures.Acquire(std::filesystem::path(TEXTURE_DIR) / "container.jpg");
+	const auto texture2 = textures.Acquire(std::filesystem::path(TEXTURE_DIR) / "awesomeface.png");
 
 	// tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-	ourShader.use();
-	ourShader.setInt("texture1", 0);
-	ourShader.setInt("texture2", 1);
+	for (auto& blended : shaders)
+	{
+		blended[0].use();
+		blended[0].setInt("texture1", 0);
+		blended[0].setInt("texture2", 1);
+	}
 
 	// Draw in wireframe mode
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-	// Create the matrix model, view, and projection
-	const auto identity = glm::mat4(1.0f);
-	const auto model = glm::rotate(identity, glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	// Create the matrix view and projection (the models are above)
 	//auto view = glm::translate(identity, glm::vec3(0.0f, 0.0f, -3.0f));
 	const auto projection = glm::perspective(glm::radians(45.0f), static_cast<float>(ScreenWidth / ScreenHeight), 0.1f, 100.0f);
 
 	// Initialize the Z-offset to -3
 	movement.SetZ(-3.0f);
 
+	// Containers hide the ones behind them
+	glEnable(GL_DEPTH_TEST);
+
+	// The view and projection, shared by every program through the Frame block,
+	// and every model in an Object block of its own, which never changes
+	ourShader.validateBlock<FrameBlock>();
+	ourShader.validateBlock<ObjectBlock>();
+	std::optional<UniformBuffer<FrameBlock>> frameBuffer;
+	std::optional<UniformBuffer<ObjectBlock>> objectBuffer;
+	frameBuffer.emplace();
+	objectBuffer.emplace(models.size());
+	for (std::size_t i = 0; i < models.size(); i++)
+	{
+		objectBuffer->Set(i, { models[i] });
+	}
+	objectBuffer->Upload();
+	FrameBlock frame;
+	frame.projection = projection;
+
+	// Blend the two textures once, instead of at every pixel of every frame
+	auto& composites = CompositeCache::Instance();
+
+	// Reload the shaders whenever their files are edited
+	ShaderWatcher watcher;
+	for (auto& blended : shaders)
+	{
+		watcher.Watch(blended[0]);
+		watcher.Watch(blended[1]);
+	}
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
 	// Render loop
+	auto reported = Clock::now();
+	int frames { 0 };
+	long long draws { 0 };
 	while (!glfwWindowShouldClose(window)) {
+		// Swap in edited shaders; their blocks and samplers carry over
+		watcher.Update();
+
+		// Upload a little more of any texture still loading
+		textures.Update();
+
 		// Set the background color to dark red
 		glClearColor(0.3f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
-
-		// Update the view every frame
-		auto view = glm::translate(identity, glm::vec3(movement.GetX(), movement.GetY(), movement.GetZ()));
-
-		// Update the model, view, and projection
-		int modelLoc = glGetUniformLocation(ourShader.ID, "model");
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-		int viewLoc = glGetUniformLocation(ourShader.ID, "view");
-		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-		int projectionLoc = glGetUniformLocation(ourShader.ID, "projection");
-		glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-		// Show both textures
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-
-		// Actually render the container
-		ourShader.use();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// Update the view every frame, in one upload for every draw
+		frame.view = glm::translate(identity, glm::vec3(movement.GetX(), movement.GetY(), movement.GetZ()));
+		frame.viewProjection = frame.projection * frame.view;
+		frameBuffer->Set(frame);
+		frameBuffer->Upload();
+
+		// Once both textures are in, draw their blend with one sample instead of two
+		const unsigned int composite = composites.Acquire(texture1, texture2);
+		Shader& shader = shaders[instanced][composite != 0];
+		shader.use();
+
+		// Show both textures, or the one they make
+		if (composite != 0)
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, composite);
+		}
+		else
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture1.ID());
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, texture2.ID());
+		}
+
+		// Actually render the containers
 		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		if (instanced)
+		{
+			// the models are already in the instance buffer
+			glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, instances);
+			draws++;
+		}
+		else
+		{
+			// Point the Object block at every container's model in turn
+			for (std::size_t i = 0; i < models.size(); i++)
+			{
+				objectBuffer->Bind(i);
+				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+			}
+			draws += instances;
+		}
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		// Report once a second, when there is more than one container to compare
+		frames++;
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - reported;
+		if (instances > 1 && elapsed.count() >= 1000.0)
+		{
+			std::ostringstream report;
+			report << instances << " containers, " << (instanced ? "instanced" : "one draw each") << ": " << std::fixed
+				<< std::setprecision(3) << elapsed.count() / frames << " ms/frame, " << draws / frames << " draws/frame";
+			std::cout << report.str() << "\n";
+			glfwSetWindowTitle(window, report.str().c_str());
+			reported = Clock::now();
+			frames = 0;
+			draws = 0;
+		}
 	}
 
 	// Clean up buffers
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &instanceVBO);
+	frameBuffer.reset();
+	objectBuffer.reset();
+	composites.Print();
+	composites.Clear();
+	textures.Clear();
+	watcher.Stop();
 
 	glfwTerminate();
 	return EXIT_SUCCESS;
@@ -289,6 +427,13 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 		case GLFW_KEY_SPACE:
 			movement.PlayPause();
 			break;
+		// Switch between one instanced draw and one draw per container
+		case GLFW_KEY_I:
+			if (action == GLFW_PRESS)
+			{
+				instanced = !instanced;
+			}
+			break;
 		// Unhandled key
 		default:
 			std::cout << "key was " << key << " * " << multiplier << "\n";
@@ -6,75 +6,143 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
+#include <initializer_list>
 #include <iostream>
-#include <sstream>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "ProgramCache.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderReflection.h"
+#include "StageCache.h"
+#include "Timeline.h"
+#include "UniformBuffer.h"
+
+// FNV-1a hash of a uniform name, usable at compile time
+constexpr std::uint32_t HashName(std::string_view name)
+{
+	std::uint32_t hash { 2166136261u };
+	for (const char c : name)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Handle to a uniform that was resolved when the program was linked
+struct Uniform
+{
+	int location { -1 };
+	GLenum type { 0 };
+
+	// Uniforms that were optimized out (or never existed) are invalid
+	explicit operator bool() const {
+		return location >= 0;
+	}
+};
+
+// Handle to a vertex attribute of the linked program
+struct Attribute
+{
+	int location { -1 };
+	GLenum type { 0 };
+
+	explicit operator bool() const {
+		return location >= 0;
+	}
+};
+
 class Shader
 {
 public:
 	unsigned int ID;
-	// constructor generates the shader on the fly
+	// where each stage came from and what it expanded to, so it can be reloaded
+	struct Stage
+	{
+		std::string file;
+		ShaderDefines defines;
+		PreprocessedSource source;
+	};
+	Stage vertexStage;
+	Stage fragmentStage;
+	// everything the linked program exposes, read once after each link
+	ShaderReflection reflection;
+	// constructor generates the shader on the fly, with optional permutation defines
 	// ------------------------------------------------------------------------
-	//Shader(std::string_view vertexFile, std::string_view fragmentFile)
-	Shader(const char* vertexFile, const char* fragmentFile)
+	Shader(const char* vertexFile, const char* fragmentFile, const ShaderDefines& defines = {})
 	{
+		TIMELINE_SCOPE(std::string("Shader ") + vertexFile + " + " + fragmentFile);
 		const auto ShaderPath = std::filesystem::path(SHADER_DIR);
 		std::cout << "Looking for shaders in (" << ShaderPath << ")\n";
 
-		// 1. retrieve the vertex/fragment source code from filePath
-		std::string vertexCode;
-		std::string fragmentCode;
-		try
-		{
-			// create the full file paths
-			const auto vertexPath { ShaderPath / vertexFile };
-			const auto fragmentPath { ShaderPath / fragmentFile };
-			std::ifstream vShaderFile(vertexPath);
-			std::ifstream fShaderFile(fragmentPath);
-			// read file's buffer contents into streams
-			std::stringstream vShaderStream, fShaderStream;
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-			// close file handlers
-			vShaderFile.close();
-			fShaderFile.close();
-			// convert stream into string
-			vertexCode   = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
-		}
-		catch (std::ifstream::failure e)
-		{
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << "\n";
-		}
-		const char* vShaderCode = vertexCode.c_str();
-		const char * fShaderCode = fragmentCode.c_str();
-		// 2. compile shaders
-		unsigned int vertex, fragment;
-		// vertex shader
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		checkCompileErrors(vertex, "VERTEX");
-		// fragment Shader
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		checkCompileErrors(fragment, "FRAGMENT");
-		// shader Program
-		ID = glCreateProgram();
-		glAttachShader(ID, vertex);
-		glAttachShader(ID, fragment);
-		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
-		// delete the shaders as they're linked into our program now and no longer necessary
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+		// 1. retrieve the vertex/fragment source code, with includes and defines expanded
+		TIMELINE_BEGIN("preprocess");
+		vertexStage = { vertexFile, defines, ShaderPreprocessor::Process(vertexFile, defines) };
+		fragmentStage = { fragmentFile, defines, ShaderPreprocessor::Process(fragmentFile, defines) };
+		TIMELINE_END();
+		build();
+	}
+	// constructor from sources already in memory (e.g. embedded at build time);
+	// the names are kept so hot reload can still find the files
+	// ------------------------------------------------------------------------
+	Shader(const ShaderSource& vertex, const ShaderSource& fragment, const ShaderDefines& defines = {})
+	{
+		TIMELINE_SCOPE("Shader " + std::string(vertex.name) + " + " + std::string(fragment.name) + " (embedded)");
+		TIMELINE_BEGIN("preprocess");
+		vertexStage = { std::string(vertex.name), defines, ShaderPreprocessor::Process(vertex, defines) };
+		fragmentStage = { std::string(fragment.name), defines, ShaderPreprocessor::Process(fragment, defines) };
+		TIMELINE_END();
+		build();
+	}
+	// the embedded copies of two stages when the build has them, otherwise the files
+	// ------------------------------------------------------------------------
+	static Shader Load(const char* vertexFile, const char* fragmentFile, const ShaderDefines& defines = {})
+	{
+		const auto vertex = ShaderPreprocessor::Embedded(vertexFile);
+		const auto fragment = ShaderPreprocessor::Embedded(fragmentFile);
+		if (vertex && fragment)
+		{
+			return Shader(*vertex, *fragment, defines);
+		}
+		return Shader(vertexFile, fragmentFile, defines);
+	}
+	// adopt a program that was already linked elsewhere (e.g. by a ShaderLibrary)
+	// ------------------------------------------------------------------------
+	explicit Shader(unsigned int program) : ID(program)
+	{
+		reflect();
+	}
+	// replace the program with a newly linked one, carrying the uniform values over
+	// ------------------------------------------------------------------------
+	void swapProgram(unsigned int program)
+	{
+		const auto previous = std::move(uniforms);
+		const unsigned int old { ID };
+		ID = program;
+		reflect();
+		int current { 0 };
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+		glUseProgram(ID);
+		for (const auto& entry : uniforms)
+		{
+			const auto match = std::lower_bound(previous.begin(), previous.end(), entry.hash,
+				[](const UniformEntry& e, std::uint32_t h) { return e.hash < h; });
+			if (match != previous.end() && match->hash == entry.hash && match->handle.type == entry.handle.type)
+			{
+				copyUniform(old, match->handle.location, entry.handle);
+			}
+		}
+		glUseProgram(static_cast<unsigned int>(current) == old ? ID : static_cast<unsigned int>(current));
+		glDeleteProgram(old);
 	}
 	// activate the shader
 	// ------------------------------------------------------------------------
@@ -82,69 +150,208 @@ public:
 	{
 		glUseProgram(ID);
 	}
-	// utility uniform functions
+	// look up a uniform handle without allocating or calling into the driver
 	// ------------------------------------------------------------------------
-	void setBool(const std::string &name, bool value) const
+	Uniform uniform(std::string_view name) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		const auto hash = HashName(name);
+		const auto it = std::lower_bound(uniforms.begin(), uniforms.end(), hash,
+			[](const UniformEntry& entry, std::uint32_t h) { return entry.hash < h; });
+		if (it == uniforms.end() || it->hash != hash)
+		{
+			return Uniform{};
+		}
+		return it->handle;
 	}
+	// look up a vertex attribute; use it for VAO setup instead of hardcoded locations
 	// ------------------------------------------------------------------------
-	void setInt(const std::string &name, int value) const
+	Attribute attribute(std::string_view name) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		const auto* found = reflection.FindAttribute(name);
+		if (found == nullptr)
+		{
+			return Attribute{};
+		}
+		return Attribute{ found->location, found->type };
 	}
+	// glVertexAttribPointer + glEnableVertexAttribArray for an attribute, checked in debug builds
 	// ------------------------------------------------------------------------
-	void setFloat(const std::string &name, float value) const
+	void vertexAttribPointer(Attribute a, int size, GLenum type, bool normalized, int stride, const void* offset) const
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+#ifndef NDEBUG
+		if (!a)
+		{
+			std::cout << "WARNING::SHADER::ATTRIBUTE_NOT_ACTIVE in program " << ID << "\n";
+			return;
+		}
+		if (ShaderReflection::IsInteger(a.type))
+		{
+			std::cout << "ERROR::SHADER::ATTRIBUTE_TYPE_MISMATCH: " << ShaderReflection::TypeName(a.type)
+				<< " at location " << a.location << " needs glVertexAttribIPointer\n";
+		}
+		else if (size != ShaderReflection::Components(a.type) && size != GL_BGRA && type != GL_INT_2_10_10_10_REV
+			&& type != GL_UNSIGNED_INT_2_10_10_10_REV) // packed formats are always given as 4 components
+		{
+			std::cout << "WARNING::SHADER::ATTRIBUTE_SIZE_MISMATCH: " << size << " components fed to "
+				<< ShaderReflection::TypeName(a.type) << " at location " << a.location << "\n";
+		}
+#endif
+		if (!a)
+		{
+			return;
+		}
+		glVertexAttribPointer(static_cast<GLuint>(a.location), size, type, normalized ? GL_TRUE : GL_FALSE, stride, offset);
+		glEnableVertexAttribArray(static_cast<GLuint>(a.location));
+	}
+	// check a C++ block struct against the program's layout of the block, in debug builds
+	// ------------------------------------------------------------------------
+	template <typename Block>
+	bool validateBlock() const
+	{
+#ifndef NDEBUG
+		const auto* block = reflection.FindBlock(Block::Name);
+		if (block == nullptr)
+		{
+			return true;
+		}
+		bool valid { block->dataSize == static_cast<int>(Std140Layout<Block>::Size) };
+		if (!valid)
+		{
+			std::cout << "ERROR::SHADER::BLOCK_SIZE_MISMATCH: " << block->name << " is " << block->dataSize
+				<< " bytes in GLSL, " << Std140Layout<Block>::Size << " in C++\n";
+		}
+		const auto members = Std140Layout<Block>::Fields();
+		for (const auto& uniform : reflection.uniforms)
+		{
+			if (uniform.block != static_cast<int>(block->index))
+			{
+				continue;
+			}
+			// members of an instanced block are reported as "Block.member"
+			const auto dot = uniform.name.rfind('.');
+			const auto name = (dot == std::string::npos) ? uniform.name : uniform.name.substr(dot + 1);
+			const auto match = std::find_if(members.begin(), members.end(), [&](const auto& m) { return name == m.name; });
+			if (match == members.end() || match->offset != static_cast<std::size_t>(uniform.offset))
+			{
+				std::cout << "ERROR::SHADER::BLOCK_MEMBER_MISMATCH: " << block->name << "." << name << " at offset "
+					<< uniform.offset << "\n";
+				valid = false;
+			}
+		}
+		return valid;
+#else
+		return true;
+#endif
 	}
+	// utility uniform functions, by handle
 	// ------------------------------------------------------------------------
-	void setVec2(const std::string &name, const glm::vec2 &value) const
+	void setBool(Uniform u, bool value) const
+	{
+		expectType(u, { GL_BOOL, GL_INT }, "setBool");
+		glUniform1i(u.location, (int)value);
+	}
+	void setInt(Uniform u, int value) const
 	{
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		expectType(u, { GL_INT, GL_BOOL, GL_SAMPLER_2D, GL_SAMPLER_2D_ARRAY, GL_SAMPLER_3D, GL_SAMPLER_CUBE }, "setInt");
+		glUniform1i(u.location, value);
 	}
-	void setVec2(const std::string &name, float x, float y) const
+	void setFloat(Uniform u, float value) const
 	{
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		expectType(u, { GL_FLOAT }, "setFloat");
+		glUniform1f(u.location, value);
+	}
+	void setVec2(Uniform u, const glm::vec2 &value) const
+	{
+		expectType(u, { GL_FLOAT_VEC2 }, "setVec2");
+		glUniform2fv(u.location, 1, &value[0]);
+	}
+	void setVec3(Uniform u, const glm::vec3 &value) const
+	{
+		expectType(u, { GL_FLOAT_VEC3 }, "setVec3");
+		glUniform3fv(u.location, 1, &value[0]);
+	}
+	void setVec4(Uniform u, const glm::vec4 &value) const
+	{
+		expectType(u, { GL_FLOAT_VEC4 }, "setVec4");
+		glUniform4fv(u.location, 1, &value[0]);
+	}
+	void setMat2(Uniform u, const glm::mat2 &mat) const
+	{
+		expectType(u, { GL_FLOAT_MAT2 }, "setMat2");
+		glUniformMatrix2fv(u.location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void setMat3(Uniform u, const glm::mat3 &mat) const
+	{
+		expectType(u, { GL_FLOAT_MAT3 }, "setMat3");
+		glUniformMatrix3fv(u.location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void setMat4(Uniform u, const glm::mat4 &mat) const
+	{
+		expectType(u, { GL_FLOAT_MAT4 }, "setMat4");
+		glUniformMatrix4fv(u.location, 1, GL_FALSE, &mat[0][0]);
+	}
+	// utility uniform functions, by name (hashed, then looked up in the cache)
+	// ------------------------------------------------------------------------
+	void setBool(std::string_view name, bool value) const
+	{
+		setBool(uniform(name), value);
 	}
 	// ------------------------------------------------------------------------
-	void setVec3(const std::string &name, const glm::vec3 &value) const
+	void setInt(std::string_view name, int value) const
 	{
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		setInt(uniform(name), value);
 	}
-	void setVec3(const std::string &name, float x, float y, float z) const
+	// ------------------------------------------------------------------------
+	void setFloat(std::string_view name, float value) const
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		setFloat(uniform(name), value);
 	}
 	// ------------------------------------------------------------------------
-	void setVec4(const std::string &name, const glm::vec4 &value) const
+	void setVec2(std::string_view name, const glm::vec2 &value) const
 	{
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		setVec2(uniform(name), value);
 	}
-	void setVec4(const std::string &name, float x, float y, float z, float w) const
+	void setVec2(std::string_view name, float x, float y) const
 	{
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		glUniform2f(uniform(name).location, x, y);
 	}
 	// ------------------------------------------------------------------------
-	void setMat2(const std::string &name, const glm::mat2 &mat) const
+	void setVec3(std::string_view name, const glm::vec3 &value) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setVec3(uniform(name), value);
+	}
+	void setVec3(std::string_view name, float x, float y, float z) const
+	{
+		glUniform3f(uniform(name).location, x, y, z);
 	}
 	// ------------------------------------------------------------------------
-	void setMat3(const std::string &name, const glm::mat3 &mat) const
+	void setVec4(std::string_view name, const glm::vec4 &value) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setVec4(uniform(name), value);
+	}
+	void setVec4(std::string_view name, float x, float y, float z, float w) const
+	{
+		glUniform4f(uniform(name).location, x, y, z, w);
 	}
 	// ------------------------------------------------------------------------
-	void setMat4(const std::string &name, const glm::mat4 &mat) const
+	void setMat2(std::string_view name, const glm::mat2 &mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat2(uniform(name), mat);
+	}
+	// ------------------------------------------------------------------------
+	void setMat3(std::string_view name, const glm::mat3 &mat) const
+	{
+		setMat3(uniform(name), mat);
+	}
+	// ------------------------------------------------------------------------
+	void setMat4(std::string_view name, const glm::mat4 &mat) const
+	{
+		setMat4(uniform(name), mat);
 	}
 
-private:
 	// utility function for checking shader compilation/linking errors.
 	// ------------------------------------------------------------------------
-	void checkCompileErrors(unsigned int shader, std::string type)
+	static bool checkCompileErrors(unsigned int shader, std::string type)
 	{
 		int success;
 		char infoLog[1024];
@@ -168,6 +375,186 @@ private:
 					<< infoLog << "\n -- --------------------------------------------------- --\n";
 			}
 		}
+		return success;
+	}
+
+private:
+	// link the expanded stages into ID, from the binary cache when possible
+	// ------------------------------------------------------------------------
+	void build()
+	{
+		// reuse a linked binary from a previous run, if the driver still accepts it
+		auto& cache = ProgramCache::Instance();
+		const auto key = ProgramCache::MakeKey(vertexStage.source.code, fragmentStage.source.code,
+			ShaderPreprocessor::DefinesKey(vertexStage.defines));
+		TIMELINE_BEGIN("program cache");
+		ID = cache.Load(key);
+		TIMELINE_END();
+		if (ID == 0)
+		{
+			TIMELINE_SCOPE("compile and link");
+			const auto start = std::chrono::steady_clock::now();
+			const bool linked = compileAndLink(vertexStage.source, fragmentStage.source);
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			if (linked)
+			{
+				cache.Store(key, ID, elapsed.count());
+			}
+		}
+		// resolve every active uniform once, so nothing has to ask the driver later
+		reflect();
+	}
+
+	// copy the value of one (non-array) uniform from another program into this one
+	// ------------------------------------------------------------------------
+	static void copyUniform(unsigned int from, int fromLocation, Uniform to)
+	{
+		float f[16];
+		int i[4];
+		switch (to.type)
+		{
+		case GL_FLOAT:
+			glGetUniformfv(from, fromLocation, f);
+			glUniform1fv(to.location, 1, f);
+			break;
+		case GL_FLOAT_VEC2:
+			glGetUniformfv(from, fromLocation, f);
+			glUniform2fv(to.location, 1, f);
+			break;
+		case GL_FLOAT_VEC3:
+			glGetUniformfv(from, fromLocation, f);
+			glUniform3fv(to.location, 1, f);
+			break;
+		case GL_FLOAT_VEC4:
+			glGetUniformfv(from, fromLocation, f);
+			glUniform4fv(to.location, 1, f);
+			break;
+		case GL_FLOAT_MAT2:
+			glGetUniformfv(from, fromLocation, f);
+			glUniformMatrix2fv(to.location, 1, GL_FALSE, f);
+			break;
+		case GL_FLOAT_MAT3:
+			glGetUniformfv(from, fromLocation, f);
+			glUniformMatrix3fv(to.location, 1, GL_FALSE, f);
+			break;
+		case GL_FLOAT_MAT4:
+			glGetUniformfv(from, fromLocation, f);
+			glUniformMatrix4fv(to.location, 1, GL_FALSE, f);
+			break;
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+			glGetUniformiv(from, fromLocation, i);
+			glUniform1iv(to.location, 1, i);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// compile both stages (or reuse identical ones) and link them into ID,
+	// returning whether it all worked
+	// ------------------------------------------------------------------------
+	bool compileAndLink(const PreprocessedSource& vertexSource, const PreprocessedSource& fragmentSource)
+	{
+		auto& stages = StageCache::Instance();
+		bool success { true };
+		// vertex shader
+		const auto vertex = stages.Acquire(GL_VERTEX_SHADER, vertexSource.code, vertexSource.hash);
+		if (vertex.fresh)
+		{
+			success = checkCompileErrors(vertex.object, "VERTEX") && success;
+		}
+		// fragment Shader
+		const auto fragment = stages.Acquire(GL_FRAGMENT_SHADER, fragmentSource.code, fragmentSource.hash);
+		if (fragment.fresh)
+		{
+			success = checkCompileErrors(fragment.object, "FRAGMENT") && success;
+		}
+		// shader Program; the stages stay in the cache for other programs to share
+		ID = glCreateProgram();
+		ProgramCache::Instance().PrepareForLink(ID);
+		glAttachShader(ID, vertex.object);
+		glAttachShader(ID, fragment.object);
+		glLinkProgram(ID);
+		success = checkCompileErrors(ID, "PROGRAM") && success;
+		glDetachShader(ID, vertex.object);
+		glDetachShader(ID, fragment.object);
+		return success;
+	}
+
+	// Cached uniform, sorted by the hash of its name
+	struct UniformEntry
+	{
+		std::uint32_t hash;
+		Uniform handle;
+	};
+	std::vector<UniformEntry> uniforms;
+
+	// read the reflection table of the linked program, then everything derived from it
+	// ------------------------------------------------------------------------
+	void reflect()
+	{
+		TIMELINE_SCOPE("reflect");
+		reflection = ShaderReflection::Of(ID);
+		cacheUniforms();
+		bindUniformBlocks();
+	}
+
+	// in debug builds, complain when a setter does not match the uniform's GLSL type;
+	// in release builds this is empty and every setter is a single glUniform call
+	// ------------------------------------------------------------------------
+	void expectType(Uniform u, std::initializer_list<GLenum> types, const char* setter) const
+	{
+#ifndef NDEBUG
+		if (u && std::find(types.begin(), types.end(), u.type) == types.end())
+		{
+			std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << setter << " on a "
+				<< ShaderReflection::TypeName(u.type) << " at location " << u.location << " of program " << ID << "\n";
+		}
+#else
+		(void)u;
+		(void)types;
+		(void)setter;
+#endif
+	}
+
+	// hash every loose uniform of the reflection table into the lookup cache
+	// ------------------------------------------------------------------------
+	void cacheUniforms()
+	{
+		uniforms.clear();
+		for (const auto& variable : reflection.uniforms)
+		{
+			if (variable.location < 0)
+			{
+				// uniforms inside a block have no location of their own
+				continue;
+			}
+			uniforms.push_back({ HashName(variable.name), Uniform{ variable.location, variable.type } });
+		}
+		std::sort(uniforms.begin(), uniforms.end(),
+			[](const UniformEntry& a, const UniformEntry& b) { return a.hash < b.hash; });
+		for (size_t i = 1; i < uniforms.size(); i++)
+		{
+			if (uniforms[i].hash == uniforms[i - 1].hash)
+			{
+				std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION at location " << uniforms[i].handle.location << "\n";
+			}
+		}
+	}
+
+	// point every uniform block at the binding shared by all programs using that name
+	// ------------------------------------------------------------------------
+	void bindUniformBlocks()
+	{
+		for (const auto& block : reflection.blocks)
+		{
+			glUniformBlockBinding(ID, block.index, BindingPoints::Instance().Get(block.name));
+		}
 	}
 };
 #endif
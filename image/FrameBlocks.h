@@ -0,0 +1,54 @@
+// FrameBlocks.h
+//
+// The uniform blocks shared by the coordinate shaders: one per frame, one per object
+// Their GLSL declarations are generated from these structs and included as
+// "common/blocks.c", so the two sides cannot drift apart
+
+#ifndef FRAME_BLOCKS_H
+#define FRAME_BLOCKS_H
+
+#include <tuple>
+
+#include <glm/glm.hpp>
+
+#include "ShaderPreprocessor.h"
+#include "UniformBuffer.h"
+
+// Written once per frame
+struct FrameBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+
+	static constexpr const char* Name { "Frame" };
+	static constexpr auto Members() {
+		return std::make_tuple(
+			BlockMember("view", &FrameBlock::view),
+			BlockMember("projection", &FrameBlock::projection),
+			BlockMember("viewProjection", &FrameBlock::viewProjection));
+	}
+};
+
+// One per object; the vertex shader combines it with the frame's viewProjection
+struct ObjectBlock
+{
+	glm::mat4 model;
+
+	static constexpr const char* Name { "Object" };
+	static constexpr auto Members() {
+		return std::make_tuple(
+			BlockMember("model", &ObjectBlock::model));
+	}
+};
+
+static_assert(Std140Layout<FrameBlock>::Size == 192, "Frame block must be three packed mat4");
+static_assert(Std140Layout<ObjectBlock>::Size == 64, "Object block must be one mat4");
+
+// Make "common/blocks.c" available to shaders; call before creating them
+inline void RegisterFrameBlocks() {
+	ShaderPreprocessor::AddGenerated("common/blocks.c",
+		Std140Layout<FrameBlock>::Glsl("frame") + Std140Layout<ObjectBlock>::Glsl("object"));
+}
+
+#endif
@@ -8,6 +8,8 @@
 #include <glad/glad.h> // Must be included before glfw3
 #include <GLFW/glfw3.h>
 
+#include "Timeline.h"
+
 // Set some global variables
 namespace {
 	// Screen height and width
@@ -69,8 +71,15 @@ void processInput(GLFWwindow *window)
 // Main function
 int main(int argc, char** argv)
 {
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("HelloTriangle");
+	TIMELINE_BEGIN("startup");
+
 	// Initialize the library
-	if (!glfwInit())
+	TIMELINE_BEGIN("glfwInit");
+	const bool initialized = glfwInit();
+	TIMELINE_END();
+	if (!initialized)
 	{
 		return EXIT_FAILURE;
 	}
@@ -86,7 +95,9 @@ int main(int argc, char** argv)
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
 	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "LearnOpenGL", nullptr, nullptr);
+	TIMELINE_END();
 	if (window == nullptr)
 	{
 		std::cout << "Failed to create GLFW window\n";
@@ -100,7 +111,10 @@ int main(int argc, char** argv)
 	glfwSetKeyCallback(window, key_callback);
 
 	// Make sure GLAD loads
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
 	{
 		std::cout << "Failed to initialize GLAD\n";
 		glfwTerminate();
@@ -108,6 +122,7 @@ int main(int argc, char** argv)
 	}
 
 	// Use the vertex shader
+	TIMELINE_BEGIN("compile and link");
 	unsigned int vertexShader { glCreateShader(GL_VERTEX_SHADER) };
 	glShaderSource(vertexShader, 1, &shaderSourceVertex, nullptr);
 	glCompileShader(vertexShader);
@@ -144,6 +159,8 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	TIMELINE_END();
+
 	// Delete the shaders that we no longer need
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
@@ -189,6 +206,9 @@ int main(int argc, char** argv)
 	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
 	// Start with no blue
 	auto colorBlue = 0.0f;
 	double delta = 0.01;
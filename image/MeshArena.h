@@ -0,0 +1,450 @@
+// MeshArena.h
+//
+// Header-only GPU memory arena for many small meshes of one vertex format
+// Instead of a VAO, VBO and EBO per mesh, meshes are sub-allocated out of a
+// few large vertex/index buffer pairs, each with one VAO, and drawn with
+// glDrawElementsBaseVertex; consecutive draws from the same block then need
+// no binds at all
+//
+//	MeshArena arena(sizeof(Vertex), [](){ /* glVertexAttribPointer calls for Vertex */ });
+//	const int mesh = arena.Add(vertices, vertexCount, indices, indexCount);  // indices start at 0
+//	arena.Begin();
+//	arena.Draw(mesh);
+//	arena.Remove(mesh);
+//
+// Free space is kept per block as a list of ranges sorted by offset and
+// merged with its neighbours on release; Fragmentation() says how much of it
+// is unusable for one large mesh, and Compact() packs the meshes back into
+// as few blocks as will hold them
+
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+// First-fit allocator of ranges of a fixed capacity, in elements
+class RangeAllocator
+{
+public:
+	static constexpr std::uint32_t Invalid { 0xFFFFFFFFu };
+
+	explicit RangeAllocator(std::uint32_t capacity = 0) : capacity(capacity) {
+		if (capacity > 0)
+		{
+			free.emplace(0, capacity);
+		}
+	}
+
+	// The start of size free elements, or Invalid if no range is big enough
+	std::uint32_t Allocate(std::uint32_t size) {
+		for (auto it = free.begin(); it != free.end(); ++it)
+		{
+			if (it->second < size)
+			{
+				continue;
+			}
+			const std::uint32_t offset = it->first;
+			const std::uint32_t left = it->second - size;
+			free.erase(it);
+			if (left > 0)
+			{
+				free.emplace(offset + size, left);
+			}
+			used += size;
+			return offset;
+		}
+		return Invalid;
+	}
+
+	// Give a range back, merging it with the free ranges either side
+	void Release(std::uint32_t offset, std::uint32_t size) {
+		used -= size;
+		if (size == 0)
+		{
+			return;
+		}
+		auto next = free.lower_bound(offset);
+		if (next != free.end() && offset + size == next->first)
+		{
+			size += next->second;
+			next = free.erase(next);
+		}
+		if (next != free.begin())
+		{
+			const auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += size;
+				return;
+			}
+		}
+		free.emplace(offset, size);
+	}
+
+	// Forget every allocation, leaving one range of everything after the first size elements
+	void Reset(std::uint32_t size) {
+		free.clear();
+		used = size;
+		if (size < capacity)
+		{
+			free.emplace(size, capacity - size);
+		}
+	}
+
+	std::uint32_t Capacity() const {
+		return capacity;
+	}
+	std::uint32_t Used() const {
+		return used;
+	}
+	std::uint32_t Largest() const {
+		std::uint32_t largest { 0 };
+		for (const auto& [offset, size] : free)
+		{
+			largest = std::max(largest, size);
+		}
+		return largest;
+	}
+	std::size_t Ranges() const {
+		return free.size();
+	}
+
+	// Whether every allocation is at the start, with nothing free in between
+	bool Packed() const {
+		return free.empty() || (free.size() == 1 && free.begin()->first + free.begin()->second == capacity);
+	}
+
+private:
+	std::uint32_t capacity;
+	std::uint32_t used { 0 };
+	std::map<std::uint32_t, std::uint32_t> free;    // offset -> size
+};
+
+// Sizes of the buffer pairs an arena creates
+struct MeshArenaOptions
+{
+	std::uint32_t blockVertices { 1u << 20 };   // vertices per vertex buffer
+	std::uint32_t blockIndices { 3u << 20 };    // 32-bit indices per index buffer
+};
+
+class MeshArena
+{
+public:
+	// Sets up the vertex attributes of the format, with the block's vertex buffer bound
+	using AttributeSetup = std::function<void()>;
+
+	// Where a mesh lives; offsets in vertices and indices
+	struct Mesh
+	{
+		int block { -1 };
+		std::uint32_t firstVertex { 0 };
+		std::uint32_t vertexCount { 0 };
+		std::uint32_t firstIndex { 0 };
+		std::uint32_t indexCount { 0 };
+	};
+
+	MeshArena(std::size_t vertexStride, AttributeSetup attributes, const MeshArenaOptions& options = {})
+		: stride(vertexStride), attributes(std::move(attributes)), options(options) {
+	}
+
+	~MeshArena() {
+		for (auto& block : blocks)
+		{
+			DeleteBlock(block);
+		}
+	}
+
+	MeshArena(const MeshArena&) = delete;
+	MeshArena& operator=(const MeshArena&) = delete;
+
+	// Copy a mesh in, indices counted from its own first vertex; returns its id,
+	// or -1 if it is bigger than a whole block
+	int Add(const void* vertices, std::uint32_t vertexCount, const std::uint32_t* indices, std::uint32_t indexCount) {
+		if (vertexCount > options.blockVertices || indexCount > options.blockIndices)
+		{
+			std::cout << "ERROR::MESH_ARENA::MESH_TOO_LARGE " << vertexCount << " vertices, " << indexCount << " indices\n";
+			return -1;
+		}
+		Mesh mesh;
+		mesh.vertexCount = vertexCount;
+		mesh.indexCount = indexCount;
+		for (std::size_t i = 0; i <= blocks.size() && mesh.block < 0; i++)
+		{
+			if (i == blocks.size())
+			{
+				blocks.push_back(CreateBlock());
+			}
+			auto& block = blocks[i];
+			const std::uint32_t firstVertex = block.vertices.Allocate(vertexCount);
+			if (firstVertex == RangeAllocator::Invalid)
+			{
+				continue;
+			}
+			const std::uint32_t firstIndex = block.indices.Allocate(indexCount);
+			if (firstIndex == RangeAllocator::Invalid)
+			{
+				block.vertices.Release(firstVertex, vertexCount);
+				continue;
+			}
+			mesh.block = static_cast<int>(i);
+			mesh.firstVertex = firstVertex;
+			mesh.firstIndex = firstIndex;
+		}
+
+		const auto& block = blocks[static_cast<std::size_t>(mesh.block)];
+		glBindBuffer(GL_COPY_WRITE_BUFFER, block.VBO);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(mesh.firstVertex * stride),
+			static_cast<GLsizeiptr>(vertexCount * stride), vertices);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, block.EBO);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(mesh.firstIndex * sizeof(std::uint32_t)),
+			static_cast<GLsizeiptr>(indexCount * sizeof(std::uint32_t)), indices);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		bufferBinds += 3;
+
+		int id;
+		if (!unused.empty())
+		{
+			id = unused.back();
+			unused.pop_back();
+			meshes[static_cast<std::size_t>(id)] = mesh;
+		}
+		else
+		{
+			id = static_cast<int>(meshes.size());
+			meshes.push_back(mesh);
+		}
+		return id;
+	}
+
+	// Free a mesh's ranges; the id may be handed out again
+	void Remove(int id) {
+		auto& mesh = meshes[static_cast<std::size_t>(id)];
+		if (mesh.block < 0)
+		{
+			return;
+		}
+		auto& block = blocks[static_cast<std::size_t>(mesh.block)];
+		block.vertices.Release(mesh.firstVertex, mesh.vertexCount);
+		block.indices.Release(mesh.firstIndex, mesh.indexCount);
+		mesh = {};
+		unused.push_back(id);
+	}
+
+	// Forget which block is bound; call at the start of a frame, or after other code binds a vertex array
+	void Begin() {
+		bound = -1;
+	}
+
+	// Bind a mesh's block if it is not already bound, and draw it
+	void Draw(int id) {
+		const auto& mesh = meshes[static_cast<std::size_t>(id)];
+		if (mesh.block < 0)
+		{
+			return;
+		}
+		if (mesh.block != bound)
+		{
+			glBindVertexArray(blocks[static_cast<std::size_t>(mesh.block)].VAO);
+			bound = mesh.block;
+			vertexArrayBinds++;
+		}
+		glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), GL_UNSIGNED_INT,
+			(void*)(static_cast<std::size_t>(mesh.firstIndex) * sizeof(std::uint32_t)), static_cast<GLint>(mesh.firstVertex));
+		draws++;
+	}
+
+	// Delete every block and forget every mesh; for shutdown
+	void Clear() {
+		for (auto& block : blocks)
+		{
+			DeleteBlock(block);
+		}
+		blocks.clear();
+		meshes.clear();
+		unused.clear();
+		bound = -1;
+	}
+
+	// Where a mesh is now; Compact() moves meshes, so look this up again afterwards
+	const Mesh& Get(int id) const {
+		return meshes[static_cast<std::size_t>(id)];
+	}
+
+	// Copy every mesh, on the GPU, into as few freshly packed blocks as will hold them
+	void Compact() {
+		std::vector<Block> packed;
+		std::uint32_t vertexHead { 0 }, indexHead { 0 };
+		for (auto& mesh : meshes)
+		{
+			if (mesh.block < 0)
+			{
+				continue;
+			}
+			if (packed.empty() || vertexHead + mesh.vertexCount > options.blockVertices
+				|| indexHead + mesh.indexCount > options.blockIndices)
+			{
+				if (!packed.empty())
+				{
+					packed.back().vertices.Reset(vertexHead);
+					packed.back().indices.Reset(indexHead);
+				}
+				packed.push_back(CreateBlock());
+				vertexHead = indexHead = 0;
+			}
+			// a buffer cannot copy onto an overlapping part of itself, so always into a new one
+			const auto& from = blocks[static_cast<std::size_t>(mesh.block)];
+			const auto& to = packed.back();
+			glBindBuffer(GL_COPY_READ_BUFFER, from.VBO);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, to.VBO);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(mesh.firstVertex * stride),
+				static_cast<GLintptr>(vertexHead * stride), static_cast<GLsizeiptr>(mesh.vertexCount * stride));
+			glBindBuffer(GL_COPY_READ_BUFFER, from.EBO);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, to.EBO);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				static_cast<GLintptr>(mesh.firstIndex * sizeof(std::uint32_t)),
+				static_cast<GLintptr>(indexHead * sizeof(std::uint32_t)),
+				static_cast<GLsizeiptr>(mesh.indexCount * sizeof(std::uint32_t)));
+			bufferBinds += 4;
+			mesh.block = static_cast<int>(packed.size() - 1);
+			mesh.firstVertex = vertexHead;
+			mesh.firstIndex = indexHead;
+			vertexHead += mesh.vertexCount;
+			indexHead += mesh.indexCount;
+		}
+		if (!packed.empty())
+		{
+			packed.back().vertices.Reset(vertexHead);
+			packed.back().indices.Reset(indexHead);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		for (auto& block : blocks)
+		{
+			DeleteBlock(block);
+		}
+		blocks = std::move(packed);
+		bound = -1;
+		compactions++;
+	}
+
+	// Share of the free space not in the largest free range, worst of vertices and indices
+	// over every block; 0 when each block's free space is one range
+	double Fragmentation() const {
+		double worst { 0.0 };
+		for (const auto& block : blocks)
+		{
+			for (const RangeAllocator* ranges : { &block.vertices, &block.indices })
+			{
+				const std::uint32_t free = ranges->Capacity() - ranges->Used();
+				if (free > 0)
+				{
+					worst = std::max(worst, 1.0 - static_cast<double>(ranges->Largest()) / free);
+				}
+			}
+		}
+		return worst;
+	}
+
+	// Statistics
+	std::size_t Blocks() const {
+		return blocks.size();
+	}
+	std::size_t Meshes() const {
+		return meshes.size() - unused.size();
+	}
+	std::size_t UsedBytes() const {
+		std::size_t bytes { 0 };
+		for (const auto& block : blocks)
+		{
+			bytes += block.vertices.Used() * stride + block.indices.Used() * sizeof(std::uint32_t);
+		}
+		return bytes;
+	}
+	std::size_t CapacityBytes() const {
+		return blocks.size() * (options.blockVertices * stride + options.blockIndices * sizeof(std::uint32_t));
+	}
+	std::uint64_t VertexArrayBinds() const {
+		return vertexArrayBinds;
+	}
+	std::uint64_t BufferBinds() const {
+		return bufferBinds;
+	}
+	std::uint64_t Draws() const {
+		return draws;
+	}
+	void ResetStatistics() {
+		vertexArrayBinds = 0;
+		bufferBinds = 0;
+		draws = 0;
+	}
+	void Print() const {
+		std::cout << "MeshArena: " << Meshes() << " meshes in " << blocks.size() << " blocks, " << UsedBytes() / 1024
+			<< " of " << CapacityBytes() / 1024 << " KB used, " << static_cast<int>(Fragmentation() * 100.0)
+			<< "% fragmented, " << compactions << " compactions\n";
+	}
+
+private:
+	// One vertex/index buffer pair and the vertex array that reads it
+	struct Block
+	{
+		unsigned int VAO { 0 };
+		unsigned int VBO { 0 };
+		unsigned int EBO { 0 };
+		RangeAllocator vertices;
+		RangeAllocator indices;
+	};
+
+	Block CreateBlock() {
+		Block block;
+		block.vertices = RangeAllocator(options.blockVertices);
+		block.indices = RangeAllocator(options.blockIndices);
+		glGenVertexArrays(1, &block.VAO);
+		glGenBuffers(1, &block.VBO);
+		glGenBuffers(1, &block.EBO);
+		glBindVertexArray(block.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, block.VBO);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(options.blockVertices * stride), nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(options.blockIndices * sizeof(std::uint32_t)), nullptr,
+			GL_STATIC_DRAW);
+		attributes();
+		glBindVertexArray(0);
+		bufferBinds += 2;
+		bound = -1;
+		return block;
+	}
+
+	static void DeleteBlock(Block& block) {
+		if (block.VAO != 0)
+		{
+			glDeleteVertexArrays(1, &block.VAO);
+			glDeleteBuffers(1, &block.VBO);
+			glDeleteBuffers(1, &block.EBO);
+		}
+		block.VAO = block.VBO = block.EBO = 0;
+	}
+
+	std::size_t stride;
+	AttributeSetup attributes;
+	MeshArenaOptions options;
+	std::vector<Block> blocks;
+	std::vector<Mesh> meshes;
+	std::vector<int> unused;
+	int bound { -1 };
+	std::uint64_t vertexArrayBinds { 0 };
+	std::uint64_t bufferBinds { 0 };
+	std::uint64_t draws { 0 };
+	unsigned int compactions { 0 };
+};
+
+#endif
@@ -0,0 +1,343 @@
+// Meshes.cpp
+//
+// Thousands of small meshes, each a textured polygon with its own number of
+// sides, drawn either from a MeshArena (a few shared buffer pairs, one VAO
+// each, glDrawElementsBaseVertex per mesh) or the way the other examples do
+// it, with a VAO, VBO and EBO per mesh. Every frame a few meshes are replaced
+// by new ones of a different size, which fragments the arena over time
+//
+// SPACE switches between the two, C compacts the arena, and the CPU time,
+// binds and fragmentation are reported once a second
+//
+// Usage: Meshes.bin [meshes] [replaced per frame]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "MeshArena.h"
+#include "TextureCache.h"
+#include "Timeline.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 800 };
+
+	// Defaults, overridable from the command line
+	constexpr int DefaultMeshes { 5000 };
+	constexpr int DefaultReplaced { 20 };
+
+	// Small blocks, so a few thousand meshes spread over several of them
+	constexpr MeshArenaOptions ArenaOptions { 1u << 16, 3u << 16 };
+
+	// Draw from the arena, or from a vertex array per mesh
+	bool useArena { true };
+	bool compact { false };
+
+	using Clock = std::chrono::steady_clock;
+
+	// The vertex format of vs/sprite.c
+	struct Vertex
+	{
+		float x, y;
+		float u, v;
+	};
+
+	// A polygon, as a triangle fan around its centre
+	struct Polygon
+	{
+		std::vector<Vertex> vertices;
+		std::vector<std::uint32_t> indices;
+	};
+
+	Polygon MakePolygon(float x, float y, float radius, int sides)
+	{
+		Polygon polygon;
+		polygon.vertices.push_back({ x, y, 0.5f, 0.5f });
+		for (int i = 0; i < sides; i++)
+		{
+			const float angle = 6.2831853f * static_cast<float>(i) / static_cast<float>(sides);
+			const float c = std::cos(angle), s = std::sin(angle);
+			polygon.vertices.push_back({ x + radius * c, y + radius * s, 0.5f + 0.5f * c, 0.5f + 0.5f * s });
+			polygon.indices.push_back(0);
+			polygon.indices.push_back(static_cast<std::uint32_t>(i + 1));
+			polygon.indices.push_back(static_cast<std::uint32_t>((i + 1) % sides + 1));
+		}
+		return polygon;
+	}
+
+	// The attributes of Vertex, for whichever vertex buffer is bound
+	void VertexAttributes()
+	{
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+	}
+
+	// A mesh the old way: its own vertex array and buffers
+	struct Separate
+	{
+		unsigned int VAO { 0 };
+		unsigned int VBO { 0 };
+		unsigned int EBO { 0 };
+		GLsizei count { 0 };
+	};
+} // anonymous namespace
+
+// Callback function definitions
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("Meshes");
+	TIMELINE_BEGIN("startup");
+
+	const int count { (argc > 1) ? std::max(1, std::atoi(argv[1])) : DefaultMeshes };
+	const int replaced { (argc > 2) ? std::clamp(std::atoi(argv[2]), 0, count) : DefaultReplaced };
+
+	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "Meshes", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Set some callback functions
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetKeyCallback(window, key_callback);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	// Build and compile our shader programs
+	Shader ourShader = Shader::Load("vs/sprite.c", "fs/quad.c");
+	ourShader.use();
+	ourShader.setInt("material", 0);
+
+	// Every mesh is a polygon in its own grid cell, with 3 to 32 sides
+	const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+	const float cell = 2.0f / static_cast<float>(columns);
+	std::mt19937 random(1);
+	auto polygonFor = [&](int i) {
+		const float x = -1.0f + cell * (static_cast<float>(i % columns) + 0.5f);
+		const float y = -1.0f + cell * (static_cast<float>(i / columns) + 0.5f);
+		return MakePolygon(x, y, cell * 0.45f, 3 + static_cast<int>(random() % 30));
+	};
+
+	// Both ways of holding them, so either can be drawn
+	TIMELINE_BEGIN("meshes");
+	MeshArena arena(sizeof(Vertex), VertexAttributes, ArenaOptions);
+	std::vector<int> ids(static_cast<std::size_t>(count));
+	std::vector<Separate> separate(static_cast<std::size_t>(count));
+	auto upload = [](Separate& mesh, const Polygon& polygon) {
+		glBindVertexArray(mesh.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(polygon.vertices.size() * sizeof(Vertex)), polygon.vertices.data(),
+			GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(polygon.indices.size() * sizeof(std::uint32_t)),
+			polygon.indices.data(), GL_STATIC_DRAW);
+		mesh.count = static_cast<GLsizei>(polygon.indices.size());
+	};
+	for (int i = 0; i < count; i++)
+	{
+		const auto polygon = polygonFor(i);
+		ids[static_cast<std::size_t>(i)] = arena.Add(polygon.vertices.data(), static_cast<std::uint32_t>(polygon.vertices.size()),
+			polygon.indices.data(), static_cast<std::uint32_t>(polygon.indices.size()));
+		auto& mesh = separate[static_cast<std::size_t>(i)];
+		glGenVertexArrays(1, &mesh.VAO);
+		glGenBuffers(1, &mesh.VBO);
+		glGenBuffers(1, &mesh.EBO);
+		upload(mesh, polygon);
+		VertexAttributes();
+	}
+	glBindVertexArray(0);
+	TIMELINE_END();
+	arena.Print();
+
+	// The texture every polygon shows
+	auto& textures = TextureCache::Instance();
+	const auto texture = textures.Acquire(std::filesystem::path(TEXTURE_DIR) / "container.jpg");
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
+	// Render loop
+	auto reported = Clock::now();
+	int frames { 0 };
+	double submitMs { 0.0 };
+	std::uint64_t vertexArrayBinds { 0 };
+	std::uint64_t bufferBinds { 0 };
+	int next { 0 };
+	while (!glfwWindowShouldClose(window))
+	{
+		// Upload a little more of the texture while it is loading
+		textures.Update();
+
+		// Replace a few meshes with new ones of a different size
+		for (int r = 0; r < replaced; r++)
+		{
+			const int i = next;
+			next = (next + 1) % count;
+			const auto polygon = polygonFor(i);
+			arena.Remove(ids[static_cast<std::size_t>(i)]);
+			ids[static_cast<std::size_t>(i)] = arena.Add(polygon.vertices.data(), static_cast<std::uint32_t>(polygon.vertices.size()),
+				polygon.indices.data(), static_cast<std::uint32_t>(polygon.indices.size()));
+			upload(separate[static_cast<std::size_t>(i)], polygon);
+			bufferBinds += useArena ? 0 : 2;
+		}
+		glBindVertexArray(0);
+		if (compact)
+		{
+			arena.Compact();
+			arena.Print();
+			compact = false;
+		}
+
+		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		ourShader.use();
+		texture.Bind(0);
+
+		// Time only issuing the draws
+		const auto start = Clock::now();
+		if (useArena)
+		{
+			arena.Begin();
+			for (const int id : ids)
+			{
+				arena.Draw(id);
+			}
+		}
+		else
+		{
+			for (const auto& mesh : separate)
+			{
+				glBindVertexArray(mesh.VAO);
+				glDrawElements(GL_TRIANGLES, mesh.count, GL_UNSIGNED_INT, 0);
+			}
+			vertexArrayBinds += separate.size();
+		}
+		const std::chrono::duration<double, std::milli> submitted = Clock::now() - start;
+		submitMs += submitted.count();
+
+		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+
+		// Report once a second
+		frames++;
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - reported;
+		if (elapsed.count() >= 1000.0)
+		{
+			if (useArena)
+			{
+				vertexArrayBinds = arena.VertexArrayBinds();
+				bufferBinds = arena.BufferBinds();
+			}
+			std::ostringstream report;
+			report << (useArena ? "arena" : "vertex array per mesh") << ": " << std::fixed << std::setprecision(3)
+				<< submitMs / frames << " ms/frame drawing, " << elapsed.count() / frames << " ms/frame, "
+				<< vertexArrayBinds / frames << " vertex array binds/frame, " << bufferBinds / frames
+				<< " buffer binds/frame, " << std::setprecision(1) << arena.Fragmentation() * 100.0 << "% fragmented in "
+				<< arena.Blocks() << " blocks";
+			std::cout << report.str() << "\n";
+			glfwSetWindowTitle(window, report.str().c_str());
+			reported = Clock::now();
+			frames = 0;
+			submitMs = 0.0;
+			vertexArrayBinds = 0;
+			bufferBinds = 0;
+			arena.ResetStatistics();
+		}
+	}
+
+	// Clean up buffers
+	for (auto& mesh : separate)
+	{
+		glDeleteVertexArrays(1, &mesh.VAO);
+		glDeleteBuffers(1, &mesh.VBO);
+		glDeleteBuffers(1, &mesh.EBO);
+	}
+	arena.Print();
+	arena.Clear();
+	textures.Clear();
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
+
+// Callback function for key press
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS)
+	{
+		return;
+	}
+	switch (key)
+	{
+	// Quit
+	case GLFW_KEY_ESCAPE:
+	case GLFW_KEY_Q:
+		glfwSetWindowShouldClose(window, GL_TRUE);
+		break;
+	// Switch between the arena and a vertex array per mesh
+	case GLFW_KEY_SPACE:
+		useArena = !useArena;
+		break;
+	// Pack the arena again
+	case GLFW_KEY_C:
+		compact = true;
+		break;
+	default:
+		break;
+	}
+}
+
+// Callback function for window resize
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+	glViewport(0, 0, width, height);
+}
@@ -0,0 +1,385 @@
+// MipGenerator.h
+//
+// Header-only CPU mip chain generation, for the texture loader and the baker
+// Each level is filtered from the one before in floating point, either with a
+// 2x2 box or with a separable 4-tap tent (1 3 3 1) that aliases much less, and
+// sRGB colour is converted to linear first so dark and bright texels average
+// correctly; alpha is always linear
+//
+// The row passes use AVX2 when the CPU has it and SSE2 otherwise (chosen at run
+// time, so the same binary runs anywhere), and large levels are split across
+// threads by rows
+
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Texture.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIP_GENERATOR_X86
+#include <immintrin.h>
+#endif
+
+class MipGenerator
+{
+public:
+	// One generated level
+	struct Level
+	{
+		int width { 0 };
+		int height { 0 };
+		std::size_t stride { 0 };   // bytes per row
+		std::vector<unsigned char> pixels;
+	};
+
+	// How to filter
+	struct Options
+	{
+		MipFilter filter { MipFilter::Box };
+		bool srgb { false };         // colour channels hold sRGB values
+		std::size_t alignment { 4 }; // rows of the output are padded to this
+		unsigned int threads { 0 };  // 0 for one per hardware thread
+	};
+
+	// Bytes per row of a level
+	static std::size_t Stride(int width, int channels, std::size_t alignment) {
+		const std::size_t bytes = static_cast<std::size_t>(width) * static_cast<std::size_t>(channels);
+		return (bytes + alignment - 1) / alignment * alignment;
+	}
+
+	// The next level down from an image of 1-4 channels
+	static Level Downsample(const unsigned char* pixels, int width, int height, int channels, std::size_t stride,
+		const Options& options) {
+		Level level;
+		level.width = std::max(1, width / 2);
+		level.height = std::max(1, height / 2);
+		level.stride = Stride(level.width, channels, options.alignment);
+		level.pixels.resize(level.stride * static_cast<std::size_t>(level.height));
+
+		const Source source { pixels, width, height, channels, stride };
+		unsigned int threads = (options.threads != 0) ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+		// small levels are not worth a thread
+		const std::size_t texels = static_cast<std::size_t>(level.width) * static_cast<std::size_t>(level.height);
+		threads = static_cast<unsigned int>(std::min<std::size_t>({ threads, texels / MinTexelsPerThread + 1,
+			static_cast<std::size_t>(level.height) }));
+		if (threads <= 1)
+		{
+			Rows(source, level, options, 0, level.height);
+			return level;
+		}
+		std::vector<std::thread> workers;
+		for (unsigned int t = 0; t < threads; t++)
+		{
+			const int first = level.height * static_cast<int>(t) / static_cast<int>(threads);
+			const int last = level.height * static_cast<int>(t + 1) / static_cast<int>(threads);
+			workers.emplace_back([&, first, last]() { Rows(source, level, options, first, last); });
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		return level;
+	}
+
+	// Every level below level 0, down to 1x1
+	static std::vector<Level> Chain(const unsigned char* pixels, int width, int height, int channels, std::size_t stride,
+		const Options& options) {
+		std::vector<Level> levels;
+		while (width > 1 || height > 1)
+		{
+			levels.push_back(Downsample(pixels, width, height, channels, stride, options));
+			const auto& level = levels.back();
+			pixels = level.pixels.data();
+			width = level.width;
+			height = level.height;
+			stride = level.stride;
+		}
+		return levels;
+	}
+
+	// Upload a chain into levels 1 and up of the bound texture, whose storage already has them
+	static void Upload(const std::vector<Level>& levels, int channels) {
+		for (std::size_t i = 0; i < levels.size(); i++)
+		{
+			const auto& level = levels[i];
+			const std::size_t alignment = (level.stride % 8 == 0) ? 8 : (level.stride % 4 == 0) ? 4 : (level.stride % 2 == 0) ? 2 : 1;
+			glPixelStorei(GL_UNPACK_ALIGNMENT, static_cast<GLint>(alignment));
+			glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), 0, 0, level.width, level.height, TextureFormat(channels),
+				GL_UNSIGNED_BYTE, level.pixels.data());
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	// Which row kernels this CPU runs
+	static const char* Kernel() {
+		switch (Isa())
+		{
+		case Simd::Avx2: return "AVX2";
+		case Simd::Sse2: return "SSE2";
+		default: return "scalar";
+		}
+	}
+
+private:
+	static constexpr std::size_t MinTexelsPerThread { 128 * 128 };
+
+	enum class Simd { None, Sse2, Avx2 };
+
+	struct Source
+	{
+		const unsigned char* pixels;
+		int width;
+		int height;
+		int channels;
+		std::size_t stride;
+	};
+
+	static Simd Isa() {
+#ifdef MIP_GENERATOR_X86
+		static const Simd isa = __builtin_cpu_supports("avx2") ? Simd::Avx2 : Simd::Sse2;
+		return isa;
+#else
+		return Simd::None;
+#endif
+	}
+
+	// Byte to float, through the sRGB curve or not
+	static const std::array<float, 256>& ToFloat(bool srgb) {
+		static const auto tables = []() {
+			std::array<std::array<float, 256>, 2> t {};
+			for (int i = 0; i < 256; i++)
+			{
+				const float c = static_cast<float>(i) / 255.0f;
+				t[0][static_cast<std::size_t>(i)] = c;
+				t[1][static_cast<std::size_t>(i)] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return t;
+		}();
+		return tables[srgb ? 1 : 0];
+	}
+
+	// Linear float back to an sRGB byte, in 4096 steps
+	static constexpr int SrgbSteps { 4096 };
+	static const std::array<unsigned char, SrgbSteps>& ToSrgb() {
+		static const auto table = []() {
+			std::array<unsigned char, SrgbSteps> t {};
+			for (int i = 0; i < SrgbSteps; i++)
+			{
+				const float l = static_cast<float>(i) / (SrgbSteps - 1);
+				const float c = (l <= 0.0031308f) ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+				t[static_cast<std::size_t>(i)] = static_cast<unsigned char>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	// Whether a channel is colour rather than alpha
+	static bool IsColour(int channel, int channels) {
+		return !((channels == 2 && channel == 1) || (channels == 4 && channel == 3));
+	}
+
+	// One source row as four floats a texel, whatever the channel count
+	static void Expand(const unsigned char* row, int width, int channels, bool srgb, float* out) {
+		const auto& colour = ToFloat(srgb);
+		const auto& alpha = ToFloat(false);
+		for (int x = 0; x < width; x++, row += channels, out += 4)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				out[c] = (c < channels) ? (IsColour(c, channels) ? colour : alpha)[row[c]] : 0.0f;
+			}
+		}
+	}
+
+	// acc += row * weight
+	static void Accumulate(float* acc, const float* row, float weight, std::size_t count) {
+		std::size_t i { 0 };
+#ifdef MIP_GENERATOR_X86
+		if (Isa() == Simd::Avx2)
+		{
+			i = AccumulateAvx2(acc, row, weight, count);
+		}
+		else
+		{
+			const __m128 w = _mm_set1_ps(weight);
+			for (; i + 4 <= count; i += 4)
+			{
+				_mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(row + i), w)));
+			}
+		}
+#endif
+		for (; i < count; i++)
+		{
+			acc[i] += row[i] * weight;
+		}
+	}
+
+	// One output texel from a filtered row, clamping at the edges
+	static void Texel(const float* acc, int width, int x, MipFilter filter, float* out) {
+		const auto at = [&](int i) { return acc + 4 * std::clamp(i, 0, width - 1); };
+		for (int c = 0; c < 4; c++)
+		{
+			if (filter == MipFilter::Tent)
+			{
+				out[c] = 0.125f * at(2 * x - 1)[c] + 0.375f * at(2 * x)[c] + 0.375f * at(2 * x + 1)[c] + 0.125f * at(2 * x + 2)[c];
+			}
+			else
+			{
+				out[c] = 0.5f * (at(2 * x)[c] + at(2 * x + 1)[c]);
+			}
+		}
+	}
+
+	// Halve a row horizontally; the SIMD kernels take the texels that need no clamping
+	static void Horizontal(const float* acc, int width, int outWidth, MipFilter filter, float* out) {
+		const bool tent = (filter == MipFilter::Tent);
+		const int first = tent ? 1 : 0;
+		const int last = tent ? (width - 3) / 2 + 1 : width / 2;   // one past the last unclamped texel
+		int x { 0 };
+		for (; x < std::min(first, outWidth); x++)
+		{
+			Texel(acc, width, x, filter, out + 4 * x);
+		}
+#ifdef MIP_GENERATOR_X86
+		if (Isa() == Simd::Avx2)
+		{
+			x = HorizontalAvx2(acc, x, std::min(last, outWidth), tent, out);
+		}
+		for (; x < std::min(last, outWidth); x++)
+		{
+			const float* t = acc + 8 * x;
+			__m128 sum;
+			if (tent)
+			{
+				const __m128 outer = _mm_add_ps(_mm_loadu_ps(t - 4), _mm_loadu_ps(t + 8));
+				const __m128 inner = _mm_add_ps(_mm_loadu_ps(t), _mm_loadu_ps(t + 4));
+				sum = _mm_add_ps(_mm_mul_ps(outer, _mm_set1_ps(0.125f)), _mm_mul_ps(inner, _mm_set1_ps(0.375f)));
+			}
+			else
+			{
+				sum = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(t), _mm_loadu_ps(t + 4)), _mm_set1_ps(0.5f));
+			}
+			_mm_storeu_ps(out + 4 * x, sum);
+		}
+#endif
+		for (; x < outWidth; x++)
+		{
+			Texel(acc, width, x, filter, out + 4 * x);
+		}
+	}
+
+	// Four floats a texel back to bytes
+	static void Pack(const float* in, int width, int channels, bool srgb, unsigned char* out) {
+		int x { 0 };
+#ifdef MIP_GENERATOR_X86
+		if (channels == 4 && !srgb)
+		{
+			// four texels at a time: scale, round, and narrow with saturation
+			const __m128 scale = _mm_set1_ps(255.0f);
+			const __m128 half = _mm_set1_ps(0.5f);
+			for (; x + 4 <= width; x += 4)
+			{
+				__m128i v[4];
+				for (int i = 0; i < 4; i++)
+				{
+					v[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + 4 * (x + i)), scale), half));
+				}
+				const __m128i words = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * x), words);
+			}
+		}
+#endif
+		const auto& toSrgb = ToSrgb();
+		for (; x < width; x++)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				const float v = std::clamp(in[4 * x + c], 0.0f, 1.0f);
+				out[channels * x + c] = (srgb && IsColour(c, channels))
+					? toSrgb[static_cast<std::size_t>(v * (SrgbSteps - 1) + 0.5f)]
+					: static_cast<unsigned char>(v * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	// Output rows [first, last): weight the source rows together, then halve across
+	static void Rows(const Source& source, Level& level, const Options& options, int first, int last) {
+		const bool tent = (options.filter == MipFilter::Tent);
+		const std::size_t floats = 4 * static_cast<std::size_t>(source.width);
+		std::vector<float> row(floats);
+		std::vector<float> acc(floats);
+		std::vector<float> out(4 * static_cast<std::size_t>(level.width));
+		static constexpr float BoxWeights[] { 0.5f, 0.5f };
+		static constexpr float TentWeights[] { 0.125f, 0.375f, 0.375f, 0.125f };
+		for (int y = first; y < last; y++)
+		{
+			std::fill(acc.begin(), acc.end(), 0.0f);
+			const int taps = tent ? 4 : 2;
+			for (int k = 0; k < taps; k++)
+			{
+				const int sy = std::clamp(2 * y + k - (tent ? 1 : 0), 0, source.height - 1);
+				Expand(source.pixels + static_cast<std::size_t>(sy) * source.stride, source.width, source.channels,
+					options.srgb, row.data());
+				Accumulate(acc.data(), row.data(), tent ? TentWeights[k] : BoxWeights[k], floats);
+			}
+			Horizontal(acc.data(), source.width, level.width, options.filter, out.data());
+			Pack(out.data(), level.width, source.channels, options.srgb,
+				level.pixels.data() + static_cast<std::size_t>(y) * level.stride);
+		}
+	}
+
+#ifdef MIP_GENERATOR_X86
+	__attribute__((target("avx2")))
+	static std::size_t AccumulateAvx2(float* acc, const float* row, float weight, std::size_t count) {
+		const __m256 w = _mm256_set1_ps(weight);
+		std::size_t i { 0 };
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(row + i), w)));
+		}
+		return i;
+	}
+
+	// Two output texels at a time: the 128-bit halves of neighbouring loads are
+	// regrouped so each lane pair lines up with the taps it needs
+	__attribute__((target("avx2")))
+	static int HorizontalAvx2(const float* acc, int x, int last, bool tent, float* out) {
+		for (; x + 2 <= last; x += 2)
+		{
+			const float* t = acc + 8 * x;
+			__m256 sum;
+			if (tent)
+			{
+				const __m256 a = _mm256_loadu_ps(t - 4);   // t[2x-1], t[2x]
+				const __m256 b = _mm256_loadu_ps(t + 4);   // t[2x+1], t[2x+2]
+				const __m256 c = _mm256_loadu_ps(t + 12);  // t[2x+3], t[2x+4]
+				const __m256 outer = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(b, c, 0x31));
+				const __m256 inner = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x31), _mm256_permute2f128_ps(b, c, 0x20));
+				sum = _mm256_add_ps(_mm256_mul_ps(outer, _mm256_set1_ps(0.125f)), _mm256_mul_ps(inner, _mm256_set1_ps(0.375f)));
+			}
+			else
+			{
+				const __m256 a = _mm256_loadu_ps(t);       // t[2x], t[2x+1]
+				const __m256 b = _mm256_loadu_ps(t + 8);   // t[2x+2], t[2x+3]
+				sum = _mm256_mul_ps(_mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31)),
+					_mm256_set1_ps(0.5f));
+			}
+			_mm256_storeu_ps(out + 4 * x, sum);
+		}
+		return x;
+	}
+#endif
+};
+
+#endif
@@ -0,0 +1,338 @@
+// MipmapBenchmark.cpp
+//
+// Compare building the mip chain on the CPU with MipGenerator (box and tent,
+// linear and sRGB) against glGenerateMipmap, for textures/container.jpg scaled
+// up to 4K and 8K
+// Speed is level 0 texels per second; quality is the PSNR of one level against
+// a Lanczos-3 downsample straight from level 0, taken in linear light for the
+// sRGB cases. An area average would be what the box filter computes exactly,
+// so it could only ever rank box first
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "MipGenerator.h"
+#include "Texture.h"
+#include "Timeline.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Sizes to test, and the level whose quality is measured
+	constexpr int Sizes[] { 4096, 8192 };
+	constexpr int QualityLevel { 3 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// An RGBA image
+	struct Image
+	{
+		int width { 0 };
+		int height { 0 };
+		std::vector<unsigned char> pixels;
+	};
+
+	// Bilinear upscale to size x size
+	Image Upscale(const unsigned char* pixels, int width, int height, int size)
+	{
+		Image image { size, size, std::vector<unsigned char>(static_cast<std::size_t>(size) * size * 4) };
+		for (int y = 0; y < size; y++)
+		{
+			const float fy = std::max(0.0f, (y + 0.5f) * height / size - 0.5f);
+			const int y0 = std::min(static_cast<int>(fy), height - 1);
+			const int y1 = std::min(y0 + 1, height - 1);
+			const float ty = fy - y0;
+			for (int x = 0; x < size; x++)
+			{
+				const float fx = std::max(0.0f, (x + 0.5f) * width / size - 0.5f);
+				const int x0 = std::min(static_cast<int>(fx), width - 1);
+				const int x1 = std::min(x0 + 1, width - 1);
+				const float tx = fx - x0;
+				for (int c = 0; c < 4; c++)
+				{
+					const auto at = [&](int px, int py) { return static_cast<float>(pixels[(static_cast<std::size_t>(py) * width + px) * 4 + c]); };
+					const float top = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * tx;
+					const float bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * tx;
+					image.pixels[(static_cast<std::size_t>(y) * size + x) * 4 + c] = static_cast<unsigned char>(top + (bottom - top) * ty + 0.5f);
+				}
+			}
+		}
+		return image;
+	}
+
+	// sRGB byte to linear light
+	double Linear(unsigned char value)
+	{
+		const double c = value / 255.0;
+		return (c <= 0.04045) ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+	}
+	unsigned char Encode(double linear)
+	{
+		const double c = (linear <= 0.0031308) ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+		return static_cast<unsigned char>(std::lround(std::clamp(c, 0.0, 1.0) * 255.0));
+	}
+
+	// Lanczos-3 windowed sinc
+	double Lanczos(double x)
+	{
+		constexpr double Pi { 3.14159265358979323846 };
+		x = std::abs(x);
+		if (x < 1e-9)
+		{
+			return 1.0;
+		}
+		if (x >= 3.0)
+		{
+			return 0.0;
+		}
+		return 3.0 * std::sin(Pi * x) * std::sin(Pi * x / 3.0) / (Pi * Pi * x * x);
+	}
+
+	// The source texels, and their normalized weights, behind each texel of a
+	// line shrunk by factor; the kernel is stretched to the output's spacing
+	struct Taps
+	{
+		int first { 0 };
+		std::vector<float> weights;
+	};
+	std::vector<Taps> Weights(int size, int factor)
+	{
+		std::vector<Taps> result(static_cast<std::size_t>(size / factor));
+		for (std::size_t i = 0; i < result.size(); i++)
+		{
+			const double centre = (static_cast<double>(i) + 0.5) * factor;
+			auto& taps = result[i];
+			taps.first = static_cast<int>(std::floor(centre - 3.0 * factor));
+			const int last = static_cast<int>(std::ceil(centre + 3.0 * factor));
+			double sum { 0.0 };
+			for (int source = taps.first; source < last; source++)
+			{
+				const double weight = Lanczos((source + 0.5 - centre) / factor);
+				taps.weights.push_back(static_cast<float>(weight));
+				sum += weight;
+			}
+			for (auto& weight : taps.weights)
+			{
+				weight = static_cast<float>(weight / sum);
+			}
+		}
+		return result;
+	}
+
+	// The reference for one level: level 0 shrunk by 2^level in one step with
+	// Lanczos-3, edges clamped; independent of both filters being measured
+	std::vector<unsigned char> Reference(const Image& image, int level, bool srgb)
+	{
+		const int factor = 1 << level;
+		const int width = image.width / factor;
+		const int height = image.height / factor;
+		float decode[2][256];
+		for (int value = 0; value < 256; value++)
+		{
+			decode[0][value] = static_cast<float>(srgb ? Linear(static_cast<unsigned char>(value)) : value / 255.0);
+			decode[1][value] = static_cast<float>(value / 255.0); // alpha is always linear
+		}
+		const auto columns = Weights(image.width, factor);
+		const auto rows = Weights(image.height, factor);
+
+		// across every source row
+		std::vector<float> across(static_cast<std::size_t>(image.height) * width * 4);
+		for (int y = 0; y < image.height; y++)
+		{
+			const unsigned char* row = image.pixels.data() + static_cast<std::size_t>(y) * image.width * 4;
+			for (int x = 0; x < width; x++)
+			{
+				const auto& taps = columns[static_cast<std::size_t>(x)];
+				float sum[4] {};
+				for (std::size_t k = 0; k < taps.weights.size(); k++)
+				{
+					const int source = std::clamp(taps.first + static_cast<int>(k), 0, image.width - 1);
+					for (int c = 0; c < 4; c++)
+					{
+						sum[c] += taps.weights[k] * decode[c == 3][row[source * 4 + c]];
+					}
+				}
+				std::copy(sum, sum + 4, across.begin() + (static_cast<std::ptrdiff_t>(y) * width + x) * 4);
+			}
+		}
+
+		// then down every column
+		std::vector<unsigned char> out(static_cast<std::size_t>(width) * height * 4);
+		for (int y = 0; y < height; y++)
+		{
+			const auto& taps = rows[static_cast<std::size_t>(y)];
+			for (int x = 0; x < width; x++)
+			{
+				double sum[4] {};
+				for (std::size_t k = 0; k < taps.weights.size(); k++)
+				{
+					const int source = std::clamp(taps.first + static_cast<int>(k), 0, image.height - 1);
+					for (int c = 0; c < 4; c++)
+					{
+						sum[c] += taps.weights[k] * across[(static_cast<std::size_t>(source) * width + x) * 4 + c];
+					}
+				}
+				for (int c = 0; c < 4; c++)
+				{
+					const double value = std::clamp(sum[c], 0.0, 1.0);
+					out[(static_cast<std::size_t>(y) * width + x) * 4 + c] = (srgb && c != 3)
+						? Encode(value) : static_cast<unsigned char>(std::lround(value * 255.0));
+				}
+			}
+		}
+		return out;
+	}
+
+	// Peak signal to noise ratio in dB; higher is closer
+	double Psnr(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+	{
+		double error { 0.0 };
+		for (std::size_t i = 0; i < a.size(); i++)
+		{
+			const double d = static_cast<double>(a[i]) - static_cast<double>(b[i]);
+			error += d * d;
+		}
+		error /= static_cast<double>(a.size());
+		return (error == 0.0) ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / error);
+	}
+
+	void Report(const std::string& name, const Image& image, double ms, double psnr)
+	{
+		const double texels = static_cast<double>(image.width) * image.height;
+		std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(9) << ms << " ms " << std::setw(9) << texels / (ms * 1000.0) << " Mtexel/s "
+			<< std::setw(7) << psnr << " dB\n" << std::defaultfloat;
+	}
+
+	// MipGenerator, timed, with the quality level checked
+	void Cpu(const std::string& name, const Image& image, const std::vector<unsigned char>& reference, MipFilter filter,
+		bool srgb, unsigned int threads)
+	{
+		MipGenerator::Options options;
+		options.filter = filter;
+		options.srgb = srgb;
+		options.threads = threads;
+		const auto start = Clock::now();
+		const auto levels = MipGenerator::Chain(image.pixels.data(), image.width, image.height, 4,
+			static_cast<std::size_t>(image.width) * 4, options);
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		Report(name, image, elapsed.count(), Psnr(levels[QualityLevel - 1].pixels, reference));
+	}
+
+	// glGenerateMipmap, timed from a finished level 0 upload, with the quality level read back
+	void Gpu(const std::string& name, const Image& image, const std::vector<unsigned char>& reference, bool srgb)
+	{
+		unsigned int texture { 0 };
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, TextureInternalFormat(4, srgb), image.width, image.height, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, image.pixels.data());
+		glFinish();
+		const auto start = Clock::now();
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glFinish();
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		std::vector<unsigned char> level(static_cast<std::size_t>(image.width >> QualityLevel) * (image.height >> QualityLevel) * 4);
+		glGetTexImage(GL_TEXTURE_2D, QualityLevel, GL_RGBA, GL_UNSIGNED_BYTE, level.data());
+		glDeleteTextures(1, &texture);
+		Report(name, image, elapsed.count(), Psnr(level, reference));
+	}
+} // anonymous namespace
+
+// Main function
+int main()
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("MipmapBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "MipmapBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+
+	// The source image, as RGBA
+	int width, height, channels;
+	const auto path = std::filesystem::path(TEXTURE_DIR) / "container.jpg";
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+	if (data == nullptr)
+	{
+		std::cout << "Failed to load texture " << path << "\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	int maxSize { 0 };
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	std::cout << "CPU kernels: " << MipGenerator::Kernel() << ", " << std::thread::hardware_concurrency() << " threads\n";
+	std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+	for (const int size : Sizes)
+	{
+		const auto image = Upscale(data, width, height, size);
+		// the references are built once per size, outside the timings
+		const auto linear = Reference(image, QualityLevel, false);
+		const auto srgb = Reference(image, QualityLevel, true);
+		std::cout << size << "x" << size << " (quality of level " << QualityLevel << " against Lanczos-3)\n";
+		Cpu("CPU box, 1 thread", image, linear, MipFilter::Box, false, 1);
+		Cpu("CPU box", image, linear, MipFilter::Box, false, 0);
+		Cpu("CPU tent", image, linear, MipFilter::Tent, false, 0);
+		Cpu("CPU box sRGB", image, srgb, MipFilter::Box, true, 0);
+		Cpu("CPU tent sRGB", image, srgb, MipFilter::Tent, true, 0);
+		if (size > maxSize)
+		{
+			std::cout << "  glGenerateMipmap skipped, GL_MAX_TEXTURE_SIZE is " << maxSize << "\n";
+			continue;
+		}
+		Gpu("glGenerateMipmap", image, linear, false);
+		Gpu("glGenerateMipmap sRGB", image, srgb, true);
+	}
+	stbi_image_free(data);
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+// PipelineBenchmark.cpp
+//
+// Compare building every pairing of N vertex and M fragment stage variants as
+// linked programs (N*M links) against separable stage programs combined into
+// cached pipelines (N+M compiles)
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "ShaderPipeline.h"
+#include "ShaderPreprocessor.h"
+#include "StageCache.h"
+#include "Timeline.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Default number of variants of each stage, overridable from the command line
+	constexpr int DefaultVertexVariants { 8 };
+	constexpr int DefaultFragmentVariants { 8 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// Defines that make every variant a distinct source
+	ShaderDefines Variant(int pass, int i)
+	{
+		return { { "VARIANT", std::to_string(pass * 100000 + i) } };
+	}
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("PipelineBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	// Usage: PipelineBenchmark.bin [vertex variants] [fragment variants]
+	const int vertexCount { (argc > 1) ? std::atoi(argv[1]) : DefaultVertexVariants };
+	const int fragmentCount { (argc > 2) ? std::atoi(argv[2]) : DefaultFragmentVariants };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "PipelineBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+	if (!PipelineCache::Available())
+	{
+		std::cout << "ARB_separate_shader_objects is not available\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	// Before: one linked program per pairing, with each stage variant compiled
+	// once and shared by every program it appears in, so only the links are N*M
+	auto start = Clock::now();
+	auto& stageCache = StageCache::Instance();
+	const auto compile = [&](GLenum type, const char* file, const ShaderDefines& defines) {
+		const auto source = ShaderPreprocessor::Process(file, defines);
+		return stageCache.Acquire(type, source.code, source.hash).object;
+	};
+	std::vector<unsigned int> vertexObjects;
+	std::vector<unsigned int> fragmentObjects;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		vertexObjects.push_back(compile(GL_VERTEX_SHADER, "vs/coordinates.c", Variant(0, v)));
+	}
+	for (int f = 0; f < fragmentCount; f++)
+	{
+		fragmentObjects.push_back(compile(GL_FRAGMENT_SHADER, "fs/transform.c", Variant(1, f)));
+	}
+	std::vector<unsigned int> programs;
+	for (const auto vertex : vertexObjects)
+	{
+		for (const auto fragment : fragmentObjects)
+		{
+			const unsigned int program { glCreateProgram() };
+			glAttachShader(program, vertex);
+			glAttachShader(program, fragment);
+			glLinkProgram(program);
+			Shader::checkCompileErrors(program, "PROGRAM");
+			glDetachShader(program, vertex);
+			glDetachShader(program, fragment);
+			programs.push_back(program);
+		}
+	}
+	const std::chrono::duration<double, std::milli> linked = Clock::now() - start;
+
+	// After: every stage once, then pipelines for all pairings
+	start = Clock::now();
+	auto& cache = PipelineCache::Instance();
+	std::vector<const Shader*> vertexStages;
+	std::vector<const Shader*> fragmentStages;
+	for (int v = 0; v < vertexCount; v++)
+	{
+		vertexStages.push_back(cache.Stage(GL_VERTEX_SHADER, "vs/coordinates.c", Variant(2, v)));
+	}
+	for (int f = 0; f < fragmentCount; f++)
+	{
+		fragmentStages.push_back(cache.Stage(GL_FRAGMENT_SHADER, "fs/transform.c", Variant(3, f)));
+	}
+	for (const auto* vertex : vertexStages)
+	{
+		for (const auto* fragment : fragmentStages)
+		{
+			if (vertex != nullptr && fragment != nullptr)
+			{
+				cache.Get(*vertex, *fragment);
+			}
+		}
+	}
+	// Make sure the driver has really finished, as it had to for the linked programs
+	glFinish();
+	const std::chrono::duration<double, std::milli> pipelined = Clock::now() - start;
+
+	// Report the results
+	std::cout << vertexCount << " vertex x " << fragmentCount << " fragment variants\n";
+	std::cout << "  linked programs : " << linked.count() << " ms (" << stageCache.Compiled() << " stage compiles, "
+		<< programs.size() << " links)\n";
+	std::cout << "  pipelines       : " << pipelined.count() << " ms (" << cache.Compiled() << " stage compiles)\n";
+	std::cout << "  speedup         : " << (linked.count() / pipelined.count()) << "x\n";
+	cache.Print();
+
+	// Clean up
+	for (const auto program : programs)
+	{
+		glDeleteProgram(program);
+	}
+	cache.Clear();
+	stageCache.Clear();
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,327 @@
+// PixelConvert.h
+//
+// Header-only decode post-processing: the vertical flip, an optional red/blue
+// swizzle, RGB to RGBA expansion, and row padding, all in one pass over each
+// row, written straight into an upload buffer (a mapped PBO, or one from
+// UploadPool); what comes out uploads with the default GL_UNPACK_ALIGNMENT
+//
+// RGB and RGBA rows are shuffled 8 texels at a time with AVX2, or 4 with
+// SSSE3, chosen at run time; everything else is a plain copy
+
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Texture.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXEL_CONVERT_X86
+#include <immintrin.h>
+#endif
+
+// What a decoded image turns into
+struct PixelConversion
+{
+	int channels { 4 };          // of the source, 1-4
+	bool flip { true };          // the first output row is the last source row
+	bool expand { true };        // RGB becomes RGBA, with opaque alpha
+	bool bgra { false };         // swap red and blue, for drivers that prefer BGRA
+	std::size_t alignment { 4 }; // output rows are padded to this
+};
+
+class PixelConvert
+{
+public:
+	// Channels per output texel
+	static int Channels(const PixelConversion& conversion) {
+		return (conversion.channels == 3 && conversion.expand) ? 4 : conversion.channels;
+	}
+
+	// The GL transfer format of the output
+	static GLenum Format(const PixelConversion& conversion) {
+		const int channels = Channels(conversion);
+		if (conversion.bgra && channels >= 3)
+		{
+			return (channels == 4) ? GL_BGRA : GL_BGR;
+		}
+		return TextureFormat(channels);
+	}
+
+	// Bytes per output row
+	static std::size_t Stride(int width, const PixelConversion& conversion) {
+		const std::size_t bytes = static_cast<std::size_t>(width) * static_cast<std::size_t>(Channels(conversion));
+		return (bytes + conversion.alignment - 1) / conversion.alignment * conversion.alignment;
+	}
+
+	// Output rows [first, first + rows) of a tightly packed image, into dst (row first at dst)
+	static void Rows(const unsigned char* src, int width, int height, const PixelConversion& conversion, int first,
+		int rows, unsigned char* dst) {
+		const std::size_t inStride = static_cast<std::size_t>(width) * static_cast<std::size_t>(conversion.channels);
+		const std::size_t outStride = Stride(width, conversion);
+		for (int row = 0; row < rows; row++)
+		{
+			const int target = first + row;
+			const int source = conversion.flip ? height - 1 - target : target;
+			Row(src + static_cast<std::size_t>(source) * inStride, width, conversion,
+				dst + static_cast<std::size_t>(row) * outStride);
+		}
+	}
+
+	// The whole image
+	static void Image(const unsigned char* src, int width, int height, const PixelConversion& conversion,
+		unsigned char* dst) {
+		Rows(src, width, height, conversion, 0, height, dst);
+	}
+
+	// Which kernels this CPU runs
+	static const char* Kernel() {
+		switch (Isa())
+		{
+		case Simd::Avx2: return "AVX2";
+		case Simd::Ssse3: return "SSSE3";
+		default: return "scalar";
+		}
+	}
+
+private:
+	enum class Simd { None, Ssse3, Avx2 };
+
+	static Simd Isa() {
+#ifdef PIXEL_CONVERT_X86
+		static const Simd isa = __builtin_cpu_supports("avx2") ? Simd::Avx2
+			: __builtin_cpu_supports("ssse3") ? Simd::Ssse3 : Simd::None;
+		return isa;
+#else
+		return Simd::None;
+#endif
+	}
+
+	// One row; the SIMD kernels do what they can and report how many texels that was
+	static void Row(const unsigned char* in, int width, const PixelConversion& conversion, unsigned char* out) {
+		const int inChannels = conversion.channels;
+		const int outChannels = Channels(conversion);
+		const bool swap = conversion.bgra && inChannels >= 3;
+		if (!swap && inChannels == outChannels)
+		{
+			std::memcpy(out, in, static_cast<std::size_t>(width) * static_cast<std::size_t>(inChannels));
+			return;
+		}
+		int x { 0 };
+#ifdef PIXEL_CONVERT_X86
+		if (inChannels >= 3)
+		{
+			if (Isa() == Simd::Avx2)
+			{
+				x = RowAvx2(in, width, inChannels, outChannels, swap, out);
+			}
+			else if (Isa() == Simd::Ssse3)
+			{
+				x = RowSsse3(in, width, inChannels, outChannels, swap, out);
+			}
+		}
+#endif
+		for (; x < width; x++)
+		{
+			const unsigned char* texel = in + x * inChannels;
+			unsigned char* result = out + x * outChannels;
+			result[0] = texel[swap ? 2 : 0];
+			result[1] = texel[1];
+			result[2] = texel[swap ? 0 : 2];
+			if (outChannels == 4)
+			{
+				result[3] = (inChannels == 4) ? texel[3] : 255;
+			}
+		}
+	}
+
+#ifdef PIXEL_CONVERT_X86
+	// Byte shuffle for four texels, with -1 for the alpha that has to be filled in
+	static __m128i Mask(int inChannels, int outChannels, bool swap) {
+		alignas(16) signed char mask[16];
+		for (int t = 0; t < 4; t++)
+		{
+			for (int c = 0; c < outChannels; c++)
+			{
+				const int from = (swap && c != 1 && c != 3) ? 2 - c : c;
+				mask[t * outChannels + c] = static_cast<signed char>((c < inChannels) ? t * inChannels + from : -1);
+			}
+		}
+		for (int i = 4 * outChannels; i < 16; i++)
+		{
+			mask[i] = -1;
+		}
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+	}
+
+	// Opaque alpha in the bytes a 3 to 4 expansion leaves empty
+	static __m128i Alpha(int inChannels, int outChannels) {
+		return (inChannels == 3 && outChannels == 4) ? _mm_set1_epi32(static_cast<int>(0xff000000u)) : _mm_setzero_si128();
+	}
+
+	// One past the last texel a step of the kernel may start at: its stores have to
+	// fit the row, and its 16 byte loads (the last starting lastLoad texels in)
+	// must not read past the end of the row, as the next row may not exist
+	static int SafeStarts(int width, int inChannels, int step, int lastLoad) {
+		const int bytes = width * inChannels - 16;
+		return (bytes < 0) ? 0 : std::max(0, std::min(bytes / inChannels + 1 - lastLoad, width - step + 1));
+	}
+
+	__attribute__((target("ssse3")))
+	static int RowSsse3(const unsigned char* in, int width, int inChannels, int outChannels, bool swap, unsigned char* out) {
+		if (outChannels != 4)
+		{
+			return 0;
+		}
+		const __m128i mask = Mask(inChannels, outChannels, swap);
+		const __m128i alpha = Alpha(inChannels, outChannels);
+		const int safe = SafeStarts(width, inChannels, 4, 0);
+		int x { 0 };
+		for (; x < safe; x += 4)
+		{
+			const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x * inChannels));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_or_si128(_mm_shuffle_epi8(texels, mask), alpha));
+		}
+		return x;
+	}
+
+	// The shuffle works within each 128-bit lane, so each lane gets its own four texels
+	__attribute__((target("avx2")))
+	static int RowAvx2(const unsigned char* in, int width, int inChannels, int outChannels, bool swap, unsigned char* out) {
+		if (outChannels != 4)
+		{
+			return 0;
+		}
+		const __m128i lane = Mask(inChannels, outChannels, swap);
+		const __m256i mask = _mm256_broadcastsi128_si256(lane);
+		const __m256i alpha = _mm256_broadcastsi128_si256(Alpha(inChannels, outChannels));
+		const int safe = SafeStarts(width, inChannels, 8, 4);
+		int x { 0 };
+		for (; x < safe; x += 8)
+		{
+			const unsigned char* texels = in + x * inChannels;
+			const __m256i both = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(texels))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + 4 * inChannels)), 1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x * 4), _mm256_or_si256(_mm256_shuffle_epi8(both, mask), alpha));
+		}
+		return x;
+	}
+#endif
+};
+
+// Reusable host memory for converted pixels, so repeated loads do not allocate
+class UploadPool
+{
+	struct Free
+	{
+		void operator()(unsigned char* data) const {
+			std::free(data);
+		}
+	};
+
+	struct Buffer
+	{
+		std::unique_ptr<unsigned char[], Free> data;
+		std::size_t size { 0 };
+	};
+
+public:
+	// A buffer on loan; goes back to the pool when destroyed
+	class Lease
+	{
+	public:
+		Lease() = default;
+		~Lease() {
+			if (pool != nullptr)
+			{
+				pool->Return(std::move(buffer));
+			}
+		}
+		Lease(Lease&& other) noexcept : pool(std::exchange(other.pool, nullptr)), buffer(std::move(other.buffer)) {
+		}
+		Lease& operator=(Lease&& other) noexcept {
+			std::swap(pool, other.pool);
+			std::swap(buffer, other.buffer);
+			return *this;
+		}
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+
+		unsigned char* data() const {
+			return buffer.data.get();
+		}
+		std::size_t size() const {
+			return buffer.size;
+		}
+
+	private:
+		friend class UploadPool;
+		Lease(UploadPool* pool, Buffer buffer) : pool(pool), buffer(std::move(buffer)) {
+		}
+		UploadPool* pool { nullptr };
+		Buffer buffer;
+	};
+
+	// One pool per process
+	static UploadPool& Instance() {
+		static UploadPool pool;
+		return pool;
+	}
+
+	// The smallest idle buffer that fits, or a new one
+	Lease Acquire(std::size_t bytes) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto best = idle.end();
+			for (auto it = idle.begin(); it != idle.end(); ++it)
+			{
+				if (it->size >= bytes && (best == idle.end() || it->size < best->size))
+				{
+					best = it;
+				}
+			}
+			if (best != idle.end())
+			{
+				Buffer buffer = std::move(*best);
+				idle.erase(best);
+				return Lease(this, std::move(buffer));
+			}
+		}
+		// cache line aligned, so the SIMD stores never straddle two lines more than they must
+		const std::size_t size = (std::max<std::size_t>(bytes, 1) + 63) / 64 * 64;
+		return Lease(this, Buffer { std::unique_ptr<unsigned char[], Free>(static_cast<unsigned char*>(std::aligned_alloc(64, size))), size });
+	}
+
+	// Free every idle buffer
+	void Trim() {
+		std::lock_guard<std::mutex> lock(mutex);
+		idle.clear();
+	}
+
+private:
+	UploadPool() = default;
+
+	void Return(Buffer buffer) {
+		if (!buffer.data)
+		{
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		idle.push_back(std::move(buffer));
+	}
+
+	std::mutex mutex;
+	std::vector<Buffer> idle;
+};
+
+#endif
@@ -0,0 +1,238 @@
+// ProgramCache.h
+//
+// Header-only on-disk cache of linked shader program binaries
+// https://www.khronos.org/opengl/wiki/Shader_Compilation#Binary_upload
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Where the binaries are kept, unless the build says otherwise
+#ifndef SHADER_CACHE_DIR
+#define SHADER_CACHE_DIR "shader_cache"
+#endif
+
+class ProgramCache
+{
+public:
+	using Key = std::uint64_t;
+
+	// One cache per process
+	static ProgramCache& Instance() {
+		static ProgramCache cache;
+		return cache;
+	}
+
+	// The driver has to support binaries, and offer at least one format
+	bool Enabled() {
+		if (!checked)
+		{
+			checked = true;
+			int formats { 0 };
+			if (GLAD_GL_ARB_get_program_binary)
+			{
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			}
+			enabled = (formats > 0);
+		}
+		return enabled;
+	}
+
+	// Turn the cache off, e.g. to measure real compile times
+	void SetEnabled(bool enable) {
+		checked = !enable;
+		enabled = false;
+	}
+
+	// Hash everything that can change the linked binary
+	static Key MakeKey(std::string_view vertexCode, std::string_view fragmentCode, std::string_view defines) {
+		Key hash { 14695981039346656037ull };
+		auto mix = [&hash](std::string_view text) {
+			for (const char c : text)
+			{
+				hash ^= static_cast<unsigned char>(c);
+				hash *= 1099511628211ull;
+			}
+			// separate the fields so "ab"+"c" differs from "a"+"bc"
+			hash ^= 0xff;
+			hash *= 1099511628211ull;
+		};
+		mix(vertexCode);
+		mix(fragmentCode);
+		mix(defines);
+		mix(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+		mix(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+		return hash;
+	}
+
+	// Ask the driver to keep the binary around; call before linking
+	void PrepareForLink(unsigned int program) {
+		if (Enabled())
+		{
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+
+	// Create a program from a cached binary, or return 0 on any mismatch
+	unsigned int Load(Key key) {
+		if (!Enabled())
+		{
+			return 0;
+		}
+		const auto start = Clock::now();
+		const auto path = PathFor(key);
+		std::ifstream file(path, std::ios::binary);
+		Header header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| header.magic != Magic || header.key != key)
+		{
+			misses++;
+			return 0;
+		}
+		// A corrupt length is a miss, not a huge allocation
+		std::error_code ec;
+		const auto size = std::filesystem::file_size(path, ec);
+		if (ec || size != sizeof(header) + header.length)
+		{
+			misses++;
+			return 0;
+		}
+		std::vector<char> binary(header.length);
+		if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size())))
+		{
+			misses++;
+			return 0;
+		}
+		const unsigned int program { glCreateProgram() };
+		glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+		int success { 0 };
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			// The driver changed underneath us, so the binary is stale
+			glDeleteProgram(program);
+			misses++;
+			return 0;
+		}
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		hits++;
+		savedMs += header.compileMs - elapsed.count();
+		std::cout << "Program cache hit " << PathFor(key).filename() << ": loaded in " << elapsed.count()
+			<< " ms, saved " << (header.compileMs - elapsed.count()) << " ms\n";
+		return program;
+	}
+
+	// Write a freshly linked program to disk, remembering how long it took to build
+	void Store(Key key, unsigned int program, double compileMs) {
+		if (!Enabled())
+		{
+			return;
+		}
+		int length { 0 };
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+		{
+			return;
+		}
+		Header header;
+		header.key = key;
+		header.length = static_cast<std::uint32_t>(length);
+		header.compileMs = compileMs;
+		std::vector<char> binary(header.length);
+		GLenum format { 0 };
+		glGetProgramBinary(program, length, nullptr, &format, binary.data());
+		header.format = format;
+
+		// Written next to the target and renamed, so a failed write never
+		// leaves a truncated binary behind for the next run to load
+		std::error_code ec;
+		std::filesystem::create_directories(Directory(), ec);
+		const auto path = PathFor(key);
+		auto temporary = path;
+		temporary += ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+			file.close();
+			if (!file)
+			{
+				std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED: " << path << "\n";
+				std::filesystem::remove(temporary, ec);
+				return;
+			}
+		}
+		std::filesystem::rename(temporary, path, ec);
+		if (ec)
+		{
+			std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED: " << path << ": " << ec.message() << "\n";
+			std::filesystem::remove(temporary, ec);
+			return;
+		}
+		std::cout << "Program cache miss " << PathFor(key).filename() << ": compiled in " << compileMs << " ms\n";
+	}
+
+	// Statistics
+	unsigned int Hits() const {
+		return hits;
+	}
+	unsigned int Misses() const {
+		return misses;
+	}
+	double SavedMs() const {
+		return savedMs;
+	}
+
+	// Print a one-line summary
+	void Print() const {
+		std::cout << "Program cache: " << hits << " hits, " << misses << " misses, saved " << savedMs << " ms\n";
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// "GLPB", bumped when the header layout changes
+	static constexpr std::uint32_t Magic { 0x42504c47 };
+
+	// Fixed-size header in front of every binary
+	struct Header
+	{
+		std::uint32_t magic { Magic };
+		std::uint32_t format { 0 };
+		Key key { 0 };
+		std::uint32_t length { 0 };
+		std::uint32_t reserved { 0 };
+		double compileMs { 0.0 };
+	};
+
+	ProgramCache() = default;
+
+	static std::filesystem::path Directory() {
+		return std::filesystem::path(SHADER_CACHE_DIR);
+	}
+	static std::filesystem::path PathFor(Key key) {
+		std::ostringstream name;
+		name << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+		return Directory() / name.str();
+	}
+
+	bool checked { false };
+	bool enabled { false };
+	unsigned int hits { 0 };
+	unsigned int misses { 0 };
+	double savedMs { 0.0 };
+};
+
+#endif
@@ -0,0 +1,336 @@
+// RenderQueue.h
+//
+// Header-only render queue that orders draws to change as little GL state as
+// possible. Programs, texture sets and vertex arrays are registered once for
+// a small id; every draw is then submitted as a 64-bit sort key built from
+// its pass, program, textures, vertex array and depth, plus the command
+// itself. Execute() radix sorts the keys and walks them, binding only what
+// differs from the draw before
+//
+//	RenderQueue queue;
+//	const int program = queue.AddProgram(shader.ID);
+//	const int textures = queue.AddTextures({ texture1, texture2 });
+//	const int vertexArray = queue.AddVertexArray(VAO);
+//	queue.Submit(RenderPass::Opaque, program, textures, vertexArray, depth, { 6 });
+//	queue.Execute([&](int program, std::uint32_t user) { /* per-draw uniforms */ });
+//
+// Opaque draws sort by state and then front to back, so early depth testing
+// rejects what is hidden; blended draws have to be drawn back to front, so
+// for them depth comes before state
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Passes are drawn in this order
+enum class RenderPass : std::uint8_t
+{
+	Opaque,     // depth tested and written, no blending
+	Blended,    // depth tested, not written, alpha blended
+};
+
+// What to draw once the state is set; indices are 32-bit
+struct DrawCommand
+{
+	GLsizei count { 0 };
+	std::uint32_t firstIndex { 0 };
+	GLint baseVertex { 0 };
+	std::uint32_t user { 0 };   // the caller's own index, handed back when the draw is made
+};
+
+class RenderQueue
+{
+public:
+	// Called before each draw with its program id and user value, for per-draw uniforms
+	using PerDraw = std::function<void(int program, std::uint32_t user)>;
+
+	// How many of each the key has room for
+	static constexpr int MaxPrograms { 1 << 10 };
+	static constexpr int MaxTextureSets { 1 << 12 };
+	static constexpr int MaxVertexArrays { 1 << 10 };
+
+	// Returned by the Add functions once a table is full; Submit() drops draws using it
+	static constexpr int Invalid { -1 };
+
+	// Register state once; the ids go into Submit()
+	int AddProgram(unsigned int program) {
+		return Register(programs, program, MaxPrograms, "PROGRAMS");
+	}
+	int AddTextures(std::initializer_list<unsigned int> textures) {
+		return Register(textureSets, std::vector<unsigned int>(textures), MaxTextureSets, "TEXTURE_SETS");
+	}
+	int AddVertexArray(unsigned int vertexArray) {
+		return Register(vertexArrays, vertexArray, MaxVertexArrays, "VERTEX_ARRAYS");
+	}
+
+	// Queue a draw; depth is the distance from the camera, 0 (near) to 1 (far)
+	void Submit(RenderPass pass, int program, int textures, int vertexArray, float depth, const DrawCommand& command) {
+		if (!Valid(program, programs) || !Valid(textures, textureSets) || !Valid(vertexArray, vertexArrays))
+		{
+			rejected++;
+			return;
+		}
+		items.push_back({ Key(pass, program, textures, vertexArray, depth), static_cast<std::uint32_t>(commands.size()) });
+		commands.push_back(command);
+	}
+
+	// Sort, draw everything queued this frame, and empty the queue
+	void Execute(const PerDraw& perDraw = {}) {
+		const auto start = Clock::now();
+		Sort();
+		sortTime += Clock::now() - start;
+
+		// Nothing is known to be bound yet
+		std::uint64_t previous { ~0ull };
+		int pass { -1 }, program { -1 }, textures { -1 }, vertexArray { -1 };
+		std::vector<unsigned int> bound;
+		for (const auto& item : items)
+		{
+			const std::uint64_t key = item.key;
+			if (key != previous)
+			{
+				const int nextPass = static_cast<int>(key >> PassShift);
+				if (nextPass != pass)
+				{
+					SetPass(static_cast<RenderPass>(nextPass));
+					pass = nextPass;
+					passChanges++;
+				}
+				const auto state = State(key);
+				if (state.program != program)
+				{
+					glUseProgram(programs[static_cast<std::size_t>(state.program)]);
+					program = state.program;
+					programChanges++;
+				}
+				if (state.textures != textures)
+				{
+					// rebind only the units whose texture differs
+					const auto& set = textureSets[static_cast<std::size_t>(state.textures)];
+					for (std::size_t unit = 0; unit < set.size(); unit++)
+					{
+						if (unit < bound.size() && bound[unit] == set[unit])
+						{
+							continue;
+						}
+						glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + unit));
+						glBindTexture(GL_TEXTURE_2D, set[unit]);
+						bound.resize(std::max(bound.size(), unit + 1));
+						bound[unit] = set[unit];
+						textureBinds++;
+					}
+					textures = state.textures;
+				}
+				if (state.vertexArray != vertexArray)
+				{
+					glBindVertexArray(vertexArrays[static_cast<std::size_t>(state.vertexArray)]);
+					vertexArray = state.vertexArray;
+					vertexArrayChanges++;
+				}
+				previous = key;
+			}
+			const auto& command = commands[item.command];
+			if (perDraw)
+			{
+				perDraw(program, command.user);
+			}
+			glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+				(void*)(static_cast<std::size_t>(command.firstIndex) * sizeof(std::uint32_t)), command.baseVertex);
+			draws++;
+		}
+		if (pass == static_cast<int>(RenderPass::Blended))
+		{
+			SetPass(RenderPass::Opaque);
+		}
+		items.clear();
+		commands.clear();
+	}
+
+	// Draw in submission order instead, for comparison
+	void SetSorting(bool enabled) {
+		sorting = enabled;
+	}
+
+	// Statistics
+	std::size_t Queued() const {
+		return items.size();
+	}
+	std::uint64_t Draws() const {
+		return draws;
+	}
+	std::uint64_t ProgramChanges() const {
+		return programChanges;
+	}
+	std::uint64_t TextureBinds() const {
+		return textureBinds;
+	}
+	std::uint64_t VertexArrayChanges() const {
+		return vertexArrayChanges;
+	}
+	std::uint64_t StateChanges() const {
+		return passChanges + programChanges + textureBinds + vertexArrayChanges;
+	}
+	// Draws dropped by Submit() for state that was never registered
+	std::uint64_t Rejected() const {
+		return rejected;
+	}
+	double SortMilliseconds() const {
+		return std::chrono::duration<double, std::milli>(sortTime).count();
+	}
+	void ResetStatistics() {
+		draws = passChanges = programChanges = textureBinds = vertexArrayChanges = rejected = 0;
+		sortTime = {};
+	}
+	void Print() const {
+		std::cout << "RenderQueue: " << draws << " draws, " << programChanges << " program changes, " << textureBinds
+			<< " texture binds, " << vertexArrayChanges << " vertex array changes, " << passChanges << " pass changes, "
+			<< rejected << " rejected, " << SortMilliseconds() << " ms sorting\n";
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Key layout, most significant first:
+	//   opaque:  pass:2 program:10 textures:12 vertexArray:10 depth:24 (near first)
+	//   blended: pass:2 depth:24 (far first) program:10 textures:12 vertexArray:10
+	static constexpr int PassShift { 62 };
+	static constexpr int DepthBits { 24 };
+	static constexpr int StateBits { 32 };
+	static constexpr std::uint64_t DepthMask { (1ull << DepthBits) - 1 };
+	static constexpr std::uint64_t StateMask { (1ull << StateBits) - 1 };
+
+	// One queued draw: its key, and where its command is
+	struct Item
+	{
+		std::uint64_t key;
+		std::uint32_t command;
+	};
+
+	// The state a key selects
+	struct Selected
+	{
+		int program;
+		int textures;
+		int vertexArray;
+	};
+
+	static std::uint64_t Key(RenderPass pass, int program, int textures, int vertexArray, float depth) {
+		const auto quantised = static_cast<std::uint64_t>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>(DepthMask));
+		const std::uint64_t state = (static_cast<std::uint64_t>(program) << 22) | (static_cast<std::uint64_t>(textures) << 10)
+			| static_cast<std::uint64_t>(vertexArray);
+		const std::uint64_t key = static_cast<std::uint64_t>(pass) << PassShift;
+		if (pass == RenderPass::Blended)
+		{
+			return key | ((DepthMask - quantised) << StateBits) | state;
+		}
+		return key | (state << (PassShift - StateBits)) | (quantised << (PassShift - StateBits - DepthBits));
+	}
+
+	static Selected State(std::uint64_t key) {
+		const auto pass = static_cast<RenderPass>(key >> PassShift);
+		const std::uint64_t state = (pass == RenderPass::Blended) ? (key & StateMask) : ((key >> (PassShift - StateBits)) & StateMask);
+		return { static_cast<int>(state >> 22) & (MaxPrograms - 1), static_cast<int>(state >> 10) & (MaxTextureSets - 1),
+			static_cast<int>(state) & (MaxVertexArrays - 1) };
+	}
+
+	static void SetPass(RenderPass pass) {
+		if (pass == RenderPass::Blended)
+		{
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_FALSE);
+		}
+		else
+		{
+			glDisable(GL_BLEND);
+			glDepthMask(GL_TRUE);
+		}
+	}
+
+	template <typename T>
+	static int Register(std::vector<T>& table, T value, int limit, const char* what) {
+		const auto found = std::find(table.begin(), table.end(), value);
+		if (found != table.end())
+		{
+			return static_cast<int>(found - table.begin());
+		}
+		if (static_cast<int>(table.size()) >= limit)
+		{
+			std::cout << "ERROR::RENDER_QUEUE::TOO_MANY_" << what << "\n";
+			return Invalid;
+		}
+		table.push_back(std::move(value));
+		return static_cast<int>(table.size() - 1);
+	}
+
+	// Whether an id came from the table, rather than Invalid or made up
+	template <typename T>
+	static bool Valid(int id, const std::vector<T>& table) {
+		return id >= 0 && id < static_cast<int>(table.size());
+	}
+
+	// Least significant digit radix sort, a byte at a time; bytes that are the
+	// same in every key are skipped, which for a few states is most of them
+	void Sort() {
+		if (!sorting || items.size() < 2)
+		{
+			return;
+		}
+		std::uint64_t differ { 0 };
+		for (const auto& item : items)
+		{
+			differ |= item.key ^ items.front().key;
+		}
+		scratch.resize(items.size());
+		for (int shift = 0; shift < 64; shift += 8)
+		{
+			if (((differ >> shift) & 0xFF) == 0)
+			{
+				continue;
+			}
+			std::array<std::size_t, 257> offsets {};
+			for (const auto& item : items)
+			{
+				offsets[((item.key >> shift) & 0xFF) + 1]++;
+			}
+			for (std::size_t digit = 1; digit < offsets.size(); digit++)
+			{
+				offsets[digit] += offsets[digit - 1];
+			}
+			for (const auto& item : items)
+			{
+				scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+			}
+			items.swap(scratch);
+		}
+	}
+
+	std::vector<unsigned int> programs;
+	std::vector<std::vector<unsigned int>> textureSets;
+	std::vector<unsigned int> vertexArrays;
+	std::vector<Item> items;
+	std::vector<Item> scratch;
+	std::vector<DrawCommand> commands;
+	bool sorting { true };
+	std::uint64_t draws { 0 };
+	std::uint64_t passChanges { 0 };
+	std::uint64_t programChanges { 0 };
+	std::uint64_t textureBinds { 0 };
+	std::uint64_t vertexArrayChanges { 0 };
+	std::uint64_t rejected { 0 };
+	Clock::duration sortTime {};
+};
+
+#endif
@@ -0,0 +1,264 @@
+// RenderQueueBenchmark.cpp
+//
+// Measure the state changes and CPU time of 100k draws a frame (by default),
+// each with a random program, texture and vertex array out of a few of each,
+// a random depth, and one in ten alpha blended, issued three ways: setting
+// every piece of state for every draw, the way the examples' render loops
+// do; through a RenderQueue in submission order, which only skips state that
+// is already bound; and through a RenderQueue sorted by key
+//
+// Usage: RenderQueueBenchmark.bin [frames] [draws]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "RenderQueue.h"
+#include "Texture.h"
+#include "Timeline.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Defaults, overridable from the command line
+	constexpr int DefaultFrames { 50 };
+	constexpr int DefaultDraws { 100000 };
+
+	// How many of each piece of state the draws choose from
+	constexpr int Programs { 8 };
+	constexpr int Textures { 32 };
+	constexpr int VertexArrays { 8 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// One draw, before it is issued
+	struct Draw
+	{
+		RenderPass pass;
+		int program;
+		int texture;
+		int vertexArray;
+		float depth;
+		glm::vec4 quad;
+	};
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("RenderQueueBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	const int frames { (argc > 1) ? std::max(1, std::atoi(argv[1])) : DefaultFrames };
+	const int drawCount { (argc > 2) ? std::max(1, std::atoi(argv[2])) : DefaultDraws };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "RenderQueueBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+
+	RenderQueue queue;
+
+	// Programs that only differ by a define, so each is a separate program object
+	std::vector<Shader> shaders;
+	std::vector<Uniform> quadLocs;
+	for (int i = 0; i < Programs; i++)
+	{
+		shaders.push_back(Shader::Load("vs/quad.c", "fs/quad.c", { { "VARIANT", std::to_string(i) } }));
+		shaders.back().use();
+		shaders.back().setInt("material", 0);
+		quadLocs.push_back(shaders.back().uniform("quad"));
+		queue.AddProgram(shaders.back().ID);
+	}
+
+	// Small textures of one colour each
+	std::vector<unsigned int> textures(Textures);
+	glGenTextures(Textures, textures.data());
+	for (int i = 0; i < Textures; i++)
+	{
+		const unsigned char colour[4] { static_cast<unsigned char>(i * 8), static_cast<unsigned char>(255 - i * 8), 128, 200 };
+		std::vector<unsigned char> pixels;
+		for (int texel = 0; texel < 16; texel++)
+		{
+			pixels.insert(pixels.end(), colour, colour + 4);
+		}
+		glBindTexture(GL_TEXTURE_2D, textures[static_cast<std::size_t>(i)]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		TextureStorage(GL_TEXTURE_2D, 1, 4, false, 4, 4);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		queue.AddTextures({ textures[static_cast<std::size_t>(i)] });
+	}
+
+	// The unit quad of vs/quad.c, in vertex arrays of their own
+	constexpr float Corners[] = {
+	// positions   // texture coords
+		0.0f, 0.0f,   0.0f, 0.0f,
+		1.0f, 0.0f,   1.0f, 0.0f,
+		1.0f, 1.0f,   1.0f, 1.0f,
+		0.0f, 1.0f,   0.0f, 1.0f,
+	};
+	constexpr std::uint32_t Indices[] = { 0, 1, 2, 0, 2, 3 };
+	std::vector<unsigned int> VAOs(VertexArrays), VBOs(VertexArrays), EBOs(VertexArrays);
+	glGenVertexArrays(VertexArrays, VAOs.data());
+	glGenBuffers(VertexArrays, VBOs.data());
+	glGenBuffers(VertexArrays, EBOs.data());
+	for (std::size_t i = 0; i < VAOs.size(); i++)
+	{
+		glBindVertexArray(VAOs[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, VBOs[i]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(Corners), Corners, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[i]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices), Indices, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		queue.AddVertexArray(VAOs[i]);
+	}
+
+	// The draws, the same every frame
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<Draw> draws(static_cast<std::size_t>(drawCount));
+	for (auto& draw : draws)
+	{
+		draw.pass = (random() % 10 == 0) ? RenderPass::Blended : RenderPass::Opaque;
+		draw.program = static_cast<int>(random() % Programs);
+		draw.texture = static_cast<int>(random() % Textures);
+		draw.vertexArray = static_cast<int>(random() % VertexArrays);
+		draw.depth = unit(random);
+		draw.quad = glm::vec4(unit(random) * 1.8f - 1.0f, unit(random) * 1.8f - 1.0f, 0.2f, 0.2f);
+	}
+
+	// Keep fill rate out of the measurement
+	glViewport(0, 0, 16, 16);
+	glEnable(GL_DEPTH_TEST);
+
+	// Run one pass of the benchmark, returning the average microseconds per frame
+	// spent issuing commands, and including the GPU finishing them
+	auto run = [&](auto&& drawFrame) {
+		double submitUs { 0.0 };
+		glFinish();
+		const auto start = Clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			const auto frameStart = Clock::now();
+			drawFrame();
+			const std::chrono::duration<double, std::micro> submitted = Clock::now() - frameStart;
+			submitUs += submitted.count();
+			glFlush();
+		}
+		glFinish();
+		const std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+		return std::make_pair(submitUs / frames, elapsed.count() / frames);
+	};
+
+	std::cout << frames << " frames, " << drawCount << " draws per frame\n";
+
+	// Before: every piece of state set for every draw
+	const auto everything = run([&]() {
+		for (const auto& draw : draws)
+		{
+			if (draw.pass == RenderPass::Blended)
+			{
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				glDepthMask(GL_FALSE);
+			}
+			else
+			{
+				glDisable(GL_BLEND);
+				glDepthMask(GL_TRUE);
+			}
+			auto& shader = shaders[static_cast<std::size_t>(draw.program)];
+			shader.use();
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, textures[static_cast<std::size_t>(draw.texture)]);
+			glBindVertexArray(VAOs[static_cast<std::size_t>(draw.vertexArray)]);
+			shader.setVec4(quadLocs[static_cast<std::size_t>(draw.program)], draw.quad);
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+	});
+	std::cout << "  every draw       : " << everything.first << " us/frame submit, " << everything.second
+		<< " us/frame total, " << 4 * drawCount << " state changes/frame\n";
+
+	// After: through the queue, in submission order and then sorted
+	const auto perDraw = [&](int program, std::uint32_t user) {
+		shaders[static_cast<std::size_t>(program)].setVec4(quadLocs[static_cast<std::size_t>(program)], draws[user].quad);
+	};
+	for (const bool sorted : { false, true })
+	{
+		queue.SetSorting(sorted);
+		queue.ResetStatistics();
+		const auto result = run([&]() {
+			for (std::uint32_t i = 0; i < draws.size(); i++)
+			{
+				const auto& draw = draws[i];
+				queue.Submit(draw.pass, draw.program, draw.texture, draw.vertexArray, draw.depth, { 6, 0, 0, i });
+			}
+			queue.Execute(perDraw);
+		});
+		std::cout << "  " << (sorted ? "sorted queue     : " : "unsorted queue   : ") << result.first << " us/frame submit, "
+			<< result.second << " us/frame total, " << queue.StateChanges() / frames << " state changes/frame, "
+			<< queue.SortMilliseconds() / frames << " ms/frame sorting\n";
+		queue.Print();
+	}
+
+	// Clean up
+	glDeleteVertexArrays(VertexArrays, VAOs.data());
+	glDeleteBuffers(VertexArrays, VBOs.data());
+	glDeleteBuffers(VertexArrays, EBOs.data());
+	glDeleteTextures(Textures, textures.data());
+	for (const auto& shader : shaders)
+	{
+		glDeleteProgram(shader.ID);
+	}
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
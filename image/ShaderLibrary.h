@@ -0,0 +1,229 @@
+// ShaderLibrary.h
+//
+// Header-only batch builder for many shader programs at once
+// Files are read and preprocessed on a worker pool, then every compile and
+// link is submitted before any status is queried, so the driver can overlap
+// the work
+// https://registry.khronos.org/OpenGL/extensions/KHR/KHR_parallel_shader_compile.txt
+
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "CreateShader.h"
+#include "ProgramCache.h"
+#include "ShaderPreprocessor.h"
+#include "StageCache.h"
+#include "ThreadPool.h"
+
+class ShaderLibrary
+{
+public:
+	// Constructor; files are found relative to root
+	explicit ShaderLibrary(std::filesystem::path root = SHADER_DIR) : root(std::move(root)) {
+	}
+
+	// Request a program, returning its index for Get()
+	std::size_t Add(std::string vertexFile, std::string fragmentFile, ShaderDefines defines = {}) {
+		programs.push_back({ std::move(vertexFile), std::move(fragmentFile), std::move(defines) });
+		return programs.size() - 1;
+	}
+
+	// Read every file in parallel, then issue all compiles and links without waiting
+	void Submit() {
+		const auto start = Clock::now();
+
+		// Let the driver compile on as many threads as it likes
+		if (GLAD_GL_KHR_parallel_shader_compile)
+		{
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		}
+
+		// Each distinct file and define set is read and expanded exactly once
+		std::map<std::string, std::future<PreprocessedSource>> reads;
+		{
+			ThreadPool pool;
+			for (const auto& program : programs)
+			{
+				for (const auto& file : { program.vertexFile, program.fragmentFile })
+				{
+					const auto name = SourceName(file, program.defines);
+					if (reads.count(name) == 0)
+					{
+						const auto path = root / file;
+						const auto defines = program.defines;
+						reads.emplace(name, pool.Submit([path, defines]() {
+							return ShaderPreprocessor::Process(path, defines);
+						}));
+					}
+				}
+			}
+		}
+		std::map<std::string, PreprocessedSource> sources;
+		for (auto& [name, read] : reads)
+		{
+			sources.emplace(name, read.get());
+		}
+
+		// Try the binary cache first, and only compile the stages that are still
+		// needed; identical expanded stages are shared through the StageCache
+		auto& cache = ProgramCache::Instance();
+		for (auto& program : programs)
+		{
+			const auto& vertexSource = sources.at(SourceName(program.vertexFile, program.defines));
+			const auto& fragmentSource = sources.at(SourceName(program.fragmentFile, program.defines));
+			program.key = ProgramCache::MakeKey(vertexSource.code, fragmentSource.code,
+				ShaderPreprocessor::DefinesKey(program.defines));
+			program.ID = cache.Load(program.key);
+			program.fromCache = (program.ID != 0);
+			if (!program.fromCache)
+			{
+				program.vertex = CompileStage(GL_VERTEX_SHADER, vertexSource);
+				program.fragment = CompileStage(GL_FRAGMENT_SHADER, fragmentSource);
+			}
+		}
+
+		// Link everything, still without asking how the compiles went
+		for (auto& program : programs)
+		{
+			if (program.fromCache)
+			{
+				continue;
+			}
+			program.ID = glCreateProgram();
+			cache.PrepareForLink(program.ID);
+			glAttachShader(program.ID, program.vertex);
+			glAttachShader(program.ID, program.fragment);
+			glLinkProgram(program.ID);
+		}
+
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		submitMs = elapsed.count();
+	}
+
+	// Whether every program has finished linking; never blocks with KHR_parallel_shader_compile
+	bool Ready() const {
+		if (!GLAD_GL_KHR_parallel_shader_compile)
+		{
+			return true;
+		}
+		for (const auto& program : programs)
+		{
+			int done { GL_TRUE };
+			glGetProgramiv(program.ID, GL_COMPLETION_STATUS_KHR, &done);
+			if (!done)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Collect every status, store new binaries, and create the Shader objects
+	void Finish() {
+		const auto start = Clock::now();
+		for (const auto& [type, object] : freshStages)
+		{
+			Shader::checkCompileErrors(object, (type == GL_VERTEX_SHADER) ? "VERTEX" : "FRAGMENT");
+		}
+		freshStages.clear();
+		std::vector<bool> linked;
+		for (const auto& program : programs)
+		{
+			linked.push_back(program.fromCache || Shader::checkCompileErrors(program.ID, "PROGRAM"));
+			if (!program.fromCache)
+			{
+				glDetachShader(program.ID, program.vertex);
+				glDetachShader(program.ID, program.fragment);
+			}
+		}
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+
+		// The compiles overlapped, so charge each new program an equal share of the total
+		std::size_t compiled { 0 };
+		for (const auto& program : programs)
+		{
+			compiled += program.fromCache ? 0 : 1;
+		}
+		if (compiled > 0)
+		{
+			const double share { (submitMs + elapsed.count()) / compiled };
+			for (std::size_t i = 0; i < programs.size(); i++)
+			{
+				if (!programs[i].fromCache && linked[i])
+				{
+					ProgramCache::Instance().Store(programs[i].key, programs[i].ID, share);
+				}
+			}
+		}
+
+		shaders.clear();
+		shaders.reserve(programs.size());
+		for (const auto& program : programs)
+		{
+			shaders.emplace_back(program.ID);
+		}
+	}
+
+	// Submit and wait
+	void Build() {
+		Submit();
+		Finish();
+	}
+
+	// Access a finished program
+	Shader& Get(std::size_t index) {
+		return shaders.at(index);
+	}
+	std::size_t Size() const {
+		return programs.size();
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// A requested program and the GL objects behind it
+	struct Program
+	{
+		std::string vertexFile;
+		std::string fragmentFile;
+		ShaderDefines defines;
+		ProgramCache::Key key { 0 };
+		unsigned int vertex { 0 };
+		unsigned int fragment { 0 };
+		unsigned int ID { 0 };
+		bool fromCache { false };
+	};
+
+	// Key for one file expanded with one define set
+	static std::string SourceName(const std::string& file, const ShaderDefines& defines) {
+		return file + "|" + ShaderPreprocessor::DefinesKey(defines);
+	}
+
+	// Start compiling a stage, unless an identical one already exists
+	unsigned int CompileStage(GLenum type, const PreprocessedSource& source) {
+		const auto stage = StageCache::Instance().Acquire(type, source.code, source.hash);
+		if (stage.fresh)
+		{
+			freshStages.emplace_back(type, stage.object);
+		}
+		return stage.object;
+	}
+
+	std::filesystem::path root;
+	std::vector<Program> programs;
+	std::vector<std::pair<GLenum, unsigned int>> freshStages;
+	std::vector<Shader> shaders;
+	double submitMs { 0.0 };
+};
+
+#endif
@@ -0,0 +1,135 @@
+// ShaderLibraryBenchmark.cpp
+//
+// Compare startup time of building many programs one at a time through the
+// Shader constructor against building them in one batch with ShaderLibrary
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "ProgramCache.h"
+#include "ShaderLibrary.h"
+#include "ShaderPreprocessor.h"
+#include "StageCache.h"
+#include "Timeline.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Default number of programs, overridable from the command line
+	constexpr int DefaultPrograms { 64 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// One pass worth of distinct permutations, so no driver-side cache can help
+	std::vector<ShaderDefines> MakeVariants(int pass, int count)
+	{
+		std::vector<ShaderDefines> variants;
+		for (int i = 0; i < count; i++)
+		{
+			variants.push_back({
+				{ "MIX_FACTOR", std::to_string(0.2 + (pass * count + i) * 0.0001) },
+				{ "VARIANT", std::to_string(pass * count + i) }
+			});
+		}
+		return variants;
+	}
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("ShaderLibraryBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	// Usage: ShaderLibraryBenchmark.bin [programs]
+	const int count { (argc > 1) ? std::atoi(argv[1]) : DefaultPrograms };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "ShaderLibraryBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+
+	// Measure real compiles, not cache loads
+	ProgramCache::Instance().SetEnabled(false);
+
+	// Before: one program at a time, each stalling on its own status queries
+	const auto serialVariants = MakeVariants(0, count);
+	auto start = Clock::now();
+	std::vector<unsigned int> serialPrograms;
+	for (const auto& defines : serialVariants)
+	{
+		serialPrograms.push_back(Shader("vs/coordinates.c", "fs/transform.c", defines).ID);
+	}
+	const std::chrono::duration<double, std::milli> serial = Clock::now() - start;
+
+	// After: all of them submitted together
+	const auto batchVariants = MakeVariants(1, count);
+	start = Clock::now();
+	ShaderLibrary library;
+	for (const auto& defines : batchVariants)
+	{
+		library.Add("vs/coordinates.c", "fs/transform.c", defines);
+	}
+	library.Build();
+	const std::chrono::duration<double, std::milli> batched = Clock::now() - start;
+
+	// Report the results
+	std::cout << count << " programs, KHR_parallel_shader_compile "
+		<< (GLAD_GL_KHR_parallel_shader_compile ? "available" : "not available") << "\n";
+	std::cout << "  serial  : " << serial.count() << " ms\n";
+	std::cout << "  batched : " << batched.count() << " ms\n";
+	std::cout << "  speedup : " << (serial.count() / batched.count()) << "x\n";
+	StageCache::Instance().Print();
+
+	// Clean up
+	for (const auto program : serialPrograms)
+	{
+		glDeleteProgram(program);
+	}
+	for (std::size_t i = 0; i < library.Size(); i++)
+	{
+		glDeleteProgram(library.Get(i).ID);
+	}
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
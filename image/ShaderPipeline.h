@@ -0,0 +1,176 @@
+// ShaderPipeline.h
+//
+// Header-only separable program pipelines (ARB_separate_shader_objects)
+// Every stage is compiled once into its own program object, and pipelines
+// pairing any vertex stage with any fragment stage are formed on demand and
+// cached, so N vertex and M fragment stages cost N+M compiles instead of N*M links
+//
+// Uniforms belong to the stage programs: look them up on Pipeline::vertex or
+// Pipeline::fragment, call activate() with that stage, then use its setters
+
+#ifndef SHADER_PIPELINE_H
+#define SHADER_PIPELINE_H
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "CreateShader.h"
+#include "ShaderPreprocessor.h"
+
+// Two stage programs bound together
+struct Pipeline
+{
+	unsigned int ID { 0 };
+	const Shader* vertex { nullptr };
+	const Shader* fragment { nullptr };
+
+	// Bind the pipeline; a program bound with glUseProgram would take precedence
+	void use() const {
+		glUseProgram(0);
+		glBindProgramPipeline(ID);
+	}
+
+	// Direct glUniform* calls at one of the stages
+	void activate(const Shader& stage) const {
+		glActiveShaderProgram(ID, stage.ID);
+	}
+
+	explicit operator bool() const {
+		return ID != 0;
+	}
+};
+
+class PipelineCache
+{
+public:
+	// One cache per process (and per context)
+	static PipelineCache& Instance() {
+		static PipelineCache cache;
+		return cache;
+	}
+
+	// Whether the driver can do this at all; otherwise fall back to Shader
+	static bool Available() {
+		return GLAD_GL_ARB_separate_shader_objects;
+	}
+
+	// The separable program for one stage, compiled the first time it is asked
+	// for; like Shader::Load, the embedded copy is used when the build has one
+	const Shader* Stage(GLenum type, const char* file, const ShaderDefines& defines = {}) {
+		auto key = std::make_tuple(type, std::string(file), ShaderPreprocessor::DefinesKey(defines));
+		const auto found = stages.find(key);
+		if (found != stages.end())
+		{
+			return found->second.get();
+		}
+		const auto embedded = ShaderPreprocessor::Embedded(file);
+		auto source = embedded ? ShaderPreprocessor::Process(*embedded, defines) : ShaderPreprocessor::Process(file, defines);
+		const auto code = Separable(type, source.code);
+		const char* text = code.c_str();
+		const unsigned int program { glCreateShaderProgramv(type, 1, &text) };
+		compiled++;
+		if (!Shader::checkCompileErrors(program, "PROGRAM"))
+		{
+			std::cout << "ERROR::PIPELINE::STAGE_FAILED: " << file << "\n";
+			glDeleteProgram(program);
+			return nullptr;
+		}
+		auto stage = std::make_unique<Shader>(program);
+		auto& slot = (type == GL_VERTEX_SHADER) ? stage->vertexStage : stage->fragmentStage;
+		slot = { file, defines, std::move(source) };
+		return stages.emplace(std::move(key), std::move(stage)).first->second.get();
+	}
+
+	// The pipeline pairing two stage files, built the first time it is asked for
+	Pipeline Get(const char* vertexFile, const char* fragmentFile, const ShaderDefines& defines = {}) {
+		const auto* vertex = Stage(GL_VERTEX_SHADER, vertexFile, defines);
+		const auto* fragment = Stage(GL_FRAGMENT_SHADER, fragmentFile, defines);
+		if (vertex == nullptr || fragment == nullptr)
+		{
+			return Pipeline{};
+		}
+		return Get(*vertex, *fragment);
+	}
+
+	// The pipeline pairing two stage programs
+	Pipeline Get(const Shader& vertex, const Shader& fragment) {
+		const auto key = std::make_pair(vertex.ID, fragment.ID);
+		const auto found = pipelines.find(key);
+		if (found != pipelines.end())
+		{
+			return { found->second, &vertex, &fragment };
+		}
+		unsigned int ID { 0 };
+		glGenProgramPipelines(1, &ID);
+		glUseProgramStages(ID, GL_VERTEX_SHADER_BIT, vertex.ID);
+		glUseProgramStages(ID, GL_FRAGMENT_SHADER_BIT, fragment.ID);
+#ifndef NDEBUG
+		// catches stages whose interfaces do not match
+		glValidateProgramPipeline(ID);
+		int valid { GL_FALSE };
+		glGetProgramPipelineiv(ID, GL_VALIDATE_STATUS, &valid);
+		if (!valid)
+		{
+			char infoLog[1024];
+			glGetProgramPipelineInfoLog(ID, sizeof(infoLog), nullptr, infoLog);
+			std::cout << "WARNING::PIPELINE::VALIDATION_FAILED\n" << infoLog << "\n";
+		}
+#endif
+		pipelines.emplace(key, ID);
+		return { ID, &vertex, &fragment };
+	}
+
+	// Delete every pipeline and stage program
+	void Clear() {
+		for (const auto& [key, ID] : pipelines)
+		{
+			glDeleteProgramPipelines(1, &ID);
+		}
+		pipelines.clear();
+		for (const auto& [key, stage] : stages)
+		{
+			glDeleteProgram(stage->ID);
+		}
+		stages.clear();
+	}
+
+	// Statistics
+	unsigned int Compiled() const {
+		return compiled;
+	}
+	std::size_t Pipelines() const {
+		return pipelines.size();
+	}
+	void Print() const {
+		std::cout << "Pipeline cache: " << compiled << " stage programs, " << pipelines.size() << " pipelines\n";
+	}
+
+private:
+	PipelineCache() = default;
+
+	// A vertex stage of a separable program has to declare the gl_PerVertex
+	// block it writes; the extension is enabled right after #version
+	static std::string Separable(GLenum type, const std::string& code) {
+		std::string header { "#extension GL_ARB_separate_shader_objects : enable\n" };
+		if (type == GL_VERTEX_SHADER)
+		{
+			header += "out gl_PerVertex { vec4 gl_Position; };\n";
+		}
+		const auto version = code.find("#version");
+		const auto end = (version == std::string::npos) ? 0 : code.find('\n', version) + 1;
+		return code.substr(0, end) + header + code.substr(end);
+	}
+
+	// stage programs by type, file and defines, so a hit needs no preprocessing
+	std::map<std::tuple<GLenum, std::string, std::string>, std::unique_ptr<Shader>> stages;
+	std::map<std::pair<unsigned int, unsigned int>, unsigned int> pipelines;
+	unsigned int compiled { 0 };
+};
+
+#endif
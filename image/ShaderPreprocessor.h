@@ -0,0 +1,293 @@
+// ShaderPreprocessor.h
+//
+// Header-only GLSL preprocessing stage in front of Shader
+// Resolves #include "file" (once per file), and injects #define lines for
+// permutations right after #version
+// Sources generated at runtime (e.g. uniform block declarations) can be
+// registered under a name and included like any file, and sources compiled
+// into the executable (EmbeddedShaders.h) can be expanded without any file I/O
+
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef EMBEDDED_SHADERS
+#include "EmbeddedShaders.h"
+#endif
+
+// Permutation defines, in the order they are injected
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// A stage held in memory, known by the name its file has under SHADER_DIR
+struct ShaderSource
+{
+	std::string_view name;
+	std::string_view code;
+};
+
+// A fully expanded stage, and every file that went into it
+struct PreprocessedSource
+{
+	std::string code;
+	std::vector<std::string> files;
+	std::uint64_t hash { 0 };
+};
+
+class ShaderPreprocessor
+{
+public:
+	// Expand a file; relative paths and #include are resolved against SHADER_DIR
+	static PreprocessedSource Process(const std::filesystem::path& file, const ShaderDefines& defines = {}) {
+		PreprocessedSource result;
+		std::set<std::filesystem::path> included;
+		const auto path = Root() / file;
+		Expand(path, defines, true, included, result, false);
+		result.hash = Hash(result.code);
+		return result;
+	}
+
+	// Expand a source already in memory; its includes come from memory too
+	// (generated or embedded) before falling back to SHADER_DIR
+	static PreprocessedSource Process(const ShaderSource& source, const ShaderDefines& defines = {}) {
+		PreprocessedSource result;
+		std::set<std::filesystem::path> included;
+		const auto path = (Root() / source.name).lexically_normal();
+		included.insert(path);
+		result.files.push_back(Name(path));
+		ExpandText(path, source.code, defines, true, included, result, true, 0);
+		result.hash = Hash(result.code);
+		return result;
+	}
+
+	// The copy of a file compiled into the executable, if the build embedded any
+	static std::optional<ShaderSource> Embedded(std::string_view name) {
+#ifdef EMBEDDED_SHADERS
+		for (const auto& file : EmbeddedShaders::Files)
+		{
+			if (file.name == name)
+			{
+				return ShaderSource{ file.name, file.code };
+			}
+		}
+#else
+		(void)name;
+#endif
+		return std::nullopt;
+	}
+
+	// Canonical text for a define set, e.g. for cache keys
+	static std::string DefinesKey(const ShaderDefines& defines) {
+		std::string key;
+		for (const auto& [name, value] : defines)
+		{
+			key += name + "=" + value + ";";
+		}
+		return key;
+	}
+
+	// Register generated source under a name relative to SHADER_DIR; it takes
+	// precedence over a file of the same name
+	static void AddGenerated(const std::filesystem::path& name, std::string code) {
+		auto& generated = Generated();
+		std::lock_guard<std::mutex> lock(generated.mutex);
+		generated.files[(Root() / name).lexically_normal()] = std::move(code);
+	}
+
+	// 64-bit FNV-1a of some text
+	static std::uint64_t Hash(std::string_view text) {
+		std::uint64_t hash { 14695981039346656037ull };
+		for (const char c : text)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// The name a file is known by: relative to SHADER_DIR when it lives there
+	static std::string Name(const std::filesystem::path& path) {
+		const auto relative = path.lexically_normal().lexically_relative(Root());
+		if (relative.empty() || *relative.begin() == "..")
+		{
+			return path.lexically_normal().string();
+		}
+		return relative.string();
+	}
+
+private:
+	// Nested includes deeper than this are assumed to be a mistake
+	static constexpr int MaxDepth { 32 };
+
+	static std::filesystem::path Root() {
+		return std::filesystem::path(SHADER_DIR);
+	}
+
+	// Registered sources; the watcher thread expands shaders too
+	struct GeneratedFiles
+	{
+		std::mutex mutex;
+		std::map<std::filesystem::path, std::string> files;
+	};
+	static GeneratedFiles& Generated() {
+		static GeneratedFiles generated;
+		return generated;
+	}
+
+	// The text of a generated source or a file
+	static std::optional<std::string> Read(const std::filesystem::path& path) {
+		{
+			auto& generated = Generated();
+			std::lock_guard<std::mutex> lock(generated.mutex);
+			const auto found = generated.files.find(path);
+			if (found != generated.files.end())
+			{
+				return found->second;
+			}
+		}
+		std::ifstream stream(path);
+		if (!stream)
+		{
+			return std::nullopt;
+		}
+		std::stringstream text;
+		text << stream.rdbuf();
+		return text.str();
+	}
+
+	// Append the expansion of one file to the result
+	static void Expand(const std::filesystem::path& path, const ShaderDefines& defines, bool topLevel,
+		std::set<std::filesystem::path>& included, PreprocessedSource& result, bool fromMemory, int depth = 0) {
+		const auto normal = path.lexically_normal();
+		if (!included.insert(normal).second)
+		{
+			return;
+		}
+		if (fromMemory)
+		{
+			if (const auto embedded = Embedded(Name(normal)); embedded && !IsGenerated(normal))
+			{
+				result.files.push_back(Name(normal));
+				ExpandText(normal, embedded->code, defines, topLevel, included, result, fromMemory, depth);
+				return;
+			}
+		}
+		const auto text = Read(normal);
+		if (!text)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << normal << "\n";
+			return;
+		}
+		result.files.push_back(Name(normal));
+		ExpandText(normal, *text, defines, topLevel, included, result, fromMemory, depth);
+	}
+
+	// Append the expansion of some text that came from path
+	static void ExpandText(const std::filesystem::path& path, std::string_view text, const ShaderDefines& defines,
+		bool topLevel, std::set<std::filesystem::path>& included, PreprocessedSource& result, bool fromMemory, int depth) {
+		result.code.reserve(result.code.size() + text.size());
+		bool injected { !topLevel };
+		while (!text.empty())
+		{
+			const auto end = text.find('\n');
+			const auto line = text.substr(0, end);
+			text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+			const auto directive = Directive(line);
+			if (directive.rfind("#version", 0) == 0)
+			{
+				// Only the top-level file's #version survives, followed by the defines
+				if (topLevel)
+				{
+					result.code.append(line).append("\n");
+					for (const auto& [name, value] : defines)
+					{
+						result.code += "#define " + name + " " + value + "\n";
+					}
+					injected = true;
+				}
+				continue;
+			}
+			if (directive.rfind("#include", 0) == 0)
+			{
+				const auto target = IncludeTarget(directive);
+				const auto found = Resolve(path.parent_path(), target, fromMemory);
+				if (found.empty() || depth >= MaxDepth)
+				{
+					std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: \"" << target << "\" in " << path << "\n";
+					continue;
+				}
+				Expand(found, defines, false, included, result, fromMemory, depth + 1);
+				continue;
+			}
+			if (!injected)
+			{
+				// No #version at all: defines still go first
+				for (const auto& [name, value] : defines)
+				{
+					result.code += "#define " + name + " " + value + "\n";
+				}
+				injected = true;
+			}
+			result.code.append(line).append("\n");
+		}
+	}
+
+	// The line without leading whitespace, if it is a directive
+	static std::string_view Directive(std::string_view line) {
+		const auto start = line.find_first_not_of(" \t");
+		if (start == std::string_view::npos || line[start] != '#')
+		{
+			return {};
+		}
+		return line.substr(start);
+	}
+
+	// The quoted (or bracketed) name after #include
+	static std::string IncludeTarget(std::string_view directive) {
+		const auto open = directive.find_first_of("\"<");
+		if (open == std::string_view::npos)
+		{
+			return {};
+		}
+		const auto close = directive.find_first_of("\">", open + 1);
+		return std::string(directive.substr(open + 1, close - open - 1));
+	}
+
+	static bool IsGenerated(const std::filesystem::path& path) {
+		auto& generated = Generated();
+		std::lock_guard<std::mutex> lock(generated.mutex);
+		return generated.files.count(path) > 0;
+	}
+
+	// Look next to the including file first, then in SHADER_DIR
+	static std::filesystem::path Resolve(const std::filesystem::path& from, const std::string& target, bool fromMemory) {
+		if (target.empty())
+		{
+			return {};
+		}
+		for (const auto& base : { from, Root() })
+		{
+			const auto candidate = (base / target).lexically_normal();
+			if (IsGenerated(candidate) || (fromMemory && Embedded(Name(candidate))) || std::filesystem::exists(candidate))
+			{
+				return candidate;
+			}
+		}
+		return {};
+	}
+};
+
+#endif
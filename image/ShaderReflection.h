@@ -0,0 +1,238 @@
+// ShaderReflection.h
+//
+// Header-only table of everything a linked program exposes: its active
+// uniforms (loose and inside blocks), uniform blocks, and vertex attributes
+// Built once after linking, so nothing has to ask the driver by name later
+
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glad/glad.h>
+
+struct ShaderReflection
+{
+	// An active uniform or attribute
+	struct Variable
+	{
+		std::string name;
+		GLenum type { 0 };
+		int size { 1 };        // array length, 1 for non-arrays
+		int location { -1 };   // -1 for uniforms inside a block
+		int block { -1 };      // index into blocks, or -1
+		int offset { -1 };     // byte offset inside the block, or -1
+	};
+
+	// An active uniform block
+	struct Block
+	{
+		std::string name;
+		unsigned int index { 0 };
+		int dataSize { 0 };
+	};
+
+	std::vector<Variable> uniforms;
+	std::vector<Block> blocks;
+	std::vector<Variable> attributes;
+
+	// Query a linked program
+	static ShaderReflection Of(unsigned int program) {
+		ShaderReflection reflection;
+		reflection.ReadUniforms(program);
+		reflection.ReadBlocks(program);
+		reflection.ReadAttributes(program);
+		return reflection;
+	}
+
+	// Lookups by name; arrays are found without their "[0]"
+	const Variable* FindUniform(std::string_view name) const {
+		return Find(uniforms, name);
+	}
+	const Variable* FindAttribute(std::string_view name) const {
+		return Find(attributes, name);
+	}
+	const Block* FindBlock(std::string_view name) const {
+		const auto it = std::find_if(blocks.begin(), blocks.end(), [&](const Block& b) { return b.name == name; });
+		return it == blocks.end() ? nullptr : &*it;
+	}
+
+	// Number of scalar components in one element of a GLSL type
+	static int Components(GLenum type) {
+		switch (type)
+		{
+		case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2:
+			return 2;
+		case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3:
+			return 3;
+		case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2:
+			return 4;
+		case GL_FLOAT_MAT3:
+			return 9;
+		case GL_FLOAT_MAT4:
+			return 16;
+		default:
+			return 1;
+		}
+	}
+
+	// Whether an attribute of this type has to be fed with glVertexAttribIPointer
+	static bool IsInteger(GLenum type) {
+		switch (type)
+		{
+		case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+		case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// The GLSL spelling of a type, for messages
+	static const char* TypeName(GLenum type) {
+		switch (type)
+		{
+		case GL_FLOAT: return "float";
+		case GL_FLOAT_VEC2: return "vec2";
+		case GL_FLOAT_VEC3: return "vec3";
+		case GL_FLOAT_VEC4: return "vec4";
+		case GL_INT: return "int";
+		case GL_INT_VEC2: return "ivec2";
+		case GL_INT_VEC3: return "ivec3";
+		case GL_INT_VEC4: return "ivec4";
+		case GL_UNSIGNED_INT: return "uint";
+		case GL_UNSIGNED_INT_VEC2: return "uvec2";
+		case GL_UNSIGNED_INT_VEC3: return "uvec3";
+		case GL_UNSIGNED_INT_VEC4: return "uvec4";
+		case GL_BOOL: return "bool";
+		case GL_FLOAT_MAT2: return "mat2";
+		case GL_FLOAT_MAT3: return "mat3";
+		case GL_FLOAT_MAT4: return "mat4";
+		case GL_SAMPLER_2D: return "sampler2D";
+		case GL_SAMPLER_2D_ARRAY: return "sampler2DArray";
+		case GL_SAMPLER_3D: return "sampler3D";
+		case GL_SAMPLER_CUBE: return "samplerCube";
+		default: return "?";
+		}
+	}
+
+	// Dump the table
+	void Print(std::ostream& out = std::cout) const {
+		for (const auto& attribute : attributes)
+		{
+			out << "  in " << TypeName(attribute.type) << " " << attribute.name << " (location " << attribute.location << ")\n";
+		}
+		for (const auto& uniform : uniforms)
+		{
+			out << "  uniform " << TypeName(uniform.type) << " " << uniform.name;
+			if (uniform.size > 1)
+			{
+				out << "[" << uniform.size << "]";
+			}
+			if (uniform.block >= 0)
+			{
+				out << " (" << blocks[static_cast<size_t>(uniform.block)].name << " + " << uniform.offset << ")\n";
+			}
+			else
+			{
+				out << " (location " << uniform.location << ")\n";
+			}
+		}
+		for (const auto& block : blocks)
+		{
+			out << "  block " << block.name << " (" << block.dataSize << " bytes)\n";
+		}
+	}
+
+private:
+	static const Variable* Find(const std::vector<Variable>& variables, std::string_view name) {
+		const auto it = std::find_if(variables.begin(), variables.end(), [&](const Variable& v) { return v.name == name; });
+		return it == variables.end() ? nullptr : &*it;
+	}
+
+	// Arrays are reported as "name[0]", but are looked up as "name"
+	static std::string StripArray(const char* text, int length) {
+		std::string_view name(text, static_cast<size_t>(length));
+		if (name.size() > 3 && name.substr(name.size() - 3) == "[0]")
+		{
+			name.remove_suffix(3);
+		}
+		return std::string(name);
+	}
+
+	void ReadUniforms(unsigned int program) {
+		int count { 0 };
+		int maxLength { 0 };
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<char> buffer(static_cast<size_t>(std::max(maxLength, 1)));
+		std::vector<GLuint> indices;
+		for (int i = 0; i < count; i++)
+		{
+			Variable uniform;
+			int length { 0 };
+			glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length,
+				&uniform.size, &uniform.type, buffer.data());
+			uniform.location = glGetUniformLocation(program, buffer.data());
+			uniform.name = StripArray(buffer.data(), length);
+			uniforms.push_back(std::move(uniform));
+			indices.push_back(static_cast<GLuint>(i));
+		}
+		if (count == 0)
+		{
+			return;
+		}
+		// Where the block members live
+		std::vector<int> block(static_cast<size_t>(count));
+		std::vector<int> offset(static_cast<size_t>(count));
+		glGetActiveUniformsiv(program, count, indices.data(), GL_UNIFORM_BLOCK_INDEX, block.data());
+		glGetActiveUniformsiv(program, count, indices.data(), GL_UNIFORM_OFFSET, offset.data());
+		for (size_t i = 0; i < uniforms.size(); i++)
+		{
+			uniforms[i].block = block[i];
+			uniforms[i].offset = offset[i];
+		}
+	}
+
+	void ReadBlocks(unsigned int program) {
+		int count { 0 };
+		int maxLength { 0 };
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+		std::vector<char> buffer(static_cast<size_t>(std::max(maxLength, 1)));
+		for (int i = 0; i < count; i++)
+		{
+			Block block;
+			int length { 0 };
+			block.index = static_cast<unsigned int>(i);
+			glGetActiveUniformBlockName(program, block.index, static_cast<GLsizei>(buffer.size()), &length, buffer.data());
+			glGetActiveUniformBlockiv(program, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+			block.name.assign(buffer.data(), static_cast<size_t>(length));
+			blocks.push_back(std::move(block));
+		}
+	}
+
+	void ReadAttributes(unsigned int program) {
+		int count { 0 };
+		int maxLength { 0 };
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+		std::vector<char> buffer(static_cast<size_t>(std::max(maxLength, 1)));
+		for (int i = 0; i < count; i++)
+		{
+			Variable attribute;
+			int length { 0 };
+			glGetActiveAttrib(program, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length,
+				&attribute.size, &attribute.type, buffer.data());
+			attribute.location = glGetAttribLocation(program, buffer.data());
+			attribute.name = StripArray(buffer.data(), length);
+			attributes.push_back(std::move(attribute));
+		}
+	}
+};
+
+#endif
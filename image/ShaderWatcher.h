@@ -0,0 +1,372 @@
+// ShaderWatcher.h
+//
+// Header-only hot reload of shaders while a program is running
+// A background thread watches SHADER_DIR with inotify and re-expands every
+// stage that depends on a changed file (including through #include); the
+// render thread calls Update() once per frame to rebuild and swap programs
+//
+// Every watched Shader must outlive the watcher, or be passed to Unwatch()
+// before it goes; call Stop() (or destroy the watcher) while the context is
+// still current, so the programs of unfinished rebuilds can be deleted
+
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <glad/glad.h>
+
+#include "CreateShader.h"
+#include "ShaderPreprocessor.h"
+#include "StageCache.h"
+
+class ShaderWatcher
+{
+public:
+	// Constructor; starts watching root and its stage directories
+	explicit ShaderWatcher(std::filesystem::path root = SHADER_DIR) : root(std::move(root)) {
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0)
+		{
+			std::cout << "ShaderWatcher: inotify is not available, hot reload disabled\n";
+			return;
+		}
+		for (const auto* dir : { "", "vs", "fs", "common" })
+		{
+			const auto path = this->root / dir;
+			const int wd = inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (wd >= 0)
+			{
+				directories.emplace(wd, dir);
+			}
+		}
+		worker = std::thread([this]() { Run(); });
+#endif
+	}
+
+	~ShaderWatcher() {
+		Stop();
+	}
+
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+	// Reload this shader whenever one of its files, or anything it includes, changes
+	void Watch(Shader& shader) {
+		std::lock_guard<std::mutex> lock(mutex);
+		watched.push_back({ &shader, shader.vertexStage.file, shader.fragmentStage.file, shader.vertexStage.defines,
+			shader.vertexStage.source.files, shader.fragmentStage.source.files });
+	}
+
+	// Stop the background thread, and delete the programs still being rebuilt
+	void Stop() {
+		stopping = true;
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+#ifdef __linux__
+		if (fd >= 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+#endif
+		for (auto& rebuild : rebuilds)
+		{
+			Abandon(rebuild);
+		}
+		rebuilds.clear();
+	}
+
+	// Stop reloading this shader, and drop any rebuild of it in flight; needed
+	// before a watched Shader is destroyed ahead of the watcher
+	void Unwatch(Shader& shader) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			watched.erase(std::remove_if(watched.begin(), watched.end(),
+				[&](const Watched& entry) { return entry.shader == &shader; }), watched.end());
+			pending.erase(&shader);
+		}
+		for (auto it = rebuilds.begin(); it != rebuilds.end();)
+		{
+			if (it->shader != &shader)
+			{
+				++it;
+				continue;
+			}
+			Abandon(*it);
+			it = rebuilds.erase(it);
+		}
+	}
+
+	// Call between frames; returns true if any program was swapped, in which
+	// case uniform handles have to be looked up again
+	bool Update() {
+		const auto start = Clock::now();
+
+		// Take whatever the watcher thread has expanded since last frame
+		std::map<Shader*, Change> changed;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			changed.swap(pending);
+		}
+
+		// Start rebuilding every shader with a changed stage
+		for (auto& [shader, change] : changed)
+		{
+			Rebuild rebuild;
+			rebuild.shader = shader;
+			rebuild.vertexSource = change.vertex ? std::move(*change.vertex) : shader->vertexStage.source;
+			rebuild.fragmentSource = change.fragment ? std::move(*change.fragment) : shader->fragmentStage.source;
+			Begin(rebuild);
+			rebuilds.push_back(std::move(rebuild));
+		}
+
+		// Finish the rebuilds the driver is done with
+		bool swapped { false };
+		for (auto it = rebuilds.begin(); it != rebuilds.end();)
+		{
+			auto& rebuild = *it;
+			rebuild.frames++;
+			if (!Complete(rebuild))
+			{
+				++it;
+				continue;
+			}
+			swapped = Finish(rebuild, start) || swapped;
+			it = rebuilds.erase(it);
+		}
+
+		// Charge this frame's work to every rebuild still in flight
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		for (auto& rebuild : rebuilds)
+		{
+			rebuild.busyMs += elapsed.count();
+			rebuild.worstMs = std::max(rebuild.worstMs, elapsed.count());
+		}
+		return swapped;
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// A shader being watched, and every file each of its stages was built from
+	struct Watched
+	{
+		Shader* shader;
+		std::string vertexFile;
+		std::string fragmentFile;
+		ShaderDefines defines;
+		std::vector<std::string> vertexFiles;
+		std::vector<std::string> fragmentFiles;
+	};
+
+	// Newly expanded stages for one shader
+	struct Change
+	{
+		std::optional<PreprocessedSource> vertex;
+		std::optional<PreprocessedSource> fragment;
+	};
+
+	// One program being rebuilt across frames
+	struct Rebuild
+	{
+		Shader* shader { nullptr };
+		PreprocessedSource vertexSource;
+		PreprocessedSource fragmentSource;
+		StageCache::Stage vertex;
+		StageCache::Stage fragment;
+		unsigned int program { 0 };
+		Clock::time_point started;
+		int frames { 0 };
+		double busyMs { 0.0 };
+		double worstMs { 0.0 };
+	};
+
+	// Submit the compiles and the link without waiting on any of them
+	static void Begin(Rebuild& rebuild) {
+		rebuild.started = Clock::now();
+		auto& stages = StageCache::Instance();
+		rebuild.vertex = stages.Acquire(GL_VERTEX_SHADER, rebuild.vertexSource.code, rebuild.vertexSource.hash);
+		rebuild.fragment = stages.Acquire(GL_FRAGMENT_SHADER, rebuild.fragmentSource.code, rebuild.fragmentSource.hash);
+		rebuild.program = glCreateProgram();
+		glAttachShader(rebuild.program, rebuild.vertex.object);
+		glAttachShader(rebuild.program, rebuild.fragment.object);
+		glLinkProgram(rebuild.program);
+	}
+
+	// Delete a rebuild's program without swapping it in, and the stages it
+	// compiled itself, whose status nobody has checked
+	static void Abandon(Rebuild& rebuild) {
+		glDetachShader(rebuild.program, rebuild.vertex.object);
+		glDetachShader(rebuild.program, rebuild.fragment.object);
+		glDeleteProgram(rebuild.program);
+		auto& stages = StageCache::Instance();
+		if (rebuild.vertex.fresh)
+		{
+			stages.Discard(GL_VERTEX_SHADER, rebuild.vertexSource.hash);
+		}
+		if (rebuild.fragment.fresh)
+		{
+			stages.Discard(GL_FRAGMENT_SHADER, rebuild.fragmentSource.hash);
+		}
+	}
+
+	// Whether the link has finished; without KHR_parallel_shader_compile this is
+	// always true, and the status query in Finish() will block instead
+	static bool Complete(const Rebuild& rebuild) {
+		if (!GLAD_GL_KHR_parallel_shader_compile)
+		{
+			return true;
+		}
+		int done { GL_TRUE };
+		glGetProgramiv(rebuild.program, GL_COMPLETION_STATUS_KHR, &done);
+		return done;
+	}
+
+	// Swap the new program in if it linked, otherwise keep the old one
+	static bool Finish(Rebuild& rebuild, Clock::time_point frameStart) {
+		bool success { true };
+		if (rebuild.vertex.fresh)
+		{
+			success = Shader::checkCompileErrors(rebuild.vertex.object, "VERTEX") && success;
+		}
+		if (rebuild.fragment.fresh)
+		{
+			success = Shader::checkCompileErrors(rebuild.fragment.object, "FRAGMENT") && success;
+		}
+		success = Shader::checkCompileErrors(rebuild.program, "PROGRAM") && success;
+		glDetachShader(rebuild.program, rebuild.vertex.object);
+		glDetachShader(rebuild.program, rebuild.fragment.object);
+		auto& shader = *rebuild.shader;
+		if (!success)
+		{
+			glDeleteProgram(rebuild.program);
+			std::cout << "Reload of (" << shader.vertexStage.file << ", " << shader.fragmentStage.file
+				<< ") failed, keeping the previous program\n";
+			return false;
+		}
+		shader.swapProgram(rebuild.program);
+		shader.vertexStage.source = std::move(rebuild.vertexSource);
+		shader.fragmentStage.source = std::move(rebuild.fragmentSource);
+
+		// Report the cost: total wall time, and how much of it landed on the render thread
+		const std::chrono::duration<double, std::milli> total = Clock::now() - rebuild.started;
+		const std::chrono::duration<double, std::milli> lastFrame = Clock::now() - frameStart;
+		std::cout << "Reloaded (" << shader.vertexStage.file << ", " << shader.fragmentStage.file << ") in "
+			<< total.count() << " ms over " << rebuild.frames << " frames; render thread spent "
+			<< (rebuild.busyMs + lastFrame.count()) << " ms, worst frame +"
+			<< std::max(rebuild.worstMs, lastFrame.count()) << " ms\n";
+		return true;
+	}
+
+	// Whether a stage was built from this file
+	static bool Uses(const std::vector<std::string>& files, const std::string& file) {
+		return std::find(files.begin(), files.end(), file) != files.end();
+	}
+
+	// Re-expand every stage that depends on a changed file
+	void Changed(const std::string& file) {
+		std::vector<Watched> affected;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto& entry : watched)
+			{
+				if (Uses(entry.vertexFiles, file) || Uses(entry.fragmentFiles, file))
+				{
+					affected.push_back(entry);
+				}
+			}
+		}
+		for (const auto& entry : affected)
+		{
+			Change change;
+			if (Uses(entry.vertexFiles, file))
+			{
+				change.vertex = ShaderPreprocessor::Process(entry.vertexFile, entry.defines);
+			}
+			if (Uses(entry.fragmentFiles, file))
+			{
+				change.fragment = ShaderPreprocessor::Process(entry.fragmentFile, entry.defines);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto& current : watched)
+			{
+				if (current.shader != entry.shader)
+				{
+					continue;
+				}
+				// The set of included files may have changed too
+				auto& next = pending[entry.shader];
+				if (change.vertex)
+				{
+					current.vertexFiles = change.vertex->files;
+					next.vertex = std::move(change.vertex);
+				}
+				if (change.fragment)
+				{
+					current.fragmentFiles = change.fragment->files;
+					next.fragment = std::move(change.fragment);
+				}
+			}
+		}
+	}
+
+	// Background thread: wait for inotify events and expand what they affect
+	void Run() {
+#ifdef __linux__
+		alignas(inotify_event) char buffer[4096];
+		while (!stopping)
+		{
+			pollfd descriptor { fd, POLLIN, 0 };
+			if (poll(&descriptor, 1, 100) <= 0)
+			{
+				continue;
+			}
+			const auto length = read(fd, buffer, sizeof(buffer));
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+				const auto dir = directories.find(event->wd);
+				if (event->len == 0 || dir == directories.end())
+				{
+					continue;
+				}
+				Changed((std::filesystem::path(dir->second) / event->name).lexically_normal().string());
+			}
+		}
+#endif
+	}
+
+	std::filesystem::path root;
+	int fd { -1 };
+	std::map<int, std::string> directories;
+	std::thread worker;
+	std::atomic<bool> stopping { false };
+	std::mutex mutex;
+	std::vector<Watched> watched;
+	std::map<Shader*, Change> pending;
+	std::vector<Rebuild> rebuilds;
+};
+
+#endif
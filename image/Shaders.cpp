@@ -10,6 +10,8 @@
 #include <GLFW/glfw3.h>
 
 #include "CreateShader.h"
+#include "ShaderWatcher.h"
+#include "Timeline.h"
 
 // Set some global variables
 namespace {
@@ -25,14 +27,22 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // Main function
 int main()
 {
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("Shaders");
+	TIMELINE_BEGIN("startup");
+
 	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
 	glfwInit();
+	TIMELINE_END();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
 	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "LearnOpenGL", nullptr, nullptr);
+	TIMELINE_END();
 	if (window == nullptr)
 	{
 		std::cout << "Failed to create GLFW window\n";
@@ -46,7 +56,10 @@ int main()
 	glfwSetKeyCallback(window, key_callback);
 
 	// Make sure GLAD loads
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
 	{
 		std::cout << "Failed to initialize GLAD\n";
 		glfwTerminate();
@@ -54,7 +67,7 @@ int main()
 	}
 
 	// Build and compile our shader programs
-	Shader ourShader("vs/positions_and_colors.c", "fs/simple.c");
+	Shader ourShader = Shader::Load("vs/positions_and_colors.c", "fs/simple.c");
 
 	// Configure vertex attributes
 	float vertices[]
@@ -102,9 +115,29 @@ int main()
 	auto colorBlue = 0.0f;
 	double delta = 0.01;
 
+	// Resolve the uniforms once, outside of the render loop
+	auto greenLoc = ourShader.uniform("uniformGreen");
+	auto offsetXLoc = ourShader.uniform("uniformOffsetX");
+	auto offsetYLoc = ourShader.uniform("uniformOffsetY");
+
+	// Reload the shaders whenever their files are edited
+	ShaderWatcher watcher;
+	watcher.Watch(ourShader);
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
 	// Render loop
 	while (!glfwWindowShouldClose(window))
 	{
+		// Swap in edited shaders, and look the uniforms up again if we did
+		if (watcher.Update())
+		{
+			greenLoc = ourShader.uniform("uniformGreen");
+			offsetXLoc = ourShader.uniform("uniformOffsetX");
+			offsetYLoc = ourShader.uniform("uniformOffsetY");
+		}
+
 		// Set the clear color, with cycling blue
 		glClearColor(0.5f, 0.1f, colorBlue, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
@@ -117,13 +150,13 @@ int main()
 
 		// Update the amount of green in every vertex
 		const auto greenValue = std::sin(timeValue) / 4.0 + 0.4f;
-		ourShader.setFloat("uniformGreen", greenValue);
+		ourShader.setFloat(greenLoc, greenValue);
 
 		// Move the triangle in a circle
 		const auto offsetValueX = std::sin(timeValue) / 2.0;
 		const auto offsetValueY = std::cos(timeValue) / 2.0;
-		ourShader.setFloat("uniformOffsetX", offsetValueX);
-		ourShader.setFloat("uniformOffsetY", offsetValueY);
+		ourShader.setFloat(offsetXLoc, offsetValueX);
+		ourShader.setFloat(offsetYLoc, offsetValueY);
 
 		// render the triangle
 		glBindVertexArray(VAO);
@@ -146,6 +179,7 @@ int main()
 	// Clean up buffers
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	watcher.Stop();
 
 	glfwTerminate();
 	return EXIT_SUCCESS;
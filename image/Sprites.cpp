@@ -0,0 +1,293 @@
+// Sprites.cpp
+//
+// Hundreds of different sprites, packed into a TextureAtlas and drawn with one
+// bind and one draw per atlas page: every sprite is the textured quad from
+// Textures.cpp, moved into place, with its coordinates remapped to its region
+// The sprites are textures/awesomeface.png and textures/container.jpg at
+// assorted sizes and tints, each one a separate image in the atlas
+//
+// Usage: Sprites.bin [sprites]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "TextureAtlas.h"
+#include "Timeline.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 800 };
+
+	// Default number of sprites, and the range of their sizes in texels
+	constexpr int DefaultSprites { 400 };
+	constexpr int SmallestSprite { 24 };
+	constexpr int LargestSprite { 96 };
+
+	// An RGBA image
+	struct Image
+	{
+		int width { 0 };
+		int height { 0 };
+		std::vector<unsigned char> pixels;
+	};
+
+	// The quad from Textures.cpp, without the colours
+	constexpr float Quad[] = {
+	// positions     // texture coords
+		 0.5f,  0.5f,   1.0f, 1.0f, // top right
+		 0.5f, -0.5f,   1.0f, 0.0f, // bottom right
+		-0.5f, -0.5f,   0.0f, 0.0f, // bottom left
+		-0.5f,  0.5f,   0.0f, 1.0f  // top left
+	};
+	constexpr unsigned int QuadIndices[] = {
+		0, 1, 3, // first triangle
+		1, 2, 3  // second triangle
+	};
+
+	// A size x size copy of an image, tinted by the sprite's index
+	Image Variant(const Image& image, int size, int index)
+	{
+		Image variant { size, size, std::vector<unsigned char>(static_cast<std::size_t>(size) * size * 4) };
+		const float hue = static_cast<float>(index) * 0.61803f;
+		const float tint[3] {
+			0.6f + 0.4f * std::cos(6.2832f * hue),
+			0.6f + 0.4f * std::cos(6.2832f * (hue + 0.333f)),
+			0.6f + 0.4f * std::cos(6.2832f * (hue + 0.667f)),
+		};
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const unsigned char* in = image.pixels.data()
+					+ (static_cast<std::size_t>(y * image.height / size) * image.width + x * image.width / size) * 4;
+				unsigned char* out = variant.pixels.data() + (static_cast<std::size_t>(y) * size + x) * 4;
+				for (int c = 0; c < 3; c++)
+				{
+					out[c] = static_cast<unsigned char>(std::min(255.0f, in[c] * tint[c]));
+				}
+				out[3] = in[3];
+			}
+		}
+		return variant;
+	}
+
+	bool Load(const std::filesystem::path& path, Image& image)
+	{
+		int channels { 0 };
+		unsigned char* pixels = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+		if (pixels == nullptr)
+		{
+			std::cout << "Failed to load texture " << path << "\n";
+			return false;
+		}
+		image.pixels.assign(pixels, pixels + static_cast<std::size_t>(image.width) * image.height * 4);
+		stbi_image_free(pixels);
+		return true;
+	}
+} // anonymous namespace
+
+// Callback function definitions
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("Sprites");
+	TIMELINE_BEGIN("startup");
+
+	const int sprites { (argc > 1) ? std::max(1, std::atoi(argv[1])) : DefaultSprites };
+
+	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "Sprites", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Set some callback functions
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetKeyCallback(window, key_callback);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	// Build and compile our shader programs
+	Shader ourShader = Shader::Load("vs/sprite.c", "fs/quad.c");
+
+	// Every sprite a different image in the atlas
+	TIMELINE_BEGIN("atlas");
+	Image sources[2];
+	if (!Load(std::filesystem::path(TEXTURE_DIR) / "awesomeface.png", sources[0])
+		|| !Load(std::filesystem::path(TEXTURE_DIR) / "container.jpg", sources[1]))
+	{
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TextureAtlas atlas;
+	std::vector<int> images;
+	for (int i = 0; i < sprites; i++)
+	{
+		const int size = SmallestSprite + (i * 37) % (LargestSprite - SmallestSprite + 1);
+		const auto variant = Variant(sources[i % 2], size, i);
+		images.push_back(atlas.Add("sprite" + std::to_string(i), variant.pixels.data(), size, size, 4));
+	}
+	atlas.Build();
+	TIMELINE_END();
+	atlas.Print();
+
+	// One vertex buffer for every sprite, grouped by page, so each page is one draw
+	const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(sprites))));
+	const float cell = 2.0f / static_cast<float>(columns);
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<std::size_t> pageEnds;
+	for (int page = 0; page < atlas.Pages(); page++)
+	{
+		for (int i = 0; i < sprites; i++)
+		{
+			if (images[static_cast<std::size_t>(i)] < 0 || atlas.Region(images[static_cast<std::size_t>(i)]).page != page)
+			{
+				continue;
+			}
+			const AtlasRegion& region = atlas.Region(images[static_cast<std::size_t>(i)]);
+			const float scale = cell * 0.9f * static_cast<float>(region.width) / LargestSprite;
+			const float centreX = -1.0f + cell * (static_cast<float>(i % columns) + 0.5f);
+			const float centreY = 1.0f - cell * (static_cast<float>(i / columns) + 0.5f);
+			const auto first = static_cast<unsigned int>(vertices.size() / 4);
+			float quad[std::size(Quad)];
+			std::copy(std::begin(Quad), std::end(Quad), quad);
+			TextureAtlas::RemapUVs(quad, 4, 4, 2, region);
+			for (std::size_t vertex = 0; vertex < 4; vertex++)
+			{
+				vertices.push_back(centreX + quad[vertex * 4] * scale);
+				vertices.push_back(centreY + quad[vertex * 4 + 1] * scale);
+				vertices.push_back(quad[vertex * 4 + 2]);
+				vertices.push_back(quad[vertex * 4 + 3]);
+			}
+			for (const unsigned int index : QuadIndices)
+			{
+				indices.push_back(first + index);
+			}
+		}
+		pageEnds.push_back(indices.size());
+	}
+
+	unsigned int VBO, VAO, EBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	ourShader.vertexAttribPointer(ourShader.attribute("aPos"), 2, GL_FLOAT, false, 4 * sizeof(float), (void*)0);
+	ourShader.vertexAttribPointer(ourShader.attribute("aTexCoord"), 2, GL_FLOAT, false, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+	std::cout << sprites << " sprites in " << pageEnds.size() << " draws and binds a frame\n";
+
+	// Use our shader
+	ourShader.use();
+	ourShader.setInt("material", 0);
+
+	// awesomeface.png is see-through around the face
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
+	// Render loop
+	while (!glfwWindowShouldClose(window))
+	{
+		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		// One bind and one draw for each page
+		ourShader.use();
+		glBindVertexArray(VAO);
+		std::size_t begin { 0 };
+		for (int page = 0; page < atlas.Pages(); page++)
+		{
+			const std::size_t end = pageEnds[static_cast<std::size_t>(page)];
+			atlas.Bind(page, 0);
+			glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(end - begin), GL_UNSIGNED_INT,
+				(void*)(begin * sizeof(unsigned int)));
+			begin = end;
+		}
+
+		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+	}
+
+	// Clean up buffers
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	atlas.Clear();
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
+
+// Callback function for key press
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS)
+	{
+		return;
+	}
+	switch (key)
+	{
+	// Quit
+	case GLFW_KEY_ESCAPE:
+	case GLFW_KEY_Q:
+		glfwSetWindowShouldClose(window, GL_TRUE);
+		break;
+	default:
+		break;
+	}
+}
+
+// Callback function for window resize
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+	glViewport(0, 0, width, height);
+}
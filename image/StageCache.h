@@ -0,0 +1,92 @@
+// StageCache.h
+//
+// Header-only process-wide cache of compiled shader stages, keyed by the hash
+// of their fully expanded source, so identical stages compile only once
+
+#ifndef STAGE_CACHE_H
+#define STAGE_CACHE_H
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <glad/glad.h>
+
+class StageCache
+{
+public:
+	// One cache per process (and per context)
+	static StageCache& Instance() {
+		static StageCache cache;
+		return cache;
+	}
+
+	// A compiled stage; fresh means this call started the compile, so the
+	// caller is the one that should check its status
+	struct Stage
+	{
+		unsigned int object { 0 };
+		bool fresh { false };
+	};
+
+	// Return the stage for this source, compiling it only the first time; the
+	// status is never queried here, so many compiles can be in flight at once
+	Stage Acquire(GLenum type, const std::string& code, std::uint64_t hash) {
+		const auto key = std::make_pair(type, hash);
+		const auto found = stages.find(key);
+		if (found != stages.end())
+		{
+			reused++;
+			return { found->second, false };
+		}
+		const char* source = code.c_str();
+		const unsigned int object { glCreateShader(type) };
+		glShaderSource(object, 1, &source, nullptr);
+		glCompileShader(object);
+		stages.emplace(key, object);
+		compiled++;
+		return { object, true };
+	}
+
+	// Delete one stage, for a compile whose program was abandoned before it
+	// was checked; programs already linked are unaffected
+	void Discard(GLenum type, std::uint64_t hash) {
+		const auto found = stages.find(std::make_pair(type, hash));
+		if (found != stages.end())
+		{
+			glDeleteShader(found->second);
+			stages.erase(found);
+		}
+	}
+
+	// Delete every cached stage; programs already linked are unaffected
+	void Clear() {
+		for (const auto& [key, object] : stages)
+		{
+			glDeleteShader(object);
+		}
+		stages.clear();
+	}
+
+	// Statistics
+	unsigned int Compiled() const {
+		return compiled;
+	}
+	unsigned int Reused() const {
+		return reused;
+	}
+	void Print() const {
+		std::cout << "Stage cache: " << compiled << " compiled, " << reused << " reused\n";
+	}
+
+private:
+	StageCache() = default;
+
+	std::map<std::pair<GLenum, std::uint64_t>, unsigned int> stages;
+	unsigned int compiled { 0 };
+	unsigned int reused { 0 };
+};
+
+#endif
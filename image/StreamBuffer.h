@@ -0,0 +1,268 @@
+// StreamBuffer.h
+//
+// Header-only ring buffer for vertex, index and uniform data rewritten every
+// frame: one large buffer split into a region per frame in flight, each
+// guarded by a fence, so the CPU writes one region while the GPU is still
+// reading the others and only waits if it gets a whole ring ahead
+//
+//	StreamBuffer stream(10 << 20);
+//	stream.Begin();
+//	const auto vertices = stream.Allocate(bytes, sizeof(Vertex));  // or Write(data, count)
+//	Fill(vertices.data);
+//	const auto block = stream.Allocate(sizeof(block), stream.UniformAlignment());
+//	stream.Flush();                                                 // before the draws that read it
+//	glBindBuffer(GL_ARRAY_BUFFER, stream.ID);                       // vertex data at vertices.offset
+//	glBindBufferRange(GL_UNIFORM_BUFFER, binding, stream.ID, block.offset, sizeof(block));
+//	Draw();
+//	stream.End();                                                   // after the last of them
+//
+// With ARB_buffer_storage the buffer is mapped once, persistently and
+// coherently, for its whole life; otherwise each frame's region is mapped
+// unsynchronized (the fence has already said nothing reads it) and unmapped
+// again by Flush()
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "UniformBuffer.h"
+
+class StreamBuffer
+{
+public:
+	// Space handed out in the current frame: where to write it, and where it is in the buffer
+	struct Allocation
+	{
+		void* data { nullptr };
+		std::size_t offset { 0 };
+
+		explicit operator bool() const {
+			return data != nullptr;
+		}
+	};
+
+	// Room for frameBytes a frame, for each of frames frames in flight;
+	// persistent mapping is used when asked for and the driver has it
+	explicit StreamBuffer(std::size_t frameBytes, int frames = 3, bool persistent = true)
+		: regionBytes(AlignUp(frameBytes, RegionAlignment)), fences(static_cast<std::size_t>(std::max(1, frames)), nullptr),
+		persistent(persistent && GLAD_GL_ARB_buffer_storage) {
+		int alignment { 0 };
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		uniformAlignment = static_cast<std::size_t>(std::max(alignment, 1));
+
+		glGenBuffers(1, &ID);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		const auto size = static_cast<GLsizeiptr>(regionBytes * fences.size());
+		if (this->persistent)
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+			mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+			if (mapped == nullptr)
+			{
+				// fall back to mapping each frame's region, and unmapping it in Flush()
+				std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED\n";
+				this->persistent = false;
+			}
+		}
+		else
+		{
+			glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	~StreamBuffer() {
+		for (const GLsync fence : fences)
+		{
+			if (fence != nullptr)
+			{
+				glDeleteSync(fence);
+			}
+		}
+		// deleting a buffer unmaps it
+		glDeleteBuffers(1, &ID);
+	}
+
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	// Start writing the next frame's region, waiting if the GPU still reads it
+	void Begin() {
+		region = static_cast<std::size_t>(frame % fences.size());
+		head = region * regionBytes;
+		GLsync& fence = fences[region];
+		if (fence != nullptr)
+		{
+			const auto start = Clock::now();
+			GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			if (result == GL_TIMEOUT_EXPIRED)
+			{
+				while ((result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WaitTimeout)) == GL_TIMEOUT_EXPIRED)
+				{
+				}
+				stalls++;
+				stallTime += Clock::now() - start;
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+			if (result == GL_WAIT_FAILED)
+			{
+				std::cout << "ERROR::STREAM_BUFFER::WAIT_FAILED\n";
+			}
+		}
+	}
+
+	// bytes of this frame's region, starting at a multiple of alignment (a vertex
+	// stride, 4 for indices, UniformAlignment() for blocks); empty when the region is full
+	Allocation Allocate(std::size_t bytes, std::size_t alignment = 4) {
+		const std::size_t offset = AlignUp(head, alignment);
+		const std::size_t end = (region + 1) * regionBytes;
+		if (offset + bytes > end)
+		{
+			if (overflows++ == 0)
+			{
+				std::cout << "ERROR::STREAM_BUFFER::FULL asked for " << bytes << " bytes with "
+					<< (end > head ? end - head : 0) << " left this frame\n";
+			}
+			return {};
+		}
+		if (!Map())
+		{
+			return {};
+		}
+		head = offset + bytes;
+		written += bytes;
+		return { mapped + (offset - mappedOffset), offset };
+	}
+
+	// Allocate and copy count elements in one go
+	template <typename T>
+	Allocation Write(const T* data, std::size_t count, std::size_t alignment = alignof(T)) {
+		const auto allocation = Allocate(count * sizeof(T), alignment);
+		if (allocation)
+		{
+			std::memcpy(allocation.data, data, count * sizeof(T));
+		}
+		return allocation;
+	}
+
+	// Make everything written so far visible to the draws that follow;
+	// more can be allocated afterwards
+	void Flush() {
+		// persistent is only still set if the persistent map succeeded
+		if (persistent || mapped == nullptr)
+		{
+			return;
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		mapped = nullptr;
+	}
+
+	// Finish the frame: fence the region after the last draw that reads it
+	void End() {
+		Flush();
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frame++;
+	}
+
+	// The alignment glBindBufferRange needs for a uniform block
+	std::size_t UniformAlignment() const {
+		return uniformAlignment;
+	}
+
+	// Bytes a frame, and how many frames are in flight
+	std::size_t FrameBytes() const {
+		return regionBytes;
+	}
+	int Frames() const {
+		return static_cast<int>(fences.size());
+	}
+	bool Persistent() const {
+		return persistent;
+	}
+
+	// Statistics
+	std::uint64_t Written() const {
+		return written;
+	}
+	std::uint64_t Stalls() const {
+		return stalls;
+	}
+	double StallMilliseconds() const {
+		return std::chrono::duration<double, std::milli>(stallTime).count();
+	}
+	std::uint64_t Overflows() const {
+		return overflows;
+	}
+	void ResetStatistics() {
+		written = 0;
+		stalls = 0;
+		stallTime = {};
+		overflows = 0;
+	}
+	void Print() const {
+		std::cout << "StreamBuffer: " << fences.size() << " x " << regionBytes / 1024 << " KB, "
+			<< (persistent ? "persistently mapped" : "mapped each frame") << ", " << frame << " frames, "
+			<< written / (1024 * 1024) << " MB written, " << stalls << " stalls, " << StallMilliseconds()
+			<< " ms stalled, " << overflows << " overflows\n";
+	}
+
+	unsigned int ID { 0 };
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Every region starts on a boundary that suits any vertex, index or uniform data
+	static constexpr std::size_t RegionAlignment { 256 };
+
+	// How long each wait for a fence blocks before trying again, in nanoseconds
+	static constexpr GLuint64 WaitTimeout { 1000000 };
+
+	// Without persistent mapping, map the rest of this frame's region
+	bool Map() {
+		if (mapped != nullptr)
+		{
+			return true;
+		}
+		const std::size_t end = (region + 1) * regionBytes;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(head),
+			static_cast<GLsizeiptr>(end - head), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (mapped == nullptr)
+		{
+			std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED\n";
+			return false;
+		}
+		mappedOffset = head;
+		return true;
+	}
+
+	std::size_t regionBytes;
+	std::vector<GLsync> fences;
+	bool persistent;
+	std::size_t uniformAlignment { 256 };
+	unsigned char* mapped { nullptr };
+	std::size_t mappedOffset { 0 };
+	std::size_t region { 0 };
+	std::size_t head { 0 };
+	std::uint64_t frame { 0 };
+	std::uint64_t written { 0 };
+	std::uint64_t stalls { 0 };
+	Clock::duration stallTime {};
+	std::uint64_t overflows { 0 };
+};
+
+#endif
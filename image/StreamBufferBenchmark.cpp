@@ -0,0 +1,223 @@
+// StreamBufferBenchmark.cpp
+//
+// Measure streaming a new set of vertices every frame (10 MB by default), a
+// grid of quads that moves each frame, three ways: orphaned with glBufferData
+// and uploaded with glBufferSubData from a CPU copy, written straight into a
+// StreamBuffer region mapped unsynchronized each frame, and written into a
+// persistently mapped StreamBuffer (with ARB_buffer_storage)
+//
+// Usage: StreamBufferBenchmark.bin [frames] [megabytes]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "StreamBuffer.h"
+#include "Timeline.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Defaults, overridable from the command line
+	constexpr int DefaultFrames { 200 };
+	constexpr int DefaultMegabytes { 10 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// The vertex format of vs/sprite.c
+	struct Vertex
+	{
+		float x, y;
+		float u, v;
+	};
+
+	// Write the quads of a grid, each wobbling a little with the frame
+	void FillQuads(Vertex* out, int quads, int frame)
+	{
+		const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(quads))));
+		const float cell = 2.0f / static_cast<float>(columns);
+		const float wobble = 0.25f * cell * std::sin(static_cast<float>(frame) * 0.1f);
+		for (int i = 0; i < quads; i++)
+		{
+			const float x = -1.0f + cell * static_cast<float>(i % columns) + wobble;
+			const float y = -1.0f + cell * static_cast<float>(i / columns);
+			const float size = cell * 0.8f;
+			out[0] = { x, y, 0.0f, 0.0f };
+			out[1] = { x + size, y, 1.0f, 0.0f };
+			out[2] = { x + size, y + size, 1.0f, 1.0f };
+			out[3] = { x, y + size, 0.0f, 1.0f };
+			out += 4;
+		}
+	}
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("StreamBufferBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	const int frames { (argc > 1) ? std::max(1, std::atoi(argv[1])) : DefaultFrames };
+	const int megabytes { (argc > 2) ? std::max(1, std::atoi(argv[2])) : DefaultMegabytes };
+	const int quads { static_cast<int>((static_cast<std::size_t>(megabytes) << 20) / (4 * sizeof(Vertex))) };
+	const std::size_t bytes { static_cast<std::size_t>(quads) * 4 * sizeof(Vertex) };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "StreamBufferBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	// Measure the streaming, not the display
+	glfwSwapInterval(0);
+	TIMELINE_END();
+
+	Shader shader = Shader::Load("vs/sprite.c", "fs/quad.c");
+	shader.use();
+	shader.setInt("material", 0);
+
+	// The quads change every frame, but how they are put together does not
+	std::vector<unsigned int> indices;
+	indices.reserve(static_cast<std::size_t>(quads) * 6);
+	for (unsigned int quad = 0; quad < static_cast<unsigned int>(quads); quad++)
+	{
+		for (const unsigned int corner : { 0u, 1u, 2u, 0u, 2u, 3u })
+		{
+			indices.push_back(quad * 4 + corner);
+		}
+	}
+	unsigned int EBO;
+	glGenBuffers(1, &EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	const auto count = static_cast<GLsizei>(indices.size());
+
+	// A vertex array reading from a buffer, every frame's vertices addressed by a base vertex
+	auto makeVertexArray = [&](unsigned int buffer) {
+		unsigned int VAO;
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		return VAO;
+	};
+
+	// Keep fill rate out of the measurement
+	glViewport(0, 0, 16, 16);
+
+	// Run one pass of the benchmark, returning the average microseconds per frame
+	// spent writing and issuing commands, and including the GPU finishing them
+	auto run = [&](auto&& drawFrame) {
+		double submitUs { 0.0 };
+		glFinish();
+		const auto start = Clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			const auto frameStart = Clock::now();
+			glClear(GL_COLOR_BUFFER_BIT);
+			drawFrame(frame);
+			const std::chrono::duration<double, std::micro> submitted = Clock::now() - frameStart;
+			submitUs += submitted.count();
+			glfwSwapBuffers(window);
+		}
+		glFinish();
+		const std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+		return std::make_pair(submitUs / frames, elapsed.count() / frames);
+	};
+	auto report = [&](const char* name, const std::pair<double, double>& result) {
+		std::cout << "  " << name << result.first << " us/frame submit, " << result.second << " us/frame total, "
+			<< static_cast<double>(bytes) / result.second << " MB/s\n";
+	};
+
+	std::cout << frames << " frames, " << quads << " quads, " << bytes / 1024 << " KB of vertices per frame\n";
+
+	// Before: the buffer orphaned and refilled from a CPU copy every frame
+	{
+		unsigned int VBO;
+		glGenBuffers(1, &VBO);
+		const unsigned int VAO = makeVertexArray(VBO);
+		std::vector<Vertex> staging(static_cast<std::size_t>(quads) * 4);
+		report("glBufferSubData     : ", run([&](int frame) {
+			FillQuads(staging.data(), quads, frame);
+			glBindBuffer(GL_ARRAY_BUFFER, VBO);
+			glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes), staging.data());
+			glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
+		}));
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+	}
+
+	// After: written in place into a ring, mapped each frame and then persistently
+	for (const bool persistent : { false, true })
+	{
+		if (persistent && !GLAD_GL_ARB_buffer_storage)
+		{
+			std::cout << "  persistent mapping  : ARB_buffer_storage is not available\n";
+			continue;
+		}
+		StreamBuffer stream(bytes, 3, persistent);
+		const unsigned int VAO = makeVertexArray(stream.ID);
+		report(persistent ? "persistent mapping  : " : "unsynchronized map  : ", run([&](int frame) {
+			stream.Begin();
+			const auto vertices = stream.Allocate(bytes, sizeof(Vertex));
+			if (vertices)
+			{
+				FillQuads(static_cast<Vertex*>(vertices.data), quads, frame);
+				stream.Flush();
+				glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0,
+					static_cast<GLint>(vertices.offset / sizeof(Vertex)));
+			}
+			stream.End();
+		}));
+		stream.Print();
+		glDeleteVertexArrays(1, &VAO);
+	}
+
+	// Clean up
+	glDeleteBuffers(1, &EBO);
+	glDeleteProgram(shader.ID);
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+// StreamingTexture.h
+//
+// Header-only texture rewritten every frame (video, procedural content, CPU
+// drawn overlays) through a ring of pixel buffer objects: each frame is written
+// into the next buffer, mapped unsynchronized, and copied into the texture by
+// the GPU, with a fence per buffer so the CPU only ever waits for a copy that
+// is a whole ring behind
+//
+//	StreamingTexture overlay(2048, 2048);
+//	if (unsigned char* pixels = overlay.Map())  // rows of overlay.Stride() bytes, bottom row first
+//	{
+//		Draw(pixels);
+//		overlay.Commit();
+//	}
+//	overlay.Bind(1);
+//
+// With no buffers at all, frames are written to client memory and copied by
+// glTexSubImage2D, which is the stall the ring exists to avoid
+
+#ifndef STREAMING_TEXTURE_H
+#define STREAMING_TEXTURE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Texture.h"
+
+class StreamingTexture
+{
+public:
+	// A width x height texture fed through a ring of buffers (0 for client memory);
+	// with options.mipmaps, the chain is rebuilt on the GPU after every frame
+	StreamingTexture(int width, int height, int channels = 4, int buffers = 3,
+		const TextureOptions& options = { true, 4, false, false, MipFilter::Gpu, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR })
+		: width(width), height(height), channels(channels), stride((static_cast<std::size_t>(width) * channels + 3) / 4 * 4),
+		options(options), pbos(static_cast<std::size_t>(std::max(0, buffers)), 0), fences(pbos.size(), nullptr) {
+		glGenTextures(1, &ID);
+		glBindTexture(GL_TEXTURE_2D, ID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.magFilter);
+		TextureStorage(GL_TEXTURE_2D, options.mipmaps ? MipLevels(width, height) : 1, channels, options.srgb, width, height);
+
+		if (pbos.empty())
+		{
+			client.resize(Bytes());
+			return;
+		}
+		glGenBuffers(static_cast<GLsizei>(pbos.size()), pbos.data());
+		for (const unsigned int pbo : pbos)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(Bytes()), nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	~StreamingTexture() {
+		for (const GLsync fence : fences)
+		{
+			if (fence != nullptr)
+			{
+				glDeleteSync(fence);
+			}
+		}
+		if (!pbos.empty())
+		{
+			glDeleteBuffers(static_cast<GLsizei>(pbos.size()), pbos.data());
+		}
+		glDeleteTextures(1, &ID);
+	}
+
+	StreamingTexture(const StreamingTexture&) = delete;
+	StreamingTexture& operator=(const StreamingTexture&) = delete;
+
+	// Memory for the next frame, Stride() bytes a row; nullptr if the buffer would not map
+	// Waits only if the GPU has not finished copying out of this buffer yet
+	unsigned char* Map() {
+		if (pbos.empty())
+		{
+			return client.data();
+		}
+		const std::size_t slot = frame % pbos.size();
+		if (fences[slot] != nullptr)
+		{
+			const auto start = Clock::now();
+			GLenum result = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			if (result == GL_TIMEOUT_EXPIRED)
+			{
+				while ((result = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, WaitTimeout)) == GL_TIMEOUT_EXPIRED)
+				{
+				}
+				stalls++;
+				stallTime += Clock::now() - start;
+			}
+			glDeleteSync(fences[slot]);
+			fences[slot] = nullptr;
+			if (result == GL_WAIT_FAILED)
+			{
+				std::cout << "ERROR::STREAMING_TEXTURE::WAIT_FAILED\n";
+			}
+		}
+		// the fence says nothing reads this buffer, so the driver need not check either
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[slot]);
+		auto* mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(Bytes()),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (mapped == nullptr)
+		{
+			std::cout << "ERROR::STREAMING_TEXTURE::MAP_FAILED\n";
+		}
+		return mapped;
+	}
+
+	// Copy what was written into the texture, and fence the buffer it came from
+	void Commit() {
+		const GLenum format = TextureFormat(channels);
+		glBindTexture(GL_TEXTURE_2D, ID);
+		if (pbos.empty())
+		{
+			// the copy out of client memory has to finish before this returns
+			const auto start = Clock::now();
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, client.data());
+			stallTime += Clock::now() - start;
+			stalls++;
+		}
+		else
+		{
+			const std::size_t slot = frame % pbos.size();
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[slot]);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		if (options.mipmaps)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		frame++;
+		uploaded += Bytes();
+	}
+
+	// Bind to a texture unit
+	void Bind(unsigned int unit) const {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, ID);
+	}
+
+	// Bytes per row, and per frame
+	std::size_t Stride() const {
+		return stride;
+	}
+	std::size_t Bytes() const {
+		return stride * static_cast<std::size_t>(height);
+	}
+
+	// Statistics
+	std::uint64_t Frames() const {
+		return frame;
+	}
+	std::uint64_t Uploaded() const {
+		return uploaded;
+	}
+	std::uint64_t Stalls() const {
+		return stalls;
+	}
+	double StallMilliseconds() const {
+		return std::chrono::duration<double, std::milli>(stallTime).count();
+	}
+	void ResetStatistics() {
+		uploaded = 0;
+		stalls = 0;
+		stallTime = {};
+	}
+	void Print() const {
+		std::cout << "StreamingTexture: " << width << "x" << height << " through " << pbos.size() << " buffers, "
+			<< frame << " frames, " << stalls << " stalls, " << StallMilliseconds() << " ms stalled\n";
+	}
+
+	unsigned int ID { 0 };
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// How long each wait for a fence blocks before trying again, in nanoseconds
+	static constexpr GLuint64 WaitTimeout { 1000000 };
+
+	int width;
+	int height;
+	int channels;
+	std::size_t stride;
+	TextureOptions options;
+	std::vector<unsigned int> pbos;
+	std::vector<GLsync> fences;
+	std::vector<unsigned char> client;
+	std::uint64_t frame { 0 };
+	std::uint64_t uploaded { 0 };
+	std::uint64_t stalls { 0 };
+	Clock::duration stallTime {};
+};
+
+#endif
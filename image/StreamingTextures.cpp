@@ -0,0 +1,285 @@
+// StreamingTextures.cpp
+//
+// Textures.cpp with the second texture replaced by a 2048x2048 pattern that is
+// drawn on the CPU and uploaded again every frame through a StreamingTexture
+// Upload bandwidth and the time spent waiting on the GPU are printed every second
+//
+// Usage: StreamingTextures.bin [buffers=3]   (0 uploads from client memory)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "ShaderWatcher.h"
+#include "StreamingTexture.h"
+#include "TextureCache.h"
+#include "Timeline.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Size of the streamed texture
+	constexpr int StreamSize { 2048 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// Moving interference rings, a new frame for every time value
+	void Pattern(unsigned char* pixels, std::size_t stride, double time)
+	{
+		const auto shift = static_cast<std::uint32_t>(time * 240.0);
+		for (int y = 0; y < StreamSize; y++)
+		{
+			auto* row = reinterpret_cast<std::uint32_t*>(pixels + static_cast<std::size_t>(y) * stride);
+			const std::uint32_t dy = static_cast<std::uint32_t>(y - StreamSize / 2);
+			for (int x = 0; x < StreamSize; x++)
+			{
+				const std::uint32_t dx = static_cast<std::uint32_t>(x - StreamSize / 2);
+				const std::uint32_t ring = ((dx * dx + dy * dy) >> 10) + shift;
+				const std::uint32_t band = (static_cast<std::uint32_t>(x) ^ static_cast<std::uint32_t>(y)) + shift;
+				row[x] = (ring & 0xffu) | ((band & 0xffu) << 8) | (((ring ^ band) & 0xffu) << 16) | 0xff000000u;
+			}
+		}
+	}
+} // anonymous namespace
+
+// Callback function definitions
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("StreamingTextures");
+	TIMELINE_BEGIN("startup");
+
+	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "StreamingTextures", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Set some callback functions
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetKeyCallback(window, key_callback);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	// Stream as fast as we can, not at the refresh rate
+	glfwSwapInterval(0);
+
+	// Build and compile our shader programs
+	Shader ourShader = Shader::Load("vs/texture.c", "fs/texture.c");
+
+	// Texture coordiates
+    float vertices[] = {
+        // positions          // colors           // texture coords
+         0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // top right
+         0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // bottom right
+        -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // bottom left
+        -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f  // top left 
+    };
+    unsigned int indices[] = {
+        0, 1, 3, // first triangle
+        1, 2, 3  // second triangle
+    };
+
+	// Show the number of vertex attributes supported
+	int NumVertexAttributesSupported;
+	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &NumVertexAttributesSupported);
+	std::cout << "Number of vertex attributes supported = " << NumVertexAttributesSupported << std::endl;
+
+	unsigned int VBO, VAO, EBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+
+	// bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	// position attribute
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	// color attribute
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	// texture coord attribute
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+
+	// Load the container in the background, and stream the second texture
+	auto& textures = TextureCache::Instance();
+	const auto texture1 = textures.Acquire(std::filesystem::path(TEXTURE_DIR) / "container.jpg");
+	const int buffers { (argc > 1) ? std::max(0, std::atoi(argv[1])) : 3 };
+	auto texture2 = std::make_unique<StreamingTexture>(StreamSize, StreamSize, 4, buffers);
+	std::cout << "Streaming " << StreamSize << "x" << StreamSize << " through "
+		<< ((buffers > 0) ? std::to_string(buffers) + " pixel buffers" : std::string("client memory")) << "\n";
+
+	// Use our shader
+	ourShader.use();
+	//glUniform1i(glGetUniformLocation(ourShader.ID, "texture1"), 0); // set it manually
+	ourShader.setInt("texture2", 1); // or with shader class
+
+	// Draw in wireframe mode
+	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	// Resolve the uniforms once, outside of the render loop
+	auto greenLoc = ourShader.uniform("uniformGreen");
+	auto offsetXLoc = ourShader.uniform("uniformOffsetX");
+	auto offsetYLoc = ourShader.uniform("uniformOffsetY");
+
+	// Reload the shaders whenever their files are edited
+	ShaderWatcher watcher;
+	watcher.Watch(ourShader);
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
+	// Render loop
+	auto reported = Clock::now();
+	while (!glfwWindowShouldClose(window))
+	{
+		// Swap in edited shaders, and look the uniforms up again if we did
+		if (watcher.Update())
+		{
+			greenLoc = ourShader.uniform("uniformGreen");
+			offsetXLoc = ourShader.uniform("uniformOffsetX");
+			offsetYLoc = ourShader.uniform("uniformOffsetY");
+		}
+
+		// Upload a little more of any texture still loading
+		textures.Update();
+
+		// Set the background color to dark red
+		glClearColor(0.3f, 0.1f, 0.1f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		// Get the current time
+		const auto timeValue = glfwGetTime();
+		
+		// Update the amount of green in every vertex
+		const auto greenValue = std::sin(timeValue) / 4.0 + 0.4f;
+		ourShader.setFloat(greenLoc, greenValue);
+
+		// Move the texture in a circle
+		const auto offsetValueX = std::sin(timeValue) / 2.0;
+		const auto offsetValueY = std::cos(timeValue) / 2.0;
+		ourShader.setFloat(offsetXLoc, offsetValueX);
+		ourShader.setFloat(offsetYLoc, offsetValueY);
+
+		// Draw this frame of the pattern straight into the next buffer
+		if (unsigned char* pixels = texture2->Map())
+		{
+			Pattern(pixels, texture2->Stride(), timeValue);
+			texture2->Commit();
+		}
+
+		// Show both textures
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, texture1.ID());
+		texture2->Bind(1);
+
+		// Actually render the container
+		ourShader.use();
+		glBindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+
+		// Report once a second
+		const std::chrono::duration<double> elapsed = Clock::now() - reported;
+		if (elapsed.count() >= 1.0)
+		{
+			const double frames = std::max(1.0, static_cast<double>(texture2->Uploaded()) / static_cast<double>(texture2->Bytes()));
+			std::cout << std::fixed << std::setprecision(1) << frames / elapsed.count() << " frames/s, "
+				<< texture2->Uploaded() / (1024.0 * 1024.0) / elapsed.count() << " MB/s uploaded, "
+				<< std::setprecision(3) << texture2->StallMilliseconds() / frames << " ms/frame stalled ("
+				<< texture2->Stalls() << " stalls)\n" << std::defaultfloat;
+			texture2->ResetStatistics();
+			reported = Clock::now();
+		}
+	}
+
+	// Clean up buffers
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	textures.Clear();
+	texture2->Print();
+	texture2.reset();
+	watcher.Stop();
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
+
+// Callback function for key press
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	// Handle a few types of key presses
+	if (action == GLFW_PRESS)
+	{
+		switch (key)
+		{
+		case GLFW_KEY_ESCAPE:
+		case GLFW_KEY_Q:
+			glfwSetWindowShouldClose(window, GL_TRUE);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+// Callback function for window resize
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+	glViewport(0, 0, width, height);
+}
@@ -0,0 +1,124 @@
+// Texture.h
+//
+// Header-only helpers shared by everything that turns an image into a texture:
+// the load options, the GL formats for a channel count, storage, and size estimates
+
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <algorithm>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// How the mip chain is built
+enum class MipFilter
+{
+	Gpu,    // glGenerateMipmap, with whatever filter the driver picks
+	Box,    // on the CPU by MipGenerator, 2x2 box
+	Tent,   // on the CPU by MipGenerator, separable 4-tap tent
+};
+
+// How an image file becomes a texture
+struct TextureOptions
+{
+	bool flip { true };         // images start at the top row, GL textures at the bottom
+	int channels { 0 };         // force 1-4 channels, or 0 to keep the file's
+	bool srgb { false };        // colour data stored as sRGB
+	bool mipmaps { true };      // build the full mip chain
+	MipFilter mipFilter { MipFilter::Gpu };
+	GLint wrap { GL_REPEAT };
+	GLint minFilter { GL_LINEAR };
+	GLint magFilter { GL_LINEAR };
+};
+
+// What a texture turned out to hold
+struct TextureInfo
+{
+	int width { 0 };
+	int height { 0 };
+	int channels { 0 };
+};
+
+// The pixel transfer format for a channel count
+inline GLenum TextureFormat(int channels) {
+	switch (channels)
+	{
+	case 1: return GL_RED;
+	case 2: return GL_RG;
+	case 3: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+// The sized internal format for a channel count
+inline GLint TextureInternalFormat(int channels, bool srgb) {
+	switch (channels)
+	{
+	case 1: return GL_R8;
+	case 2: return GL_RG8;
+	case 3: return srgb ? GL_SRGB8 : GL_RGB8;
+	default: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	}
+}
+
+// Number of levels in a full mip chain
+inline int MipLevels(int width, int height) {
+	int levels { 1 };
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		levels++;
+	}
+	return levels;
+}
+
+// Storage for every level of the bound texture (an array when layers > 0):
+// immutable with glTexStorage where the driver has it, so it is checked for
+// completeness once instead of at every draw, otherwise each level specified up front
+inline void TextureStorage(GLenum target, int levels, int channels, bool srgb, int width, int height, int layers = 0) {
+	const GLint internalFormat = TextureInternalFormat(channels, srgb);
+	if (GLAD_GL_ARB_texture_storage)
+	{
+		if (layers > 0)
+		{
+			glTexStorage3D(target, levels, static_cast<GLenum>(internalFormat), width, height, layers);
+		}
+		else
+		{
+			glTexStorage2D(target, levels, static_cast<GLenum>(internalFormat), width, height);
+		}
+		return;
+	}
+	for (int level = 0; level < levels; level++)
+	{
+		if (layers > 0)
+		{
+			glTexImage3D(target, level, internalFormat, width, height, layers, 0, TextureFormat(channels), GL_UNSIGNED_BYTE, nullptr);
+		}
+		else
+		{
+			glTexImage2D(target, level, internalFormat, width, height, 0, TextureFormat(channels), GL_UNSIGNED_BYTE, nullptr);
+		}
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+// Estimated GPU bytes for a texture; drivers pad RGB out to four bytes a texel
+inline std::size_t TextureBytes(int width, int height, int channels, bool mipmaps) {
+	const std::size_t texel = (channels == 3) ? 4 : static_cast<std::size_t>(channels);
+	std::size_t bytes { 0 };
+	const int levels = mipmaps ? MipLevels(width, height) : 1;
+	for (int level = 0; level < levels; level++)
+	{
+		bytes += static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * texel;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return bytes;
+}
+
+#endif
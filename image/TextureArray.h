@@ -0,0 +1,130 @@
+// TextureArray.h
+//
+// Header-only GL_TEXTURE_2D_ARRAY with immutable storage: images of one size
+// and channel count go into layers, and a shader picks the layer per draw, so
+// any number of materials are drawn with a single texture bind
+//
+//	TextureArray materials(64, 64, 4, 256);
+//	const int brick = materials.Load("brick.png");    // layer index, or -1
+//	materials.GenerateMipmaps();
+//	materials.Bind(0);                                 // once, for every material
+//
+// Loading uses stb_image; the including program provides the implementation
+
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "PixelConvert.h"
+#include "stb_image.h"
+#include "Texture.h"
+
+class TextureArray
+{
+public:
+	// Storage for up to capacity layers of width x height images
+	TextureArray(int width, int height, int channels, int capacity, const TextureOptions& options = {})
+		: width(width), height(height), channels(channels), capacity(capacity), options(options) {
+		glGenTextures(1, &ID);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, options.minFilter);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, options.magFilter);
+		const int levels = options.mipmaps ? MipLevels(width, height) : 1;
+		TextureStorage(GL_TEXTURE_2D_ARRAY, levels, channels, options.srgb, width, height, capacity);
+	}
+
+	~TextureArray() {
+		glDeleteTextures(1, &ID);
+	}
+
+	TextureArray(TextureArray&& other) noexcept
+		: ID(std::exchange(other.ID, 0)), width(other.width), height(other.height), channels(other.channels),
+		capacity(other.capacity), used(other.used), options(other.options) {
+	}
+	TextureArray& operator=(TextureArray&&) = delete;
+	TextureArray(const TextureArray&) = delete;
+	TextureArray& operator=(const TextureArray&) = delete;
+
+	// Copy tightly packed pixels, top row first, into the next free layer;
+	// returns the layer, or -1 if the image does not match or there is no room
+	int Add(const unsigned char* pixels, int imageWidth, int imageHeight, int imageChannels) {
+		if (imageWidth != width || imageHeight != height || imageChannels != channels)
+		{
+			std::cout << "ERROR::TEXTURE_ARRAY::IMAGE_MISMATCH: " << imageWidth << "x" << imageHeight << "x" << imageChannels
+				<< " into a " << width << "x" << height << "x" << channels << " array\n";
+			return -1;
+		}
+		if (used == capacity)
+		{
+			std::cout << "ERROR::TEXTURE_ARRAY::FULL: all " << capacity << " layers are in use\n";
+			return -1;
+		}
+		PixelConversion conversion;
+		conversion.channels = channels;
+		conversion.flip = options.flip;
+		const auto staging = UploadPool::Instance().Acquire(PixelConvert::Stride(width, conversion) * static_cast<std::size_t>(height));
+		PixelConvert::Image(pixels, width, height, conversion, staging.data());
+		glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, used, width, height, 1, PixelConvert::Format(conversion),
+			GL_UNSIGNED_BYTE, staging.data());
+		return used++;
+	}
+
+	// Decode an image file into the next free layer
+	int Load(const std::filesystem::path& path) {
+		int imageWidth { 0 };
+		int imageHeight { 0 };
+		int fileChannels { 0 };
+		unsigned char* pixels = stbi_load(path.c_str(), &imageWidth, &imageHeight, &fileChannels, channels);
+		if (pixels == nullptr)
+		{
+			std::cout << "Failed to load texture " << path << "\n";
+			return -1;
+		}
+		const int layer = Add(pixels, imageWidth, imageHeight, channels);
+		stbi_image_free(pixels);
+		return layer;
+	}
+
+	// Build the mips of every layer, once they are all in
+	void GenerateMipmaps() const {
+		if (options.mipmaps)
+		{
+			glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		}
+	}
+
+	// Bind to a texture unit
+	void Bind(unsigned int unit) const {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+	}
+
+	// Layers filled so far, and the most there can be
+	int Layers() const {
+		return used;
+	}
+	int Capacity() const {
+		return capacity;
+	}
+
+	unsigned int ID { 0 };
+
+private:
+	int width;
+	int height;
+	int channels;
+	int capacity;
+	int used { 0 };
+	TextureOptions options;
+};
+
+#endif
@@ -0,0 +1,318 @@
+// TextureArrays.cpp
+//
+// Stress scene: hundreds of quads, each with its own material texture, drawn
+// either with one GL_TEXTURE_2D per material (a bind per quad) or with every
+// material a layer of one GL_TEXTURE_2D_ARRAY (one bind per frame)
+// Press space to switch; frame times and binds per frame are printed every second
+//
+// Usage: TextureArrays.bin [quads]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "PixelConvert.h"
+#include "TextureArray.h"
+#include "Texture.h"
+#include "Timeline.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 800 };
+
+	// Default number of quads, and the size of every material
+	constexpr int DefaultQuads { 576 };
+	constexpr int MaterialSize { 64 };
+
+	// Whether the array is in use; space toggles it
+	bool useArray { true };
+
+	using Clock = std::chrono::steady_clock;
+
+	// A distinct material for every index: the container, turned and tinted
+	std::vector<unsigned char> Material(const unsigned char* pixels, int width, int height, int index)
+	{
+		std::vector<unsigned char> material(MaterialSize * MaterialSize * 4);
+		const float hue = static_cast<float>(index) * 0.61803f;
+		const float tint[3] {
+			0.6f + 0.4f * std::cos(6.2832f * hue),
+			0.6f + 0.4f * std::cos(6.2832f * (hue + 0.333f)),
+			0.6f + 0.4f * std::cos(6.2832f * (hue + 0.667f)),
+		};
+		for (int y = 0; y < MaterialSize; y++)
+		{
+			for (int x = 0; x < MaterialSize; x++)
+			{
+				// a quarter turn for every index, so neighbours differ in shape too
+				int u { x };
+				int v { y };
+				for (int turn = 0; turn < index % 4; turn++)
+				{
+					std::swap(u, v);
+					u = MaterialSize - 1 - u;
+				}
+				const unsigned char* source = pixels + (static_cast<std::size_t>(v * height / MaterialSize) * width
+					+ static_cast<std::size_t>(u * width / MaterialSize)) * 3;
+				unsigned char* target = material.data() + (static_cast<std::size_t>(y) * MaterialSize + x) * 4;
+				for (int c = 0; c < 3; c++)
+				{
+					target[c] = static_cast<unsigned char>(std::min(255.0f, source[c] * tint[c]));
+				}
+				target[3] = 255;
+			}
+		}
+		return material;
+	}
+} // anonymous namespace
+
+// Callback function definitions
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("TextureArrays");
+	TIMELINE_BEGIN("startup");
+
+	const int quads { (argc > 1) ? std::max(1, std::atoi(argv[1])) : DefaultQuads };
+
+	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "TextureArrays", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Set some callback functions
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetKeyCallback(window, key_callback);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	// Measure the draws, not the display
+	glfwSwapInterval(0);
+
+	// The same quad shader, sampling a texture or a layer of the array
+	Shader single = Shader::Load("vs/quad.c", "fs/quad.c");
+	Shader layered = Shader::Load("vs/quad.c", "fs/quad.c", { { "TEXTURE_ARRAY", "1" } });
+
+	// A unit quad
+	float vertices[] = {
+	// positions   // texture coords
+		1.0f, 1.0f,   1.0f, 1.0f, // top right
+		1.0f, 0.0f,   1.0f, 0.0f, // bottom right
+		0.0f, 0.0f,   0.0f, 0.0f, // bottom left
+		0.0f, 1.0f,   0.0f, 1.0f  // top left
+	};
+	unsigned int indices[] = {
+		0, 1, 3, // first triangle
+		1, 2, 3  // second triangle
+	};
+	unsigned int VBO, VAO, EBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	single.vertexAttribPointer(single.attribute("aPos"), 2, GL_FLOAT, false, 4 * sizeof(float), (void*)0);
+	single.vertexAttribPointer(single.attribute("aTexCoord"), 2, GL_FLOAT, false, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+
+	// Every material twice over: as its own texture, and as a layer of the array
+	TIMELINE_BEGIN("materials");
+	int width, height, channels;
+	const auto path = std::filesystem::path(TEXTURE_DIR) / "container.jpg";
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 3);
+	if (data == nullptr)
+	{
+		std::cout << "Failed to load texture " << path << "\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	int maxLayers { 0 };
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	// Both sets are flipped and filtered the same, so switching only changes the binds
+	TextureOptions options;
+	options.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	PixelConversion conversion;
+	conversion.flip = options.flip;
+	std::vector<unsigned char> flipped(PixelConvert::Stride(MaterialSize, conversion) * MaterialSize);
+	std::optional<TextureArray> array;
+	array.emplace(MaterialSize, MaterialSize, 4, std::min(quads, maxLayers), options);
+	std::vector<unsigned int> separate(static_cast<std::size_t>(quads));
+	glGenTextures(quads, separate.data());
+	for (int i = 0; i < quads; i++)
+	{
+		const auto material = Material(data, width, height, i);
+		array->Add(material.data(), MaterialSize, MaterialSize, 4);
+		PixelConvert::Image(material.data(), MaterialSize, MaterialSize, conversion, flipped.data());
+		glBindTexture(GL_TEXTURE_2D, separate[static_cast<std::size_t>(i)]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.magFilter);
+		TextureStorage(GL_TEXTURE_2D, MipLevels(MaterialSize, MaterialSize), 4, options.srgb, MaterialSize, MaterialSize);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, MaterialSize, MaterialSize, PixelConvert::Format(conversion),
+			GL_UNSIGNED_BYTE, flipped.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	array->GenerateMipmaps();
+	stbi_image_free(data);
+	TIMELINE_END();
+	std::cout << quads << " quads, " << array->Layers() << " array layers, immutable storage "
+		<< (GLAD_GL_ARB_texture_storage ? "on" : "off") << "\n";
+
+	// Resolve the uniforms once, outside of the render loop
+	const auto singleQuad = single.uniform("quad");
+	const auto layeredQuad = layered.uniform("quad");
+	const auto layerLoc = layered.uniform("layer");
+	single.use();
+	single.setInt("material", 0);
+	layered.use();
+	layered.setInt("material", 0);
+
+	// Lay the quads out on a square grid
+	const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(quads))));
+	const float cell = 2.0f / static_cast<float>(columns);
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
+	// Render loop
+	auto reported = Clock::now();
+	int frames { 0 };
+	long long binds { 0 };
+	while (!glfwWindowShouldClose(window))
+	{
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glBindVertexArray(VAO);
+
+		const bool layers = useArray && array->Layers() == quads;
+		Shader& shader = layers ? layered : single;
+		shader.use();
+		glActiveTexture(GL_TEXTURE0);
+		if (layers)
+		{
+			// one bind for every material
+			array->Bind(0);
+			binds++;
+		}
+		for (int i = 0; i < quads; i++)
+		{
+			const glm::vec4 quad(-1.0f + cell * static_cast<float>(i % columns), -1.0f + cell * static_cast<float>(i / columns),
+				cell * 0.9f, cell * 0.9f);
+			if (layers)
+			{
+				shader.setInt(layerLoc, i);
+				shader.setVec4(layeredQuad, quad);
+			}
+			else
+			{
+				glBindTexture(GL_TEXTURE_2D, separate[static_cast<std::size_t>(i)]);
+				binds++;
+				shader.setVec4(singleQuad, quad);
+			}
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+
+		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+
+		// Report once a second
+		frames++;
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - reported;
+		if (elapsed.count() >= 1000.0)
+		{
+			std::ostringstream report;
+			report << (layers ? "texture array" : "separate textures") << ": " << std::fixed << std::setprecision(3)
+				<< elapsed.count() / frames << " ms/frame, " << binds / frames << " binds/frame";
+			std::cout << report.str() << "\n";
+			glfwSetWindowTitle(window, report.str().c_str());
+			reported = Clock::now();
+			frames = 0;
+			binds = 0;
+		}
+	}
+
+	// Clean up
+	glDeleteTextures(quads, separate.data());
+	array.reset();
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
+
+// Callback function for key press
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS)
+	{
+		return;
+	}
+	switch (key)
+	{
+	// Quit
+	case GLFW_KEY_ESCAPE:
+	case GLFW_KEY_Q:
+		glfwSetWindowShouldClose(window, GL_TRUE);
+		break;
+	// Switch between separate textures and the array
+	case GLFW_KEY_SPACE:
+		useArray = !useArray;
+		break;
+	default:
+		break;
+	}
+}
+
+// Callback function for window resize
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+	glViewport(0, 0, width, height);
+}
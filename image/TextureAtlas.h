@@ -0,0 +1,387 @@
+// TextureAtlas.h
+//
+// Header-only texture atlas: many small images are packed (skyline, bottom
+// left) into one or a few RGBA pages, each image in a cell of repeated edge
+// texels, so that one bind and one draw cover every sprite on a page
+//
+//	TextureAtlas atlas;
+//	atlas.Load(std::filesystem::path(TEXTURE_DIR) / "awesomeface.png");
+//	atlas.Build();                                          // pack and upload
+//	const AtlasRegion* face = atlas.Find("awesomeface");
+//	TextureAtlas::RemapUVs(vertices, 4, 8, 6, *face);       // the quad in Textures.cpp
+//
+// Cells start and end on multiples of the alignment, so mip levels down to
+// log2(alignment) never average two images together, but bilinear filtering
+// also reads half a texel past an image's edge, so the padding has to stay at
+// least a texel wide too; the pages stop at log2(padding), or log2(alignment)
+// if that comes first
+// Loading uses stb_image; the including program provides the implementation
+
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "stb_image.h"
+#include "Texture.h"
+
+// How the atlas lays out and samples its pages
+struct AtlasOptions
+{
+	int pageSize { 2048 };  // width of every page, and the most height one can have
+	int padding { 2 };      // edge texels repeated around each image, for bilinear filtering
+	int alignment { 8 };    // cells are multiples of this, for mip levels that stay apart
+	TextureOptions texture { true, 4, false, true, MipFilter::Gpu, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR };
+};
+
+// Where an image ended up
+struct AtlasRegion
+{
+	int page { -1 };
+	int x { 0 };            // the image itself, in page texels, without its gutter
+	int y { 0 };
+	int width { 0 };
+	int height { 0 };
+	float u0 { 0.0f };      // texture coordinates of the image's corners: (u0, v0) is where
+	float v0 { 0.0f };      // (0, 0) was for the image on its own, flipped or not
+	float u1 { 0.0f };
+	float v1 { 0.0f };
+};
+
+class TextureAtlas
+{
+public:
+	explicit TextureAtlas(const AtlasOptions& options = {}) : options(options) {
+		this->options.alignment = std::max(1, options.alignment);
+		this->options.pageSize = (options.pageSize / this->options.alignment) * this->options.alignment;
+	}
+
+	~TextureAtlas() {
+		Release();
+	}
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// Copy tightly packed pixels, top row first, into the atlas; returns the
+	// image's index, or -1 if it cannot fit on a page
+	int Add(std::string name, const unsigned char* pixels, int width, int height, int channels) {
+		if (CellSize(width) > options.pageSize || CellSize(height) > options.pageSize)
+		{
+			std::cout << "ERROR::TEXTURE_ATLAS::TOO_LARGE: " << name << " is " << width << "x" << height
+				<< ", pages are " << options.pageSize << " texels\n";
+			return -1;
+		}
+		Source source { std::move(name), width, height, std::vector<unsigned char>(static_cast<std::size_t>(width) * height * 4) };
+		for (std::size_t texel = 0; texel < static_cast<std::size_t>(width) * height; texel++)
+		{
+			const unsigned char* in = pixels + texel * channels;
+			unsigned char* out = source.pixels.data() + texel * 4;
+			out[0] = in[0];
+			out[1] = (channels >= 3) ? in[1] : in[0];
+			out[2] = (channels >= 3) ? in[2] : in[0];
+			out[3] = (channels == 4) ? in[3] : (channels == 2) ? in[1] : 255;
+		}
+		sources.push_back(std::move(source));
+		return static_cast<int>(sources.size()) - 1;
+	}
+
+	// Decode an image file, named after its stem
+	int Load(const std::filesystem::path& path) {
+		int width { 0 };
+		int height { 0 };
+		int channels { 0 };
+		unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+		if (pixels == nullptr)
+		{
+			std::cout << "Failed to load texture " << path << "\n";
+			return -1;
+		}
+		const int index = Add(path.stem().string(), pixels, width, height, 4);
+		stbi_image_free(pixels);
+		return index;
+	}
+
+	// Pack everything added so far, tallest first, and upload the pages;
+	// building again repacks from scratch
+	void Build() {
+		Release();
+		regions.assign(sources.size(), AtlasRegion {});
+		std::vector<std::size_t> order(sources.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+			return (sources[a].height != sources[b].height) ? sources[a].height > sources[b].height
+				: sources[a].width > sources[b].width;
+		});
+
+		std::vector<Skyline> skylines;
+		for (const std::size_t index : order)
+		{
+			const int width = CellSize(sources[index].width);
+			const int height = CellSize(sources[index].height);
+			AtlasRegion& region = regions[index];
+			region.width = sources[index].width;
+			region.height = sources[index].height;
+			for (std::size_t page = 0; page < skylines.size() && region.page < 0; page++)
+			{
+				Place(skylines[page], static_cast<int>(page), width, height, region);
+			}
+			if (region.page < 0)
+			{
+				skylines.push_back(Skyline { { Segment { 0, 0, options.pageSize } }, 0 });
+				Place(skylines.back(), static_cast<int>(skylines.size()) - 1, width, height, region);
+			}
+		}
+
+		// Pages are only as tall as what was packed into them
+		textures.resize(skylines.size());
+		glGenTextures(static_cast<GLsizei>(textures.size()), textures.data());
+		for (std::size_t page = 0; page < skylines.size(); page++)
+		{
+			const int width = options.pageSize;
+			const int height = skylines[page].top;
+			std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * 4);
+			for (std::size_t index = 0; index < sources.size(); index++)
+			{
+				AtlasRegion& region = regions[index];
+				if (region.page == static_cast<int>(page))
+				{
+					Compose(sources[index], region, width, pixels);
+					region.u0 = static_cast<float>(region.x) / width;
+					region.u1 = static_cast<float>(region.x + region.width) / width;
+					region.v0 = static_cast<float>(region.y) / height;
+					region.v1 = static_cast<float>(region.y + region.height) / height;
+				}
+			}
+			Upload(textures[page], width, height, pixels);
+			used += static_cast<double>(width) * height;
+		}
+	}
+
+	// An image's place, by index or by name (nullptr if there is none)
+	const AtlasRegion& Region(int index) const {
+		return regions[static_cast<std::size_t>(index)];
+	}
+	const AtlasRegion* Find(std::string_view name) const {
+		for (std::size_t index = 0; index < sources.size() && index < regions.size(); index++)
+		{
+			if (sources[index].name == name)
+			{
+				return &regions[index];
+			}
+		}
+		return nullptr;
+	}
+
+	// Map texture coordinates in [0, 1] for a whole image onto its region; every
+	// vertex is stride floats apart, with u and v at offset (so 8 and 6 for the
+	// interleaved position, colour, coordinate arrays in Textures.cpp)
+	// Coordinates outside [0, 1] would reach into the neighbours, so atlas
+	// images cannot repeat
+	static void RemapUVs(float* vertices, std::size_t count, std::size_t stride, std::size_t offset, const AtlasRegion& region) {
+		for (std::size_t vertex = 0; vertex < count; vertex++)
+		{
+			float* uv = vertices + vertex * stride + offset;
+			uv[0] = region.u0 + uv[0] * (region.u1 - region.u0);
+			uv[1] = region.v0 + uv[1] * (region.v1 - region.v0);
+		}
+	}
+
+	// Pages built, and binding one to a texture unit
+	int Pages() const {
+		return static_cast<int>(textures.size());
+	}
+	unsigned int Texture(int page) const {
+		return textures[static_cast<std::size_t>(page)];
+	}
+	void Bind(int page, unsigned int unit) const {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, Texture(page));
+	}
+
+	// Share of the page texels the images themselves cover
+	double Occupancy() const {
+		double images { 0.0 };
+		for (const auto& source : sources)
+		{
+			images += static_cast<double>(source.width) * source.height;
+		}
+		return (used > 0.0) ? images / used : 0.0;
+	}
+
+	// Delete the pages and forget every image
+	void Clear() {
+		Release();
+		sources.clear();
+		regions.clear();
+	}
+
+	void Print() const {
+		std::cout << "TextureAtlas: " << sources.size() << " images on " << textures.size() << " pages of "
+			<< options.pageSize << " texels, " << static_cast<int>(Occupancy() * 100.0 + 0.5) << "% occupied\n";
+	}
+
+private:
+	// An added image, as RGBA
+	struct Source
+	{
+		std::string name;
+		int width { 0 };
+		int height { 0 };
+		std::vector<unsigned char> pixels;
+	};
+
+	// The top of the packed cells: horizontal runs, left to right, that tile the page width
+	struct Segment
+	{
+		int x { 0 };
+		int y { 0 };
+		int width { 0 };
+	};
+	struct Skyline
+	{
+		std::vector<Segment> segments;
+		int top { 0 }; // highest packed texel, the page height
+	};
+
+	int CellSize(int size) const {
+		return (size + 2 * options.padding + options.alignment - 1) / options.alignment * options.alignment;
+	}
+
+	// Put a width x height cell where its top is lowest (then leftmost); false if it does not fit
+	bool Place(Skyline& skyline, int page, int width, int height, AtlasRegion& region) const {
+		auto& segments = skyline.segments;
+		std::size_t best = segments.size();
+		int bestY = std::numeric_limits<int>::max();
+		for (std::size_t first = 0; first < segments.size(); first++)
+		{
+			if (segments[first].x + width > options.pageSize)
+			{
+				break;
+			}
+			// resting on the highest segment underneath the cell
+			int y { 0 };
+			for (std::size_t i = first; i < segments.size() && segments[i].x < segments[first].x + width; i++)
+			{
+				y = std::max(y, segments[i].y);
+			}
+			if (y + height <= options.pageSize && y < bestY)
+			{
+				best = first;
+				bestY = y;
+			}
+		}
+		if (best == segments.size())
+		{
+			return false;
+		}
+
+		// The cell becomes a new segment, over the ones it covers
+		const int x = segments[best].x;
+		std::size_t last = best;
+		while (last < segments.size() && segments[last].x + segments[last].width <= x + width)
+		{
+			last++;
+		}
+		if (last < segments.size() && segments[last].x < x + width)
+		{
+			const int right = segments[last].x + segments[last].width;
+			segments[last].x = x + width;
+			segments[last].width = right - segments[last].x;
+		}
+		segments.erase(segments.begin() + best, segments.begin() + last);
+		segments.insert(segments.begin() + best, Segment { x, bestY + height, width });
+		for (std::size_t i = 1; i < segments.size();)
+		{
+			if (segments[i].y == segments[i - 1].y)
+			{
+				segments[i - 1].width += segments[i].width;
+				segments.erase(segments.begin() + i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+		skyline.top = std::max(skyline.top, bestY + height);
+
+		region.page = page;
+		region.x = x + options.padding;
+		region.y = bestY + options.padding;
+		return true;
+	}
+
+	// Copy an image into its cell, repeating the edge texels out to the cell's border;
+	// flipped images go in bottom row first, like every other GL texture here
+	void Compose(const Source& source, const AtlasRegion& region, int pageWidth, std::vector<unsigned char>& pixels) const {
+		const int left = region.x - options.padding;
+		const int bottom = region.y - options.padding;
+		const int width = CellSize(source.width);
+		const int height = CellSize(source.height);
+		for (int row = 0; row < height; row++)
+		{
+			const int y = std::clamp(row - options.padding, 0, source.height - 1);
+			const int sourceRow = options.texture.flip ? source.height - 1 - y : y;
+			unsigned char* out = pixels.data() + (static_cast<std::size_t>(bottom + row) * pageWidth + left) * 4;
+			const unsigned char* in = source.pixels.data() + static_cast<std::size_t>(sourceRow) * source.width * 4;
+			for (int column = 0; column < width; column++)
+			{
+				const int x = std::clamp(column - options.padding, 0, source.width - 1);
+				std::copy_n(in + x * 4, 4, out + column * 4);
+			}
+		}
+	}
+
+	// Immutable storage down to the last level where the cells stay apart and
+	// the padding is still a whole texel
+	void Upload(unsigned int texture, int width, int height, const std::vector<unsigned char>& pixels) const {
+		const int apart = std::min(options.alignment, std::max(options.padding, 1));
+		int levels { 1 };
+		while ((apart >> levels) > 0 && levels < MipLevels(width, height))
+		{
+			levels++;
+		}
+		if (!options.texture.mipmaps)
+		{
+			levels = 1;
+		}
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.texture.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.texture.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (levels > 1) ? options.texture.minFilter : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.texture.magFilter);
+		TextureStorage(GL_TEXTURE_2D, levels, 4, options.texture.srgb, width, height);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		if (levels > 1)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+	}
+
+	void Release() {
+		if (!textures.empty())
+		{
+			glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+			textures.clear();
+		}
+		used = 0.0;
+	}
+
+	AtlasOptions options;
+	std::vector<Source> sources;
+	std::vector<AtlasRegion> regions;
+	std::vector<unsigned int> textures;
+	double used { 0.0 };
+};
+
+#endif
@@ -0,0 +1,83 @@
+// TextureBaker.cpp
+//
+// Bake images into the memory-mappable files read by BakedTexture: decoded,
+// flipped, expanded to RGB/RGBA and with every mip level already built
+//
+// Usage: TextureBaker.bin [--tent] [--srgb] [image...]
+// With no images, every image in TEXTURE_DIR is baked into BAKED_TEXTURE_DIR
+// --tent filters the mips with a 4-tap tent instead of a box, --srgb marks the
+// colour as sRGB, which the mips are then filtered in linear space for
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BakedTexture.h"
+#include "Timeline.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("TextureBaker");
+
+	// The images to bake, and how
+	TextureOptions options;
+	options.mipFilter = MipFilter::Box;
+	std::vector<std::filesystem::path> images;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument { argv[i] };
+		if (argument == "--tent")
+		{
+			options.mipFilter = MipFilter::Tent;
+		}
+		else if (argument == "--srgb")
+		{
+			options.srgb = true;
+		}
+		else
+		{
+			images.emplace_back(argument);
+		}
+	}
+	if (images.empty())
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(TEXTURE_DIR))
+		{
+			if (entry.is_regular_file())
+			{
+				images.push_back(entry.path());
+			}
+		}
+	}
+
+	// Bake each one, reporting what it became
+	int failed { 0 };
+	for (const auto& image : images)
+	{
+		TIMELINE_SCOPE(image.filename().string());
+		const auto output = BakedTexture::PathFor(image);
+		if (!BakedTexture::Bake(image, output, options))
+		{
+			failed++;
+			continue;
+		}
+		const BakedTexture baked(output);
+		if (!baked)
+		{
+			failed++;
+			continue;
+		}
+		const auto& header = baked.header();
+		std::cout << image.filename().string() << " -> " << output << ": " << header.width << "x" << header.height
+			<< ", " << header.channels << " channels, " << header.levels << " levels, "
+			<< std::filesystem::file_size(output) / 1024 << " KB (" << MipGenerator::Kernel() << " mips)\n";
+	}
+	return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
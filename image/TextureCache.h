@@ -0,0 +1,245 @@
+// TextureCache.h
+//
+// Header-only process-wide texture cache
+// Acquire() hands out ref-counted handles, so asking for the same image with
+// the same options twice shares one texture; textures nobody holds stay cached
+// until the estimated GPU memory goes over the budget, and are then deleted
+// least recently used first
+//
+// Textures load through a TextureLoader, so Update() must be called once per
+// frame, and Clear() before the context goes away
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "Texture.h"
+#include "TextureLoader.h"
+
+// A shared reference to a cached texture; the texture cannot be evicted while one exists
+class TextureHandle
+{
+public:
+	TextureHandle() = default;
+
+	// The texture name, or 0 for an empty handle
+	unsigned int ID() const {
+		return entry ? entry->texture : 0;
+	}
+
+	// Whether the image has been uploaded, rather than the placeholder showing
+	bool Ready() const {
+		return entry && entry->bytes != 0;
+	}
+
+	// Bind to a texture unit
+	void Bind(unsigned int unit) const {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, ID());
+	}
+
+	// Let go of the texture early
+	void Reset() {
+		entry.reset();
+	}
+
+	explicit operator bool() const {
+		return entry != nullptr;
+	}
+
+private:
+	friend class TextureCache;
+
+	struct Entry
+	{
+		std::string key;
+		unsigned int texture { 0 };
+		bool mipmaps { true };
+		std::size_t bytes { 0 };    // 0 until the image has been uploaded
+		std::uint64_t lastUsed { 0 };
+	};
+
+	explicit TextureHandle(std::shared_ptr<Entry> entry) : entry(std::move(entry)) {
+	}
+
+	std::shared_ptr<Entry> entry;
+};
+
+class TextureCache
+{
+public:
+	// Textures nobody holds are kept until this much is in use
+	static constexpr std::size_t DefaultBudget { 256u << 20 };
+
+	// One cache per process (and per context)
+	static TextureCache& Instance() {
+		static TextureCache cache;
+		return cache;
+	}
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// The texture for an image file, loaded the first time it is asked for
+	// Sampler state is taken from the options of the first request only
+	TextureHandle Acquire(const std::filesystem::path& path, const TextureOptions& options = {}) {
+		const auto key = Key(path, options);
+		tick++;
+		const auto found = entries.find(key);
+		if (found != entries.end())
+		{
+			hits++;
+			found->second->lastUsed = tick;
+			return TextureHandle(found->second);
+		}
+		misses++;
+		if (!loader)
+		{
+			loader = std::make_unique<TextureLoader>();
+		}
+		auto entry = std::make_shared<TextureHandle::Entry>();
+		entry->key = key;
+		entry->texture = loader->Load(path, options);
+		entry->mipmaps = options.mipmaps;
+		entry->lastUsed = tick;
+		entries.emplace(key, entry);
+		return TextureHandle(std::move(entry));
+	}
+
+	// Call once per frame: keep uploading, then account for what finished
+	void Update() {
+		if (!loader)
+		{
+			return;
+		}
+		loader->Update();
+		bool grown { false };
+		for (auto& [key, entry] : entries)
+		{
+			if (entry->bytes != 0)
+			{
+				continue;
+			}
+			if (const auto info = loader->Info(entry->texture))
+			{
+				entry->bytes = TextureBytes(info->width, info->height, info->channels, entry->mipmaps);
+				bytes += entry->bytes;
+				grown = true;
+			}
+		}
+		if (grown)
+		{
+			Trim();
+		}
+	}
+
+	// Change the budget, evicting straight away if it is now exceeded
+	void SetBudget(std::size_t limit) {
+		budget = limit;
+		Trim();
+	}
+
+	// Evict unreferenced textures, oldest first, until under the budget
+	// Textures still loading are never evicted, as the loader is about to write to them
+	void Trim() {
+		while (bytes > budget)
+		{
+			auto victim = entries.end();
+			for (auto it = entries.begin(); it != entries.end(); ++it)
+			{
+				const auto& entry = it->second;
+				if (entry.use_count() > 1 || !loader->Ready(entry->texture))
+				{
+					continue;
+				}
+				if (victim == entries.end() || entry->lastUsed < victim->second->lastUsed)
+				{
+					victim = it;
+				}
+			}
+			if (victim == entries.end())
+			{
+				return;
+			}
+			Delete(*victim->second);
+			entries.erase(victim);
+			evictions++;
+		}
+	}
+
+	// Delete every texture, held or not, and the loader; for shutdown
+	void Clear() {
+		for (auto& [key, entry] : entries)
+		{
+			Delete(*entry);
+		}
+		entries.clear();
+		loader.reset();
+	}
+
+	// Statistics
+	unsigned int Hits() const {
+		return hits;
+	}
+	unsigned int Misses() const {
+		return misses;
+	}
+	unsigned int Evictions() const {
+		return evictions;
+	}
+	std::size_t Bytes() const {
+		return bytes;
+	}
+	std::size_t Textures() const {
+		return entries.size();
+	}
+	void Print() const {
+		std::cout << "Texture cache: " << entries.size() << " textures, " << bytes / 1024 << " of " << budget / 1024
+			<< " KB, " << hits << " hits, " << misses << " misses, " << evictions << " evictions\n";
+	}
+
+private:
+	TextureCache() = default;
+
+	// Everything that changes the pixels; the same file read differently is a different texture
+	static std::string Key(const std::filesystem::path& path, const TextureOptions& options) {
+		std::error_code error;
+		auto canonical = std::filesystem::weakly_canonical(path, error);
+		if (error)
+		{
+			canonical = std::filesystem::absolute(path);
+		}
+		return canonical.string() + "|" + (options.flip ? "flip" : "") + "|" + std::to_string(options.channels) + "|"
+			+ (options.srgb ? "srgb" : "") + "|" + (options.mipmaps ? "mips" : "") + "|"
+			+ std::to_string(static_cast<int>(options.mipFilter));
+	}
+
+	void Delete(TextureHandle::Entry& entry) {
+		glDeleteTextures(1, &entry.texture);
+		entry.texture = 0;
+		bytes -= entry.bytes;
+		entry.bytes = 0;
+	}
+
+	std::unique_ptr<TextureLoader> loader;
+	std::map<std::string, std::shared_ptr<TextureHandle::Entry>> entries;
+	std::size_t budget { DefaultBudget };
+	std::size_t bytes { 0 };
+	std::uint64_t tick { 0 };
+	unsigned int hits { 0 };
+	unsigned int misses { 0 };
+	unsigned int evictions { 0 };
+};
+
+#endif
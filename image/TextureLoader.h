@@ -0,0 +1,298 @@
+// TextureLoader.h
+//
+// Header-only asynchronous texture loading
+// Load() hands back a texture straight away, showing a 1x1 placeholder; the
+// image is decoded on a worker thread, and Update(), called once per frame on
+// the render thread, streams the decoded rows through a pixel buffer object a
+// few megabytes at a time, so no single frame pays for a whole image
+// With a CPU mip filter the mip chain is built on the worker too
+//
+// The including program still provides the stb_image implementation
+
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "MipGenerator.h"
+#include "PixelConvert.h"
+#include "stb_image.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "Timeline.h"
+
+class TextureLoader
+{
+public:
+	// Defaults: a couple of decode threads, and 4 MB of uploads per frame
+	static constexpr std::size_t DefaultBytesPerFrame { 4u << 20 };
+	static unsigned int DefaultThreads() {
+		return std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+	}
+
+	// Constructor
+	explicit TextureLoader(unsigned int threads = DefaultThreads(), std::size_t bytesPerFrame = DefaultBytesPerFrame)
+		: bytesPerFrame(std::max<std::size_t>(bytesPerFrame, 1)), pool(threads) {
+		glGenBuffers(1, &pbo);
+	}
+
+	// The pool drains first, so no worker touches the queue once it is gone
+	~TextureLoader() {
+		glDeleteBuffers(1, &pbo);
+	}
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// Start loading an image; the returned texture is usable at once
+	unsigned int Load(const std::filesystem::path& path, const TextureOptions& options = {}) {
+		unsigned int texture { 0 };
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.magFilter);
+		Placeholder();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.insert(texture);
+		}
+		pool.Submit([this, texture, path, options]() { Decode(texture, path, options); });
+		return texture;
+	}
+
+	// Call once per frame: upload up to the per-frame budget of decoded rows
+	void Update() {
+		std::size_t budget { bytesPerFrame };
+		while (budget > 0)
+		{
+			if (!uploading)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (decoded.empty())
+				{
+					return;
+				}
+				uploading = std::make_unique<Job>(std::move(decoded.front()));
+				decoded.pop_front();
+			}
+			budget -= std::min(budget, UploadRows(*uploading, budget));
+			if (uploading->nextRow >= uploading->height)
+			{
+				Done(*uploading);
+				uploading.reset();
+			}
+		}
+	}
+
+	// Whether a texture has its real contents yet (or failed for good)
+	bool Ready(unsigned int texture) const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return pending.count(texture) == 0;
+	}
+
+	// Number of textures still decoding or uploading
+	std::size_t Pending() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return pending.size();
+	}
+
+	// Size of a texture whose image has been uploaded
+	std::optional<TextureInfo> Info(unsigned int texture) const {
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto found = loaded.find(texture);
+		if (found == loaded.end())
+		{
+			return std::nullopt;
+		}
+		return found->second;
+	}
+
+	// Block until every texture is ready, e.g. for a loading screen or benchmark
+	void Finish() {
+		while (Pending() > 0)
+		{
+			Update();
+			std::this_thread::yield();
+		}
+	}
+
+private:
+	// Frees stb_image allocations
+	struct FreeImage
+	{
+		void operator()(unsigned char* pixels) const {
+			stbi_image_free(pixels);
+		}
+	};
+
+	// One image on its way to the GPU
+	struct Job
+	{
+		unsigned int texture { 0 };
+		std::filesystem::path path;
+		TextureOptions options;
+		int width { 0 };
+		int height { 0 };
+		int channels { 0 };
+		std::unique_ptr<unsigned char, FreeImage> pixels;
+		std::vector<MipGenerator::Level> mips;   // only when built on the CPU
+		int nextRow { 0 };
+	};
+
+	// The 1x1 texture shown until the real one is uploaded
+	static void Placeholder() {
+		const unsigned char grey[4] { 128, 128, 128, 255 };
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	}
+
+	// Worker thread: decode, then queue for upload
+	void Decode(unsigned int texture, const std::filesystem::path& path, const TextureOptions& options) {
+		TIMELINE_SCOPE("decode " + path.filename().string());
+		Job job;
+		job.texture = texture;
+		job.path = path;
+		job.options = options;
+		// no flip here; rows are flipped for free while being copied into the PBO
+		job.pixels.reset(stbi_load(path.c_str(), &job.width, &job.height, &job.channels, options.channels));
+		if (options.channels != 0)
+		{
+			job.channels = options.channels;
+		}
+		if (job.pixels && options.mipmaps && options.mipFilter != MipFilter::Gpu)
+		{
+			BuildMips(job);
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(std::move(job));
+	}
+
+	// Worker thread: the mips of the unflipped image, flipped afterwards to match level 0
+	static void BuildMips(Job& job) {
+		TIMELINE_SCOPE("mips " + job.path.filename().string());
+		MipGenerator::Options mipOptions;
+		mipOptions.filter = job.options.mipFilter;
+		mipOptions.srgb = job.options.srgb;
+		const std::size_t stride = static_cast<std::size_t>(job.width) * static_cast<std::size_t>(job.channels);
+		job.mips = MipGenerator::Chain(job.pixels.get(), job.width, job.height, job.channels, stride, mipOptions);
+		if (!job.options.flip)
+		{
+			return;
+		}
+		for (auto& level : job.mips)
+		{
+			for (int y = 0; y < level.height / 2; y++)
+			{
+				auto* top = level.pixels.data() + static_cast<std::size_t>(y) * level.stride;
+				auto* bottom = level.pixels.data() + static_cast<std::size_t>(level.height - 1 - y) * level.stride;
+				std::swap_ranges(top, top + level.stride, bottom);
+			}
+		}
+	}
+
+	// Upload the next band of rows that fits the budget, returning the bytes used
+	std::size_t UploadRows(Job& job, std::size_t budget) {
+		if (!job.pixels)
+		{
+			std::cout << "Failed to load texture " << job.path << "\n";
+			job.nextRow = job.height;
+			return 0;
+		}
+		TIMELINE_SCOPE("upload " + job.path.filename().string());
+		// Flipped, and RGB expanded to RGBA, on the way into the buffer; the rows come
+		// out four byte aligned, so the upload takes the driver's fast path
+		PixelConversion conversion;
+		conversion.channels = job.channels;
+		conversion.flip = job.options.flip;
+		const GLenum format = PixelConvert::Format(conversion);
+		const std::size_t rowBytes = PixelConvert::Stride(job.width, conversion);
+		const int rows = std::min(job.height - job.nextRow, static_cast<int>(std::max<std::size_t>(budget / rowBytes, 1)));
+		const std::size_t bytes = rowBytes * static_cast<std::size_t>(rows);
+
+		glBindTexture(GL_TEXTURE_2D, job.texture);
+		if (job.nextRow == 0)
+		{
+			// Real storage replaces the placeholder; hide the missing mips until they exist
+			const int levels = job.options.mipmaps ? MipLevels(job.width, job.height) : 1;
+			TextureStorage(GL_TEXTURE_2D, levels, job.channels, job.options.srgb, job.width, job.height);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		}
+
+		// Orphan the buffer, so this band never waits for the previous one to be read
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+		auto* mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+			static_cast<GLsizeiptr>(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+		if (mapped != nullptr)
+		{
+			PixelConvert::Rows(job.pixels.get(), job.width, job.height, conversion, job.nextRow, rows, mapped);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.nextRow, job.width, rows, format, GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		else
+		{
+			// No mapping to be had; go through ordinary memory instead
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			const auto staging = UploadPool::Instance().Acquire(bytes);
+			PixelConvert::Rows(job.pixels.get(), job.width, job.height, conversion, job.nextRow, rows, staging.data());
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.nextRow, job.width, rows, format, GL_UNSIGNED_BYTE, staging.data());
+		}
+		job.nextRow += rows;
+		return bytes;
+	}
+
+	// The last band is in: build the mips and show the texture
+	void Done(Job& job) {
+		if (job.pixels)
+		{
+			glBindTexture(GL_TEXTURE_2D, job.texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+			if (!job.mips.empty())
+			{
+				TIMELINE_SCOPE("upload mips");
+				MipGenerator::Upload(job.mips, job.channels);
+			}
+			else if (job.options.mipmaps)
+			{
+				TIMELINE_SCOPE("glGenerateMipmap");
+				glGenerateMipmap(GL_TEXTURE_2D);
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.erase(job.texture);
+		if (job.pixels)
+		{
+			loaded[job.texture] = { job.width, job.height, job.channels };
+		}
+	}
+
+	std::size_t bytesPerFrame;
+	unsigned int pbo { 0 };
+	mutable std::mutex mutex;
+	std::deque<Job> decoded;
+	std::set<unsigned int> pending;
+	std::map<unsigned int, TextureInfo> loaded;
+	std::unique_ptr<Job> uploading;
+	// Last, so the workers are joined before anything they use goes away
+	ThreadPool pool;
+};
+
+#endif
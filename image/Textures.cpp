@@ -9,7 +9,12 @@
 #include <glad/glad.h> // Must be included before glfw3
 #include <GLFW/glfw3.h>
 
+#include "CompositeCache.h"
 #include "CreateShader.h"
+#include "ShaderWatcher.h"
+#include "TextureCache.h"
+#include "Timeline.h"
+#include "VertexLayout.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -19,6 +24,18 @@ namespace {
 	// Screen height and width
 	constexpr int ScreenWidth { 800 };
 	constexpr int ScreenHeight { 600 };
+
+	// A corner of the rectangle, 16 bytes instead of 8 floats
+	struct Vertex
+	{
+		Half3 position;
+		UNorm8x3 color;
+		UNorm16x2 texCoord;
+		static constexpr auto Attributes() {
+			return std::make_tuple(VertexAttribute("aPos", &Vertex::position), VertexAttribute("aColor", &Vertex::color),
+				VertexAttribute("aTexCoord", &Vertex::texCoord));
+		}
+	};
 } // anonymous namespace
 
 // Callback function definitions
@@ -28,14 +45,22 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // Main function
 int main()
 {
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("Textures");
+	TIMELINE_BEGIN("startup");
+
 	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
 	glfwInit();
+	TIMELINE_END();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
 	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "LearnOpenGL", nullptr, nullptr);
+	TIMELINE_END();
 	if (window == nullptr)
 	{
 		std::cout << "Failed to create GLFW window\n";
@@ -49,7 +74,10 @@ int main()
 	glfwSetKeyCallback(window, key_callback);
 
 	// Make sure GLAD loads
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
 	{
 		std::cout << "Failed to initialize GLAD\n";
 		glfwTerminate();
@@ -57,16 +85,18 @@ int main()
 	}
 
 	// Build and compile our shader programs
-	Shader ourShader("vs/texture.c", "fs/texture.c");
+	Shader ourShader = Shader::Load("vs/texture.c", "fs/texture.c");
+	// The same, sampling one pre-blended texture once both have loaded
+	Shader compositedShader = Shader::Load("vs/texture.c", "fs/texture.c", { { "COMPOSITED", "1" } });
 
 	// Texture coordiates
-    float vertices[] = {
-        // positions          // colors           // texture coords
-         0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // top right
-         0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // bottom right
-        -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // bottom left
-        -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f  // top left 
-    };
+	const Vertex vertices[] = {
+		// positions                  // colors                 // texture coords
+		{ { 0.5f,  0.5f, 0.0f },   { 1.0f, 0.0f, 0.0f },   { 1.0f, 1.0f } }, // top right
+		{ { 0.5f, -0.5f, 0.0f },   { 0.0f, 1.0f, 0.0f },   { 1.0f, 0.0f } }, // bottom right
+		{ { -0.5f, -0.5f, 0.0f },  { 0.0f, 0.0f, 1.0f },   { 0.0f, 0.0f } }, // bottom left
+		{ { -0.5f,  0.5f, 0.0f },  { 1.0f, 1.0f, 0.0f },   { 0.0f, 1.0f } }  // top left
+	};
     unsigned int indices[] = {
         0, 1, 3, // first triangle
         1, 2, 3  // second triangle
@@ -91,63 +121,14 @@ int main()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	// texture coord attribute
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-
-	// load and create a texture
-	unsigned int texture1;
-	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1);
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	int width, height, nrChannels;
-	stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-	const auto Texture1Path = std::filesystem::path(TEXTURE_DIR) / "container.jpg";
-	unsigned char* data = stbi_load(Texture1Path.c_str(), &width, &height, &nrChannels, 0);
-	if (!data)
-	{
-		std::cout << "Failed to load texture\n";
-		return EXIT_FAILURE;
-	}
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(data);
- 
-	// load and create a second texture
-	unsigned int texture2;
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	const auto Texture2Path = std::filesystem::path(TEXTURE_DIR) / "awesomeface.png";
-	data = stbi_load(Texture2Path.c_str(), &width, &height, &nrChannels, 0);
-	if (!data)
-	{
-		std::cout << "Failed to load texture\n";
-		return EXIT_FAILURE;
-	}
-	// note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the data type is of GL_RGBA
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+	// position, color and texture coord attributes, from the Vertex struct
+	VertexLayout<Vertex>::Apply(ourShader);
+
+	// Load both textures in the background; each shows a placeholder until it is ready
+	// (awesomeface.png has an alpha channel, which the loader picks up from the file)
+	auto& textures = TextureCache::Instance();
+	const auto texture1 = textures.Acquire(std::filesystem::path(TEXTURE_DIR) / "container.jpg");
+	const auto texture2 = textures.Acquire(std::filesystem::path(TEXTURE_DIR) / "awesomeface.png");
 
 	// Use our shader
 	ourShader.use();
@@ -158,34 +139,81 @@ int main()
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
+	// Resolve the uniforms once, outside of the render loop, for both programs
+	struct Uniforms
+	{
+		Uniform green;
+		Uniform offsetX;
+		Uniform offsetY;
+	};
+	const auto resolve = [](const Shader& shader) {
+		return Uniforms { shader.uniform("uniformGreen"), shader.uniform("uniformOffsetX"), shader.uniform("uniformOffsetY") };
+	};
+	Uniforms blendLocs = resolve(ourShader);
+	Uniforms compositedLocs = resolve(compositedShader);
+
+	// Blend the two textures once, instead of at every pixel of every frame
+	auto& composites = CompositeCache::Instance();
+
+	// Reload the shaders whenever their files are edited
+	ShaderWatcher watcher;
+	watcher.Watch(ourShader);
+	watcher.Watch(compositedShader);
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
 	// Render loop
 	while (!glfwWindowShouldClose(window))
 	{
+		// Swap in edited shaders, and look the uniforms up again if we did
+		if (watcher.Update())
+		{
+			blendLocs = resolve(ourShader);
+			compositedLocs = resolve(compositedShader);
+		}
+
+		// Upload a little more of any texture still loading
+		textures.Update();
+
 		// Set the background color to dark red
 		glClearColor(0.3f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
+		// Once both textures are in, draw their blend with one sample instead of two
+		const unsigned int composite = composites.Acquire(texture1, texture2);
+		Shader& shader = (composite != 0) ? compositedShader : ourShader;
+		const Uniforms& locs = (composite != 0) ? compositedLocs : blendLocs;
+		shader.use();
+
 		// Get the current time
 		const auto timeValue = glfwGetTime();
 		
 		// Update the amount of green in every vertex
 		const auto greenValue = std::sin(timeValue) / 4.0 + 0.4f;
-		ourShader.setFloat("uniformGreen", greenValue);
+		shader.setFloat(locs.green, greenValue);
 
 		// Move the texture in a circle
 		const auto offsetValueX = std::sin(timeValue) / 2.0;
 		const auto offsetValueY = std::cos(timeValue) / 2.0;
-		ourShader.setFloat("uniformOffsetX", offsetValueX);
-		ourShader.setFloat("uniformOffsetY", offsetValueY);
+		shader.setFloat(locs.offsetX, offsetValueX);
+		shader.setFloat(locs.offsetY, offsetValueY);
 
-		// Show both textures
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
+		// Show both textures, or the one they make
+		if (composite != 0)
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, composite);
+		}
+		else
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture1.ID());
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, texture2.ID());
+		}
 
 		// Actually render the container
-		ourShader.use();
 		glBindVertexArray(VAO);
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
@@ -198,6 +226,10 @@ int main()
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
+	composites.Print();
+	composites.Clear();
+	textures.Clear();
+	watcher.Stop();
 
 	glfwTerminate();
 	return EXIT_SUCCESS;
@@ -0,0 +1,92 @@
+// ThreadPool.h
+//
+// Header-only fixed-size pool of worker threads
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// Constructor, defaulting to one worker per hardware thread
+	explicit ThreadPool(unsigned int count = std::max(1u, std::thread::hardware_concurrency())) {
+		for (unsigned int i = 0; i < count; i++)
+		{
+			workers.emplace_back([this]() { Work(); });
+		}
+	}
+
+	// Finish everything already queued, then join
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Queue a task, returning a future for its result
+	template <typename F>
+	auto Submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+		using Result = std::invoke_result_t<F>;
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		auto future = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.emplace([packaged]() { (*packaged)(); });
+		}
+		wake.notify_one();
+		return future;
+	}
+
+	// Number of worker threads
+	unsigned int Size() const {
+		return static_cast<unsigned int>(workers.size());
+	}
+
+private:
+	// Worker loop: run tasks until asked to stop and the queue is empty
+	void Work() {
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (tasks.empty())
+				{
+					return;
+				}
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping { false };
+};
+
+#endif
@@ -0,0 +1,199 @@
+// Timeline.h
+//
+// Header-only startup timeline: nested, named timings that are written as a
+// Chrome trace (load <program>.timeline.json in chrome://tracing or Perfetto)
+// and printed as an indented summary when the program exits
+//
+// Only compiled in with ENABLE_TIMELINE (cmake -DENABLE_TIMELINE=ON); otherwise
+// every TIMELINE_* macro expands to nothing, so there is no cost at all
+//
+//	TIMELINE_PROGRAM("Coordinates");      // name the output, once, first thing in main
+//	TIMELINE_SCOPE("Shader");             // time the rest of the enclosing block
+//	TIMELINE_BEGIN("glfwInit");           // or time a stretch of statements
+//	TIMELINE_END();
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#ifdef ENABLE_TIMELINE
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class Timeline
+{
+public:
+	// Created by the first timing, written out when the program exits
+	static Timeline& Instance() {
+		static Timeline timeline;
+		return timeline;
+	}
+
+	~Timeline() {
+		if (!name.empty())
+		{
+			Write();
+		}
+	}
+
+	Timeline(const Timeline&) = delete;
+	Timeline& operator=(const Timeline&) = delete;
+
+	// The output is <name>.timeline.json in the working directory
+	void Program(std::string program) {
+		std::lock_guard<std::mutex> lock(mutex);
+		name = std::move(program);
+	}
+
+	// Open a span on this thread; spans nest until the matching End()
+	void Begin(std::string label) {
+		auto& stack = Stack();
+		std::lock_guard<std::mutex> lock(mutex);
+		stack.push_back(events.size());
+		events.push_back({ std::move(label), Now(), 0.0, ThreadId(), static_cast<int>(stack.size()) - 1 });
+	}
+
+	// Close the innermost open span on this thread
+	void End() {
+		auto& stack = Stack();
+		const auto now = Now();
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stack.empty())
+		{
+			return;
+		}
+		auto& event = events[stack.back()];
+		event.duration = now - event.start;
+		stack.pop_back();
+	}
+
+	// Write the trace and print the summary
+	void Write() {
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto file = name + ".timeline.json";
+		std::ofstream out(file);
+		out << "{\"traceEvents\":[\n";
+		for (std::size_t i = 0; i < events.size(); i++)
+		{
+			const auto& event = events[i];
+			out << "{\"name\":\"" << Escape(event.label) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+				<< ",\"ts\":" << std::fixed << std::setprecision(3) << event.start << ",\"dur\":" << event.duration
+				<< "}" << (i + 1 < events.size() ? ",\n" : "\n");
+		}
+		out << "],\"displayTimeUnit\":\"ms\"}\n";
+
+		std::cout << "Startup timeline of " << name << " (" << file << "):\n";
+		for (const auto& event : events)
+		{
+			std::cout << std::fixed << std::setprecision(3) << std::setw(10) << event.duration / 1000.0 << " ms  "
+				<< std::string(static_cast<std::size_t>(event.depth) * 2, ' ') << event.label;
+			if (event.thread != 0)
+			{
+				std::cout << "  [thread " << event.thread << "]";
+			}
+			std::cout << "\n";
+		}
+		std::cout << std::defaultfloat;
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Event
+	{
+		std::string label;
+		double start;     // microseconds since the timeline started
+		double duration;  // microseconds
+		int thread;       // 0 for the thread that started the timeline
+		int depth;
+	};
+
+	Timeline() : origin(Clock::now()), mainThread(std::this_thread::get_id()) {
+	}
+
+	double Now() const {
+		return std::chrono::duration<double, std::micro>(Clock::now() - origin).count();
+	}
+
+	// Small stable thread numbers read better in the trace than native ids
+	int ThreadId() {
+		const auto id = std::this_thread::get_id();
+		if (id == mainThread)
+		{
+			return 0;
+		}
+		const auto found = std::find(threads.begin(), threads.end(), id);
+		if (found != threads.end())
+		{
+			return static_cast<int>(found - threads.begin()) + 1;
+		}
+		threads.push_back(id);
+		return static_cast<int>(threads.size());
+	}
+
+	// Open spans of the calling thread
+	static std::vector<std::size_t>& Stack() {
+		thread_local std::vector<std::size_t> stack;
+		return stack;
+	}
+
+	static std::string Escape(const std::string& text) {
+		std::string escaped;
+		for (const char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	Clock::time_point origin;
+	std::thread::id mainThread;
+	std::mutex mutex;
+	std::string name;
+	std::vector<Event> events;
+	std::vector<std::thread::id> threads;
+};
+
+// Times the rest of the enclosing block
+class TimelineScope
+{
+public:
+	explicit TimelineScope(std::string label) {
+		Timeline::Instance().Begin(std::move(label));
+	}
+	~TimelineScope() {
+		Timeline::Instance().End();
+	}
+	TimelineScope(const TimelineScope&) = delete;
+	TimelineScope& operator=(const TimelineScope&) = delete;
+};
+
+#define TIMELINE_CONCAT_INNER(a, b) a##b
+#define TIMELINE_CONCAT(a, b) TIMELINE_CONCAT_INNER(a, b)
+#define TIMELINE_PROGRAM(name) Timeline::Instance().Program(name)
+#define TIMELINE_SCOPE(label) TimelineScope TIMELINE_CONCAT(timelineScope, __LINE__)(label)
+#define TIMELINE_BEGIN(label) Timeline::Instance().Begin(label)
+#define TIMELINE_END() Timeline::Instance().End()
+
+#else
+
+#define TIMELINE_PROGRAM(name) ((void)0)
+#define TIMELINE_SCOPE(label) ((void)0)
+#define TIMELINE_BEGIN(label) ((void)0)
+#define TIMELINE_END() ((void)0)
+
+#endif
+
+#endif
@@ -13,7 +13,11 @@
 #include <glad/glad.h> // Must be included before glfw3
 #include <GLFW/glfw3.h>
 
+#include "CompositeCache.h"
 #include "CreateShader.h"
+#include "ShaderWatcher.h"
+#include "TextureCache.h"
+#include "Timeline.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -38,14 +42,22 @@ Movement movement;
 // Main function
 int main()
 {
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("Transformations");
+	TIMELINE_BEGIN("startup");
+
 	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
 	glfwInit();
+	TIMELINE_END();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
 	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "LearnOpenGL", nullptr, nullptr);
+	TIMELINE_END();
 	if (window == nullptr)
 	{
 		std::cout << "Failed to create GLFW window\n";
@@ -59,7 +71,10 @@ int main()
 	glfwSetKeyCallback(window, key_callback);
 
 	// Make sure GLAD loads
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
 	{
 		std::cout << "Failed to initialize GLAD\n";
 		glfwTerminate();
@@ -67,7 +82,9 @@ int main()
 	}
 
 	// Build and compile our shader programs
-	Shader ourShader("vs/transform.c", "fs/transform.c");
+	Shader ourShader = Shader::Load("vs/transform.c", "fs/transform.c");
+	// The same, sampling one pre-blended texture once both have loaded
+	Shader compositedShader = Shader::Load("vs/transform.c", "fs/transform.c", { { "COMPOSITED", "1" } });
 
 	// Texture coordiates
 	float vertices[] = {
@@ -118,53 +135,11 @@ int main()
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
 
-	// load and create a texture
-	unsigned int texture1;
-	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1);
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	int width, height, nrChannels;
-	stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-	const auto Texture1Path = std::filesystem::path(TEXTURE_DIR) / "container.jpg";
-	unsigned char* data = stbi_load(Texture1Path.c_str(), &width, &height, &nrChannels, 0);
-	if (!data)
-	{
-		std::cout << "Failed to load texture\n";
-		return EXIT_FAILURE;
-	}
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(data);
-
-	// load and create a second texture
-	unsigned int texture2;
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	const auto Texture2Path = std::filesystem::path(TEXTURE_DIR) / "awesomeface.png";
-	data = stbi_load(Texture2Path.c_str(), &width, &height, &nrChannels, 0);
-	if (!data)
-	{
-		std::cout << "Failed to load texture\n";
-		return EXIT_FAILURE;
-	}
-	// note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the data type is of GL_RGBA
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(data);
+	// Load both textures in the background; each shows a placeholder until it is ready
+	// (awesomeface.png has an alpha channel, which the loader picks up from the file)
+	auto& textures = TextureCache::Instance();
+	const auto texture1 = textures.Acquire(std::filesystem::path(TEXTURE_DIR) / "container.jpg");
+	const auto texture2 = textures.Acquire(std::filesystem::path(TEXTURE_DIR) / "awesomeface.png");
 
 	// tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
 	ourShader.use();
@@ -180,9 +155,34 @@ int main()
 
 	double angle { 0.0 };
 
+	// Resolve the transform uniform once, outside of the render loop, for both programs
+	auto transformLoc = ourShader.uniform("transform");
+	auto compositedTransformLoc = compositedShader.uniform("transform");
+
+	// Blend the two textures once, instead of at every pixel of every frame
+	auto& composites = CompositeCache::Instance();
+
+	// Reload the shaders whenever their files are edited
+	ShaderWatcher watcher;
+	watcher.Watch(ourShader);
+	watcher.Watch(compositedShader);
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
 	// Render loop
 	while (!glfwWindowShouldClose(window))
 	{
+		// Swap in edited shaders, and look the uniform up again if we did
+		if (watcher.Update())
+		{
+			transformLoc = ourShader.uniform("transform");
+			compositedTransformLoc = compositedShader.uniform("transform");
+		}
+
+		// Upload a little more of any texture still loading
+		textures.Update();
+
 		// Set the background color to dark red
 		glClearColor(0.3f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
@@ -195,16 +195,34 @@ int main()
 		// Apply the change in angle
 		angle -= movement.GetVelocityZ() / (6000.0f / (2 * M_PI));
 
-		// Show both textures
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
+		// Once both textures are in, draw their blend with one sample instead of two
+		const unsigned int composite = composites.Acquire(texture1, texture2);
+
+		// Show both textures, or the one they make
+		if (composite != 0)
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, composite);
+		}
+		else
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture1.ID());
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, texture2.ID());
+		}
 
 		// Actually render the container
-		ourShader.use();
-		unsigned int transformLoc = glGetUniformLocation(ourShader.ID, "transform");
-		glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transform));
+		if (composite != 0)
+		{
+			compositedShader.use();
+			compositedShader.setMat4(compositedTransformLoc, transform);
+		}
+		else
+		{
+			ourShader.use();
+			ourShader.setMat4(transformLoc, transform);
+		}
 		glBindVertexArray(VAO);
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
@@ -217,6 +235,10 @@ int main()
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
+	composites.Print();
+	composites.Clear();
+	textures.Clear();
+	watcher.Stop();
 
 	glfwTerminate();
 	return EXIT_SUCCESS;
@@ -0,0 +1,133 @@
+// UniformBenchmark.cpp
+//
+// Measure the CPU cost of setting uniforms every frame, comparing the old
+// by-name path (std::string + glGetUniformLocation) to cached handles
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "Timeline.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Defaults, overridable from the command line
+	constexpr int DefaultFrames { 200 };
+	constexpr int DefaultSetsPerFrame { 3000 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// The way uniforms used to be set: allocate a string, ask the driver
+	void setMat4ByName(const Shader& shader, const std::string& name, const glm::mat4& mat)
+	{
+		glUniformMatrix4fv(glGetUniformLocation(shader.ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	}
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("UniformBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	// Usage: UniformBenchmark.bin [frames] [sets per frame]
+	const int frames { (argc > 1) ? std::atoi(argv[1]) : DefaultFrames };
+	const int setsPerFrame { (argc > 2) ? std::atoi(argv[2]) : DefaultSetsPerFrame };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "UniformBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+
+	// Same program as the Coordinates example
+	Shader ourShader("vs/coordinates.c", "fs/transform.c");
+	ourShader.use();
+
+	const auto identity = glm::mat4(1.0f);
+	const auto model = glm::rotate(identity, glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	const auto view = glm::translate(identity, glm::vec3(0.0f, 0.0f, -3.0f));
+	const auto projection = glm::perspective(glm::radians(45.0f), static_cast<float>(ScreenWidth) / ScreenHeight, 0.1f, 100.0f);
+
+	// Run one pass of the benchmark, returning the average microseconds per frame
+	auto run = [&](auto&& setAll) {
+		glFinish();
+		const auto start = Clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			for (int i = 0; i < setsPerFrame; i += 3)
+			{
+				setAll();
+			}
+		}
+		glFinish();
+		const std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+		return elapsed.count() / frames;
+	};
+
+	// Before: by name, every call
+	const auto byName = run([&]() {
+		setMat4ByName(ourShader, "model", model);
+		setMat4ByName(ourShader, "view", view);
+		setMat4ByName(ourShader, "projection", projection);
+	});
+
+	// After: handles resolved once
+	const auto modelLoc = ourShader.uniform("model");
+	const auto viewLoc = ourShader.uniform("view");
+	const auto projectionLoc = ourShader.uniform("projection");
+	const auto byHandle = run([&]() {
+		ourShader.setMat4(modelLoc, model);
+		ourShader.setMat4(viewLoc, view);
+		ourShader.setMat4(projectionLoc, projection);
+	});
+
+	// Report the results
+	std::cout << frames << " frames, " << setsPerFrame << " uniform sets per frame\n";
+	std::cout << "  by name   : " << byName << " us/frame\n";
+	std::cout << "  by handle : " << byHandle << " us/frame\n";
+	std::cout << "  speedup   : " << (byName / byHandle) << "x\n";
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
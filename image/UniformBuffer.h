@@ -0,0 +1,294 @@
+// UniformBuffer.h
+//
+// Header-only uniform buffer objects with std140 layouts generated from C++ structs
+// https://learnopengl.com/Advanced-OpenGL/Advanced-GLSL
+//
+// A block is a plain struct that lists its members once:
+//
+//	struct FrameBlock
+//	{
+//		glm::mat4 view;
+//		static constexpr const char* Name { "Frame" };
+//		static constexpr auto Members() {
+//			return std::make_tuple(BlockMember("view", &FrameBlock::view));
+//		}
+//	};
+//
+// Std140Layout<FrameBlock> then knows every offset, packs the struct into a
+// buffer, and writes the matching GLSL declaration
+
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Size, alignment and GLSL name of every type a block may contain
+template <typename T> struct Std140Type;
+template <> struct Std140Type<float> {
+	static constexpr std::size_t Align { 4 }, Size { 4 };
+	static constexpr const char* Glsl { "float" };
+};
+template <> struct Std140Type<int> {
+	static constexpr std::size_t Align { 4 }, Size { 4 };
+	static constexpr const char* Glsl { "int" };
+};
+template <> struct Std140Type<unsigned int> {
+	static constexpr std::size_t Align { 4 }, Size { 4 };
+	static constexpr const char* Glsl { "uint" };
+};
+template <> struct Std140Type<glm::vec2> {
+	static constexpr std::size_t Align { 8 }, Size { 8 };
+	static constexpr const char* Glsl { "vec2" };
+};
+template <> struct Std140Type<glm::vec3> {
+	static constexpr std::size_t Align { 16 }, Size { 12 };
+	static constexpr const char* Glsl { "vec3" };
+};
+template <> struct Std140Type<glm::vec4> {
+	static constexpr std::size_t Align { 16 }, Size { 16 };
+	static constexpr const char* Glsl { "vec4" };
+};
+template <> struct Std140Type<glm::mat3> {
+	// every column is padded out to a vec4
+	static constexpr std::size_t Align { 16 }, Size { 48 };
+	static constexpr const char* Glsl { "mat3" };
+};
+template <> struct Std140Type<glm::mat4> {
+	static constexpr std::size_t Align { 16 }, Size { 64 };
+	static constexpr const char* Glsl { "mat4" };
+};
+
+// Copy one value to its std140 position
+template <typename T>
+inline void Std140Write(unsigned char* out, const T& value) {
+	std::memcpy(out, &value, sizeof(T));
+}
+template <>
+inline void Std140Write<glm::mat3>(unsigned char* out, const glm::mat3& value) {
+	for (int column = 0; column < 3; column++)
+	{
+		std::memcpy(out + 16 * column, &value[column][0], 3 * sizeof(float));
+	}
+}
+
+constexpr std::size_t AlignUp(std::size_t value, std::size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// One named member of a block
+template <typename Struct, typename Field>
+struct BlockMember
+{
+	using Type = Field;
+	const char* name;
+	Field Struct::* field;
+
+	constexpr BlockMember(const char* name, Field Struct::* field) : name(name), field(field) {
+	}
+};
+
+// Offsets, packing and GLSL text for a block struct
+template <typename Block>
+class Std140Layout
+{
+public:
+	// A member's name and where std140 puts it
+	struct Field
+	{
+		const char* name;
+		std::size_t offset;
+	};
+
+private:
+	using Members = decltype(Block::Members());
+	static constexpr std::size_t Count { std::tuple_size_v<Members> };
+	template <std::size_t I>
+	using FieldOf = typename std::tuple_element_t<I, Members>::Type;
+
+	template <std::size_t... I>
+	static constexpr std::array<std::size_t, Count + 1> Compute(std::index_sequence<I...>) {
+		constexpr std::size_t aligns[] { Std140Type<FieldOf<I>>::Align... };
+		constexpr std::size_t sizes[] { Std140Type<FieldOf<I>>::Size... };
+		std::array<std::size_t, Count + 1> result {};
+		std::size_t offset { 0 };
+		for (std::size_t i = 0; i < Count; i++)
+		{
+			offset = AlignUp(offset, aligns[i]);
+			result[i] = offset;
+			offset += sizes[i];
+		}
+		// the block as a whole is padded to a vec4
+		result[Count] = AlignUp(offset, 16);
+		return result;
+	}
+	static constexpr auto Layout { Compute(std::make_index_sequence<Count>{}) };
+
+	template <std::size_t... I>
+	static void PackAll(const Block& block, unsigned char* out, std::index_sequence<I...>) {
+		const auto members = Block::Members();
+		(Std140Write(out + Layout[I], block.*(std::get<I>(members).field)), ...);
+	}
+
+	template <std::size_t... I>
+	static auto Describe(std::index_sequence<I...>) {
+		const auto members = Block::Members();
+		return std::array<Field, Count> { Field { std::get<I>(members).name, Layout[I] }... };
+	}
+
+	template <std::size_t... I>
+	static std::string Declare(std::index_sequence<I...>) {
+		const auto members = Block::Members();
+		std::string text;
+		((text += std::string("\t") + Std140Type<FieldOf<I>>::Glsl + " " + std::get<I>(members).name + ";\n"), ...);
+		return text;
+	}
+
+public:
+	// Bytes the block occupies in a buffer
+	static constexpr std::size_t Size { Layout[Count] };
+
+	// Offset of member I
+	template <std::size_t I>
+	static constexpr std::size_t Offset() {
+		return Layout[I];
+	}
+
+	// Every member, in declaration order
+	static std::array<Field, Count> Fields() {
+		return Describe(std::make_index_sequence<Count>{});
+	}
+
+	// Write the struct into std140 form
+	static void Pack(const Block& block, unsigned char* out) {
+		PackAll(block, out, std::make_index_sequence<Count>{});
+	}
+
+	// The GLSL declaration of the block, with an optional instance name
+	static std::string Glsl(std::string_view instance = {}) {
+		std::string text { "layout (std140) uniform " };
+		text += Block::Name;
+		text += "\n{\n" + Declare(std::make_index_sequence<Count>{}) + "}";
+		if (!instance.empty())
+		{
+			text += " ";
+			text += instance;
+		}
+		return text + ";\n";
+	}
+};
+
+// Hands out one binding point per block name, shared by every program
+class BindingPoints
+{
+public:
+	static BindingPoints& Instance() {
+		static BindingPoints points;
+		return points;
+	}
+
+	// The binding point for a block, assigned the first time the name is seen
+	unsigned int Get(const std::string& name) {
+		const auto found = points.find(name);
+		if (found != points.end())
+		{
+			return found->second;
+		}
+		int maximum { 0 };
+		glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maximum);
+		const auto point = static_cast<unsigned int>(points.size());
+		if (static_cast<int>(point) >= maximum)
+		{
+			std::cout << "ERROR::UNIFORM_BUFFER::OUT_OF_BINDING_POINTS for block " << name << "\n";
+		}
+		points.emplace(name, point);
+		return point;
+	}
+
+private:
+	BindingPoints() = default;
+
+	std::map<std::string, unsigned int> points;
+};
+
+// A buffer of one or more instances of a block; each is packed on the CPU,
+// the whole buffer is uploaded with one call, and a single instance is
+// selected per draw with glBindBufferRange
+template <typename Block>
+class UniformBuffer
+{
+public:
+	using Layout = Std140Layout<Block>;
+
+	// Constructor; count is the number of instances (e.g. objects) held
+	explicit UniformBuffer(std::size_t count = 1) : count(count) {
+		int alignment { 0 };
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		stride = AlignUp(Layout::Size, static_cast<std::size_t>(std::max(alignment, 1)));
+		staging.resize(stride * count);
+		binding = BindingPoints::Instance().Get(Block::Name);
+		glGenBuffers(1, &ID);
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+		glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(staging.size()), nullptr, GL_DYNAMIC_DRAW);
+		Bind(0);
+	}
+
+	~UniformBuffer() {
+		glDeleteBuffers(1, &ID);
+	}
+
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	// Pack one instance into the staging copy
+	void Set(std::size_t index, const Block& block) {
+		Layout::Pack(block, staging.data() + index * stride);
+	}
+	void Set(const Block& block) {
+		Set(0, block);
+	}
+
+	// Send the first used instances to the GPU in one glBufferSubData
+	void Upload(std::size_t used) {
+		glBindBuffer(GL_UNIFORM_BUFFER, ID);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(used * stride), staging.data());
+	}
+	void Upload() {
+		Upload(count);
+	}
+
+	// Point the block's binding at one instance
+	void Bind(std::size_t index) const {
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, ID, static_cast<GLintptr>(index * stride),
+			static_cast<GLsizeiptr>(Layout::Size));
+	}
+
+	// Accessors
+	unsigned int Binding() const {
+		return binding;
+	}
+	std::size_t Count() const {
+		return count;
+	}
+
+private:
+	unsigned int ID { 0 };
+	unsigned int binding { 0 };
+	std::size_t count;
+	std::size_t stride { 0 };
+	std::vector<unsigned char> staging;
+};
+
+#endif
@@ -0,0 +1,202 @@
+// UniformBufferBenchmark.cpp
+//
+// Measure the CPU cost of submitting thousands of objects per frame, comparing
+// a glUniformMatrix4fv call per object (view and projection set once a frame)
+// against uniform buffers: the Frame block written once, every Object block
+// packed and uploaded in one call, and one glBindBufferRange per draw
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "FrameBlocks.h"
+#include "Timeline.h"
+#include "UniformBuffer.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Defaults, overridable from the command line
+	constexpr int DefaultFrames { 100 };
+	constexpr int DefaultObjects { 5000 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// Where object i sits this frame
+	glm::mat4 ModelMatrix(int i, int frame)
+	{
+		const float x = static_cast<float>(i % 100) * 0.1f - 5.0f;
+		const float y = static_cast<float>(i / 100 % 100) * 0.1f - 5.0f;
+		auto model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+		return glm::rotate(model, frame * 0.01f + i, glm::vec3(0.5f, 1.0f, 0.0f));
+	}
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("UniformBufferBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	// Usage: UniformBufferBenchmark.bin [frames] [objects]
+	const int frames { (argc > 1) ? std::atoi(argv[1]) : DefaultFrames };
+	const int objects { (argc > 2) ? std::atoi(argv[2]) : DefaultObjects };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "UniformBufferBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+
+	// The block declarations have to exist before any shader includes them
+	RegisterFrameBlocks();
+	Shader plainShader("vs/coordinates.c", "fs/transform.c");
+	Shader blockShader("vs/coordinates_ubo.c", "fs/transform.c");
+	blockShader.validateBlock<FrameBlock>();
+	blockShader.validateBlock<ObjectBlock>();
+
+	// The quad from the Coordinates example
+	float vertices[] = {
+	// positions          // texture coords
+		0.5f,  0.5f, 0.0f,   1.0f, 1.0f, // top right
+		0.5f, -0.5f, 0.0f,   1.0f, 0.0f, // bottom right
+		-0.5f, -0.5f, 0.0f,   0.0f, 0.0f, // bottom left
+		-0.5f,  0.5f, 0.0f,   0.0f, 1.0f  // top left
+	};
+	unsigned int indices[] = {
+		0, 1, 3, // first triangle
+		1, 2, 3  // second triangle
+	};
+	unsigned int VBO, VAO, EBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	blockShader.vertexAttribPointer(blockShader.attribute("aPos"), 3, GL_FLOAT, false, 5 * sizeof(float), (void*)0);
+	blockShader.vertexAttribPointer(blockShader.attribute("aTexCoord"), 2, GL_FLOAT, false, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+
+	// Keep fill rate out of the measurement
+	glViewport(0, 0, 16, 16);
+
+	const auto view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -12.0f));
+	const auto projection = glm::perspective(glm::radians(45.0f), static_cast<float>(ScreenWidth) / ScreenHeight, 0.1f, 100.0f);
+
+	// Run one pass of the benchmark, returning the average microseconds per frame
+	// spent issuing commands, and including the GPU finishing them
+	auto run = [&](auto&& drawFrame) {
+		double submitUs { 0.0 };
+		glFinish();
+		const auto start = Clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			const auto frameStart = Clock::now();
+			drawFrame(frame);
+			const std::chrono::duration<double, std::micro> submitted = Clock::now() - frameStart;
+			submitUs += submitted.count();
+			glFlush();
+		}
+		glFinish();
+		const std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+		return std::make_pair(submitUs / frames, elapsed.count() / frames);
+	};
+
+	// Before: view and projection set on the program once a frame, the model for every object
+	const auto modelLoc = plainShader.uniform("model");
+	const auto viewLoc = plainShader.uniform("view");
+	const auto projectionLoc = plainShader.uniform("projection");
+	plainShader.use();
+	const auto perUniform = run([&](int frame) {
+		glClear(GL_COLOR_BUFFER_BIT);
+		plainShader.setMat4(viewLoc, view);
+		plainShader.setMat4(projectionLoc, projection);
+		for (int i = 0; i < objects; i++)
+		{
+			plainShader.setMat4(modelLoc, ModelMatrix(i, frame));
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+	});
+
+	// After: one upload per block per frame, then only a range bind per object
+	std::pair<double, double> perBlock;
+	{
+		UniformBuffer<FrameBlock> frameBuffer;
+		UniformBuffer<ObjectBlock> objectBuffer(static_cast<std::size_t>(objects));
+		blockShader.use();
+		perBlock = run([&](int frame) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			const auto viewProjection = projection * view;
+			frameBuffer.Set({ view, projection, viewProjection });
+			frameBuffer.Upload();
+			for (int i = 0; i < objects; i++)
+			{
+				objectBuffer.Set(static_cast<std::size_t>(i), { ModelMatrix(i, frame) });
+			}
+			objectBuffer.Upload();
+			for (int i = 0; i < objects; i++)
+			{
+				objectBuffer.Bind(static_cast<std::size_t>(i));
+				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+			}
+		});
+	}
+
+	// Report the results
+	std::cout << frames << " frames, " << objects << " objects per frame\n";
+	std::cout << "  per-object uniforms : " << perUniform.first << " us/frame submit, "
+		<< perUniform.second << " us/frame total\n";
+	std::cout << "  uniform buffers     : " << perBlock.first << " us/frame submit, "
+		<< perBlock.second << " us/frame total\n";
+	std::cout << "  submit speedup      : " << (perUniform.first / perBlock.first) << "x\n";
+
+	// Clean up
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteProgram(plainShader.ID);
+	glDeleteProgram(blockShader.ID);
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+// UploadConvertBenchmark.cpp
+//
+// Compare the old way of getting a decoded RGB image into a texture (stb's
+// separate flip pass, then a tightly packed GL_RGB upload with an unpack
+// alignment of 1) against PixelConvert's single pass that flips, expands to
+// RGBA (or BGRA) and pads into a pooled buffer, then uploads aligned rows
+//
+// The image is textures/container.jpg tiled out to each size
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "PixelConvert.h"
+#include "Texture.h"
+#include "Timeline.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Sizes to test, and the default number of runs of each, overridable from the command line
+	constexpr int Sizes[] { 2048, 4096 };
+	constexpr int DefaultRuns { 10 };
+
+	using Clock = std::chrono::steady_clock;
+	using Milliseconds = std::chrono::duration<double, std::milli>;
+
+	// Tile an RGB image out to size x size
+	std::vector<unsigned char> Tile(const unsigned char* pixels, int width, int height, int size)
+	{
+		std::vector<unsigned char> image(static_cast<std::size_t>(size) * size * 3);
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x += width)
+			{
+				const int count = std::min(width, size - x);
+				std::memcpy(image.data() + (static_cast<std::size_t>(y) * size + x) * 3,
+					pixels + static_cast<std::size_t>(y % height) * width * 3, static_cast<std::size_t>(count) * 3);
+			}
+		}
+		return image;
+	}
+
+	// What stbi_set_flip_vertically_on_load does: swap rows in place, after decoding
+	void Flip(std::vector<unsigned char>& image, int size)
+	{
+		const std::size_t row = static_cast<std::size_t>(size) * 3;
+		for (int y = 0; y < size / 2; y++)
+		{
+			std::swap_ranges(image.begin() + static_cast<std::ptrdiff_t>(y * row),
+				image.begin() + static_cast<std::ptrdiff_t>((y + 1) * row),
+				image.begin() + static_cast<std::ptrdiff_t>((size - 1 - y) * row));
+		}
+	}
+
+	// Milliseconds to prepare the pixels, and to upload them
+	struct Timing
+	{
+		double prepare { 0.0 };
+		double upload { 0.0 };
+	};
+
+	void Report(const std::string& name, const Timing& timing, int runs, int size)
+	{
+		const double prepare = timing.prepare / runs;
+		const double upload = timing.upload / runs;
+		const double megabytes = static_cast<double>(size) * size * 3 / (1024.0 * 1024.0);
+		std::cout << "  " << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(8) << prepare << " ms + " << std::setw(8) << upload << " ms upload = " << std::setw(8)
+			<< prepare + upload << " ms (" << megabytes / ((prepare + upload) / 1000.0) << " MB/s)\n" << std::defaultfloat;
+	}
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("UploadConvertBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	// Usage: UploadConvertBenchmark.bin [runs]
+	const int runs { (argc > 1) ? std::max(1, std::atoi(argv[1])) : DefaultRuns };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "UploadConvertBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+
+	// The source image, as RGB
+	int width, height, channels;
+	const auto path = std::filesystem::path(TEXTURE_DIR) / "container.jpg";
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 3);
+	if (data == nullptr)
+	{
+		std::cout << "Failed to load texture " << path << "\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Conversion kernels: " << PixelConvert::Kernel() << "\n";
+	std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+	for (const int size : Sizes)
+	{
+		const auto decoded = Tile(data, width, height, size);
+
+		// One texture per size, with the internal format the loader gives RGB images
+		unsigned int texture { 0 };
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, TextureInternalFormat(3, false), size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+
+		// Before: flip in place, then tightly packed RGB
+		Timing before;
+		for (int run = 0; run < runs; run++)
+		{
+			auto image = decoded;
+			auto start = Clock::now();
+			Flip(image, size);
+			before.prepare += Milliseconds(Clock::now() - start).count();
+			start = Clock::now();
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGB, GL_UNSIGNED_BYTE, image.data());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glFinish();
+			before.upload += Milliseconds(Clock::now() - start).count();
+		}
+
+		// After: one pass into a pooled buffer, then aligned four channel rows
+		const auto fused = [&](bool bgra) {
+			PixelConversion conversion;
+			conversion.channels = 3;
+			conversion.bgra = bgra;
+			Timing timing;
+			for (int run = 0; run < runs; run++)
+			{
+				auto start = Clock::now();
+				const auto staging = UploadPool::Instance().Acquire(PixelConvert::Stride(size, conversion) * size);
+				PixelConvert::Image(decoded.data(), size, size, conversion, staging.data());
+				timing.prepare += Milliseconds(Clock::now() - start).count();
+				start = Clock::now();
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, PixelConvert::Format(conversion), GL_UNSIGNED_BYTE,
+					staging.data());
+				glFinish();
+				timing.upload += Milliseconds(Clock::now() - start).count();
+			}
+			return timing;
+		};
+		const auto rgba = fused(false);
+		const auto bgra = fused(true);
+
+		std::cout << size << "x" << size << " RGB, average of " << runs << "\n";
+		Report("stb flip + RGB", before, runs, size);
+		Report("fused RGBA", rgba, runs, size);
+		Report("fused BGRA", bgra, runs, size);
+		glDeleteTextures(1, &texture);
+	}
+	stbi_image_free(data);
+	UploadPool::Instance().Trim();
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
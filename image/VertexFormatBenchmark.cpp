@@ -0,0 +1,213 @@
+// VertexFormatBenchmark.cpp
+//
+// Measure how much vertex memory and vertex fetch bandwidth the packed
+// formats of VertexLayout.h save. Millions of sub-pixel triangles, each
+// vertex with a position, normal, texture coordinate and color, are drawn
+// into a tiny viewport so almost nothing is rasterized and the GPU's time
+// goes on reading vertices: once as 32-bit floats (48 bytes a vertex) and
+// once packed (20 bytes a vertex)
+//
+// Usage: VertexFormatBenchmark.bin [frames] [vertices]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "Timeline.h"
+#include "VertexLayout.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 600 };
+
+	// Defaults, overridable from the command line
+	constexpr int DefaultFrames { 100 };
+	constexpr int DefaultVertices { 3000000 };
+
+	using Clock = std::chrono::steady_clock;
+
+	// Every attribute as 32-bit floats, the way the examples used to be
+	struct FloatVertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texCoord;
+		glm::vec4 color;
+		static constexpr auto Attributes() {
+			return std::make_tuple(VertexAttribute("aPos", &FloatVertex::position),
+				VertexAttribute("aNormal", &FloatVertex::normal), VertexAttribute("aTexCoord", &FloatVertex::texCoord),
+				VertexAttribute("aColor", &FloatVertex::color));
+		}
+	};
+
+	// The same attributes packed
+	struct PackedVertex
+	{
+		Half3 position;
+		PackedNormal normal;
+		UNorm16x2 texCoord;
+		UNorm8x4 color;
+		static constexpr auto Attributes() {
+			return std::make_tuple(VertexAttribute("aPos", &PackedVertex::position),
+				VertexAttribute("aNormal", &PackedVertex::normal), VertexAttribute("aTexCoord", &PackedVertex::texCoord),
+				VertexAttribute("aColor", &PackedVertex::color));
+		}
+	};
+
+	// One vertex before it is stored in either format
+	struct Source
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texCoord;
+		glm::vec4 color;
+	};
+
+	// A vertex array holding every vertex in one format
+	template <typename Vertex>
+	unsigned int Upload(const std::vector<Vertex>& vertices, const Shader& shader, unsigned int& VBO)
+	{
+		unsigned int VAO;
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(Vertex)), vertices.data(), GL_STATIC_DRAW);
+		VertexLayout<Vertex>::Apply(shader);
+		return VAO;
+	}
+} // anonymous namespace
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("VertexFormatBenchmark");
+	TIMELINE_BEGIN("startup");
+
+	const int frames { (argc > 1) ? std::max(1, std::atoi(argv[1])) : DefaultFrames };
+	const int vertexCount { ((argc > 2) ? std::max(3, std::atoi(argv[2])) : DefaultVertices) / 3 * 3 };
+
+	// Initialize glfw with an invisible window
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "VertexFormatBenchmark", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	TIMELINE_END();
+
+	Shader shader = Shader::Load("vs/vertex_formats.c", "fs/simple.c");
+	shader.use();
+
+	// Triangles a thousandth of the screen across, scattered over it
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<Source> sources(static_cast<std::size_t>(vertexCount));
+	for (std::size_t i = 0; i < sources.size(); i++)
+	{
+		const glm::vec3 centre = (i % 3 == 0) ? glm::vec3(unit(random) * 2.0f - 1.0f, unit(random) * 2.0f - 1.0f, unit(random))
+			: sources[i - i % 3].position;
+		const float corner = static_cast<float>(i % 3) * 0.001f;
+		const glm::vec3 normal = glm::normalize(glm::vec3(unit(random) - 0.5f, unit(random) - 0.5f, 1.0f));
+		sources[i] = { glm::vec3(centre.x + corner, centre.y + ((i % 3 == 2) ? 0.001f : 0.0f), centre.z), normal,
+			glm::vec2(unit(random), unit(random)), glm::vec4(unit(random), unit(random), unit(random), 1.0f) };
+	}
+
+	std::vector<FloatVertex> floats;
+	std::vector<PackedVertex> packed;
+	floats.reserve(sources.size());
+	packed.reserve(sources.size());
+	for (const auto& v : sources)
+	{
+		floats.push_back({ v.position, v.normal, v.texCoord, v.color });
+		packed.push_back({ Half3(v.position), PackedNormal(v.normal), UNorm16x2(v.texCoord.x, v.texCoord.y),
+			UNorm8x4(v.color.x, v.color.y, v.color.z, v.color.w) });
+	}
+
+	unsigned int floatVBO, packedVBO;
+	const unsigned int floatVAO = Upload(floats, shader, floatVBO);
+	const unsigned int packedVAO = Upload(packed, shader, packedVBO);
+
+	// Keep fill rate out of the measurement
+	glViewport(0, 0, 16, 16);
+
+	// Draw every vertex once per frame, returning the average milliseconds per
+	// frame with the GPU finishing each one
+	auto run = [&](unsigned int VAO) {
+		glBindVertexArray(VAO);
+		glDrawArrays(GL_TRIANGLES, 0, vertexCount); // warm up
+		glFinish();
+		const auto start = Clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+		}
+		glFinish();
+		const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		return elapsed.count() / frames;
+	};
+
+	const double floatMs = run(floatVAO);
+	const double packedMs = run(packedVAO);
+
+	// What each format costs, and how fast its vertices were read
+	const auto report = [&](const char* name, std::size_t stride, double ms) {
+		const double megabytes = static_cast<double>(stride) * vertexCount / (1024.0 * 1024.0);
+		std::cout << "  " << name << stride << " bytes/vertex, " << megabytes << " MB, " << ms << " ms/frame, "
+			<< megabytes / 1024.0 / (ms / 1000.0) << " GB/s fetched\n";
+	};
+	std::cout << frames << " frames, " << vertexCount << " vertices per frame\n";
+	report("32-bit floats : ", VertexLayout<FloatVertex>::Stride, floatMs);
+	report("packed        : ", VertexLayout<PackedVertex>::Stride, packedMs);
+	std::cout << "  memory saved  : "
+		<< 100.0 * (1.0 - static_cast<double>(VertexLayout<PackedVertex>::Stride) / VertexLayout<FloatVertex>::Stride) << "%\n";
+	std::cout << "  speedup       : " << (floatMs / packedMs) << "x\n";
+
+	// Clean up
+	glDeleteVertexArrays(1, &floatVAO);
+	glDeleteVertexArrays(1, &packedVAO);
+	glDeleteBuffers(1, &floatVBO);
+	glDeleteBuffers(1, &packedVBO);
+	glDeleteProgram(shader.ID);
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
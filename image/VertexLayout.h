@@ -0,0 +1,266 @@
+// VertexLayout.h
+//
+// Header-only vertex layouts generated from C++ structs, and compact
+// attribute formats to build them from
+//
+// A vertex is a plain struct that lists every member once, in declaration
+// order, by the names the vertex shader gives them:
+//
+//	struct Vertex
+//	{
+//		Half3 position;
+//		UNorm16x2 texCoord;
+//		static constexpr auto Attributes() {
+//			return std::make_tuple(VertexAttribute("aPos", &Vertex::position),
+//				VertexAttribute("aTexCoord", &Vertex::texCoord));
+//		}
+//	};
+//
+// VertexLayout<Vertex>::Apply(shader) then makes the glVertexAttribPointer
+// call for every attribute, with the stride and offsets worked out from the
+// struct at compile time, for whichever vertex array and GL_ARRAY_BUFFER are
+// bound
+//
+// The packed formats are what the GPU reads directly and expands back to
+// floats for the shader: half floats for positions, 16-bit normalized
+// texture coordinates (0 to 1), 10-bit signed normalized normals (-1 to 1)
+// and 8-bit normalized colors (0 to 1)
+
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "CreateShader.h"
+
+// A position in half floats, padded to 8 bytes so the next attribute stays aligned
+struct Half3
+{
+	std::uint16_t x { 0 }, y { 0 }, z { 0 }, padding { 0 };
+
+	Half3() = default;
+	Half3(float x, float y, float z) :
+		x(glm::packHalf1x16(x)), y(glm::packHalf1x16(y)), z(glm::packHalf1x16(z)) {
+	}
+	explicit Half3(const glm::vec3& v) : Half3(v.x, v.y, v.z) {
+	}
+};
+
+// Two values from 0 to 1 in 16 bits each, for texture coordinates
+struct UNorm16x2
+{
+	std::uint32_t packed { 0 };
+
+	UNorm16x2() = default;
+	UNorm16x2(float s, float t) : packed(glm::packUnorm2x16(glm::vec2(s, t))) {
+	}
+};
+
+// A normal in 10 bits per component (GL_INT_2_10_10_10_REV), and two unused
+// bits; GL takes packed formats as four components, but a vec3 can read them
+struct PackedNormal
+{
+	std::uint32_t packed { 0 };
+
+	PackedNormal() = default;
+	PackedNormal(float x, float y, float z) : packed(glm::packSnorm3x10_1x2(glm::vec4(x, y, z, 0.0f))) {
+	}
+	explicit PackedNormal(const glm::vec3& n) : PackedNormal(n.x, n.y, n.z) {
+	}
+};
+
+// A color from 0 to 1 in 8 bits per channel
+struct UNorm8x4
+{
+	std::uint32_t packed { 0 };
+
+	UNorm8x4() = default;
+	UNorm8x4(float r, float g, float b, float a = 1.0f) : packed(glm::packUnorm4x8(glm::vec4(r, g, b, a))) {
+	}
+};
+
+// The same without alpha, for shaders that take a vec3; still 4 bytes
+struct UNorm8x3
+{
+	std::uint32_t packed { 0 };
+
+	UNorm8x3() = default;
+	UNorm8x3(float r, float g, float b) : packed(glm::packUnorm4x8(glm::vec4(r, g, b, 0.0f))) {
+	}
+};
+
+// How each type is described to glVertexAttribPointer
+template <typename T> struct VertexFormat;
+template <> struct VertexFormat<float> {
+	static constexpr int Components { 1 };
+	static constexpr GLenum Type { GL_FLOAT };
+	static constexpr bool Normalized { false };
+};
+template <> struct VertexFormat<glm::vec2> {
+	static constexpr int Components { 2 };
+	static constexpr GLenum Type { GL_FLOAT };
+	static constexpr bool Normalized { false };
+};
+template <> struct VertexFormat<glm::vec3> {
+	static constexpr int Components { 3 };
+	static constexpr GLenum Type { GL_FLOAT };
+	static constexpr bool Normalized { false };
+};
+template <> struct VertexFormat<glm::vec4> {
+	static constexpr int Components { 4 };
+	static constexpr GLenum Type { GL_FLOAT };
+	static constexpr bool Normalized { false };
+};
+template <> struct VertexFormat<Half3> {
+	static constexpr int Components { 3 };
+	static constexpr GLenum Type { GL_HALF_FLOAT };
+	static constexpr bool Normalized { false };
+};
+template <> struct VertexFormat<UNorm16x2> {
+	static constexpr int Components { 2 };
+	static constexpr GLenum Type { GL_UNSIGNED_SHORT };
+	static constexpr bool Normalized { true };
+};
+template <> struct VertexFormat<PackedNormal> {
+	static constexpr int Components { 4 };
+	static constexpr GLenum Type { GL_INT_2_10_10_10_REV };
+	static constexpr bool Normalized { true };
+};
+template <> struct VertexFormat<UNorm8x4> {
+	static constexpr int Components { 4 };
+	static constexpr GLenum Type { GL_UNSIGNED_BYTE };
+	static constexpr bool Normalized { true };
+};
+template <> struct VertexFormat<UNorm8x3> {
+	static constexpr int Components { 3 };
+	static constexpr GLenum Type { GL_UNSIGNED_BYTE };
+	static constexpr bool Normalized { true };
+};
+
+// One named attribute of a vertex
+template <typename Struct, typename Field>
+struct VertexAttribute
+{
+	using Type = Field;
+	const char* name;
+	Field Struct::* field;
+
+	constexpr VertexAttribute(const char* name, Field Struct::* field) : name(name), field(field) {
+	}
+};
+
+// Stride, offsets and attribute pointers for a vertex struct
+template <typename Vertex>
+class VertexLayout
+{
+	static_assert(std::is_standard_layout_v<Vertex> && std::is_trivially_copyable_v<Vertex>,
+		"a vertex is copied straight into a buffer, so it must be a plain struct");
+
+public:
+	// An attribute's name, format and where it is in the vertex
+	struct Field
+	{
+		const char* name;
+		int components;
+		GLenum type;
+		bool normalized;
+		std::size_t offset;
+	};
+
+private:
+	using Members = decltype(Vertex::Attributes());
+	static constexpr std::size_t Count { std::tuple_size_v<Members> };
+	template <std::size_t I>
+	using FieldOf = typename std::tuple_element_t<I, Members>::Type;
+
+	// Offsets follow from the attributes' sizes and alignments in declaration
+	// order, as the compiler lays out a standard-layout struct, so they are
+	// known at compile time; the last entry is the size of the whole vertex
+	template <std::size_t... I>
+	static constexpr std::array<std::size_t, Count + 1> Compute(std::index_sequence<I...>) {
+		constexpr std::size_t aligns[] { alignof(FieldOf<I>)... };
+		constexpr std::size_t sizes[] { sizeof(FieldOf<I>)... };
+		std::array<std::size_t, Count + 1> result {};
+		std::size_t offset { 0 };
+		for (std::size_t i = 0; i < Count; i++)
+		{
+			offset = (offset + aligns[i] - 1) / aligns[i] * aligns[i];
+			result[i] = offset;
+			offset += sizes[i];
+		}
+		result[Count] = (offset + alignof(Vertex) - 1) / alignof(Vertex) * alignof(Vertex);
+		return result;
+	}
+	static constexpr auto Layout { Compute(std::make_index_sequence<Count>{}) };
+	static_assert(Layout[Count] == sizeof(Vertex),
+		"Attributes() must list every member of the vertex, in declaration order");
+
+	template <std::size_t... I>
+	static constexpr std::array<Field, Count> Describe(std::index_sequence<I...>) {
+		constexpr auto members = Vertex::Attributes();
+		return { Field { std::get<I>(members).name, VertexFormat<FieldOf<I>>::Components,
+			VertexFormat<FieldOf<I>>::Type, VertexFormat<FieldOf<I>>::Normalized, Layout[I] }... };
+	}
+
+	// In debug builds, check the computed offsets against where the members
+	// really are, which also catches attributes listed out of order
+	template <std::size_t... I>
+	static bool Validate(std::index_sequence<I...>) {
+		bool valid { true };
+#ifndef NDEBUG
+		static const Vertex probe {};
+		const auto members = Vertex::Attributes();
+		const auto base = reinterpret_cast<const unsigned char*>(&probe);
+		((reinterpret_cast<const unsigned char*>(&(probe.*(std::get<I>(members).field))) - base
+			== static_cast<std::ptrdiff_t>(Layout[I]) ? void() : (void)(valid = false,
+			std::cout << "ERROR::VERTEX_LAYOUT::OFFSET_MISMATCH: " << std::get<I>(members).name
+				<< " is not at byte " << Layout[I] << "\n")), ...);
+#endif
+		return valid;
+	}
+
+public:
+	// Bytes between one vertex and the next
+	static constexpr std::size_t Stride { sizeof(Vertex) };
+
+	// Offset of attribute I
+	template <std::size_t I>
+	static constexpr std::size_t Offset() {
+		return Layout[I];
+	}
+
+	// Every attribute, in declaration order
+	static constexpr std::array<Field, Count> Fields() {
+		return Describe(std::make_index_sequence<Count>{});
+	}
+
+	// Point the shader's attributes at Vertex data starting at offset in the
+	// bound GL_ARRAY_BUFFER, and enable them, in the bound vertex array;
+	// attributes the shader doesn't use (or the linker removed) are skipped
+	static void Apply(const Shader& shader, std::size_t offset = 0) {
+		static const bool valid { Validate(std::make_index_sequence<Count>{}) };
+		(void)valid;
+		for (const auto& field : Fields())
+		{
+			const auto attribute = shader.attribute(field.name);
+			if (!attribute)
+			{
+				continue;
+			}
+			shader.vertexAttribPointer(attribute, field.components, field.type, field.normalized,
+				static_cast<int>(Stride), (void*)(offset + field.offset));
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,773 @@
+// VirtualTexture.h
+//
+// Header-only virtual texturing, for images far larger than the GPU memory
+// budget (32K x 32K and up): the image is baked once into a tiled file with a
+// full mip pyramid, and only the tiles the screen actually shows are resident
+//
+//	VirtualTexture::Bake(path, width, height, source);      // once, offline
+//	VirtualTexture image(path);
+//	VirtualFeedback feedback(ScreenWidth, ScreenHeight);
+//	// every frame:
+//	feedback.Begin();  draw with fs/texture.c and VIRTUAL_FEEDBACK;  feedback.End(image);
+//	image.Update();    draw with fs/texture.c and VIRTUAL_TEXTURE
+//
+// The shader side is common/virtual.c: a page table texture, one mip level per
+// tile level, holds for every tile the cache slot of that tile, or of its
+// nearest coarser ancestor that is resident; the physical texture is the cache
+// of fixed-size slots the tiles are copied into
+// A low resolution feedback pass writes the tile every pixel wants; those are
+// read back a frame later (through a pixel buffer, without a stall), loaded on
+// worker threads, and uploaded a few per frame, replacing the least recently
+// seen tiles
+//
+// Tiles carry a border of their neighbours' texels so bilinear filtering never
+// crosses into another slot; the coarsest level is always resident
+
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glad/glad.h>
+
+#include "CreateShader.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+
+// Where the baked textures are kept, unless the build says otherwise
+#ifndef BAKED_TEXTURE_DIR
+#define BAKED_TEXTURE_DIR "baked_textures"
+#endif
+
+// How much GPU memory the cache gets, and how fast it may change
+struct VirtualTextureOptions
+{
+	int physicalSize { 4096 };  // edge of the physical texture, in texels, rounded down to whole slots
+	int uploadsPerFrame { 16 }; // tiles copied into the cache per Update
+	int inFlight { 64 };        // tile reads queued on the workers at once
+	unsigned int threads { 2 }; // worker threads reading tiles
+};
+
+class VirtualTexture
+{
+public:
+	// On-disk layout: a Header, then every tile of level 0 row by row from the
+	// bottom, then level 1, and so on; each tile is (tileSize + 2 * border)^2 RGBA
+	// texels, bottom row first like a GL texture
+	static constexpr std::uint32_t Magic { 0x58455456 }; // "VTEX"
+	static constexpr std::uint32_t Version { 1 };
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t width;         // the image
+		std::uint32_t height;
+		std::uint32_t paddedWidth;   // the tiled area: whole tiles at every level
+		std::uint32_t paddedHeight;
+		std::uint32_t tileSize;
+		std::uint32_t border;
+		std::uint32_t levels;
+		std::uint32_t reserved;
+	};
+
+	// Fills width x height RGBA texels, top row first, from the image at (x, y)
+	// (top left origin); called from worker threads
+	using Source = std::function<void(int x, int y, int width, int height, unsigned char* pixels)>;
+
+	// The coarsest level has at most this many tiles across, all kept resident
+	static constexpr int TopTiles { 4 };
+
+	static std::filesystem::path PathFor(const std::filesystem::path& image) {
+		return std::filesystem::path(BAKED_TEXTURE_DIR) / (image.filename().string() + ".vtex");
+	}
+
+	// Write the tiled pyramid of a width x height image; level 0 comes from source,
+	// every other level is a 2x2 box of the one below, read back from the file
+	static bool Bake(const std::filesystem::path& output, int width, int height, const Source& source,
+		int tileSize = 128, int border = 4) {
+		Header header { Magic, Version, static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), 0, 0,
+			static_cast<std::uint32_t>(tileSize), static_cast<std::uint32_t>(border), 1, 0 };
+		const int tilesX = (width + tileSize - 1) / tileSize;
+		const int tilesY = (height + tileSize - 1) / tileSize;
+		while (std::max(tilesX, tilesY) > (TopTiles << (header.levels - 1)))
+		{
+			header.levels++;
+		}
+		const int unit = tileSize << (header.levels - 1);
+		header.paddedWidth = static_cast<std::uint32_t>((width + unit - 1) / unit * unit);
+		header.paddedHeight = static_cast<std::uint32_t>((height + unit - 1) / unit * unit);
+
+		std::filesystem::create_directories(output.parent_path());
+		auto temporary = output;
+		temporary += ".tmp";
+		const int file = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (file < 0)
+		{
+			std::cout << "ERROR::VIRTUAL_TEXTURE::OPEN_FAILED: " << temporary << "\n";
+			return false;
+		}
+		bool written = Write(file, &header, sizeof(header), 0);
+		const Layout layout(header);
+		ThreadPool pool;
+		for (int level = 0; level < static_cast<int>(header.levels) && written; level++)
+		{
+			std::vector<std::future<bool>> tiles;
+			for (int ty = 0; ty < layout.TilesY(level); ty++)
+			{
+				for (int tx = 0; tx < layout.TilesX(level); tx++)
+				{
+					tiles.push_back(pool.Submit([&, level, tx, ty]() {
+						std::vector<unsigned char> tile(layout.tileBytes);
+						if (level == 0)
+						{
+							BakeBase(header, source, tx, ty, tile.data());
+						}
+						else if (!BakeLevel(file, layout, level, tx, ty, tile.data()))
+						{
+							return false;
+						}
+						return Write(file, tile.data(), tile.size(), layout.Offset(level, tx, ty));
+					}));
+				}
+			}
+			for (auto& tile : tiles)
+			{
+				written = tile.get() && written;
+			}
+		}
+		close(file);
+		if (!written)
+		{
+			std::cout << "ERROR::VIRTUAL_TEXTURE::WRITE_FAILED: " << temporary << "\n";
+			std::filesystem::remove(temporary);
+			return false;
+		}
+		std::filesystem::rename(temporary, output);
+		return true;
+	}
+
+	// Open a baked file; check operator bool before using it
+	explicit VirtualTexture(const std::filesystem::path& path, const VirtualTextureOptions& options = {})
+		: options(options), pool(std::max(1u, options.threads)) {
+		file = open(path.c_str(), O_RDONLY);
+		if (file < 0 || !Read(file, &header, sizeof(header), 0) || header.magic != Magic || header.version != Version
+			|| header.tileSize == 0 || header.levels == 0 || header.levels > 16)
+		{
+			std::cout << "ERROR::VIRTUAL_TEXTURE::INVALID_FILE: " << path << "\n";
+			if (file >= 0)
+			{
+				close(file);
+				file = -1;
+			}
+			return;
+		}
+		layout = Layout(header);
+		slotsPerSide = std::min(256, std::max(1, options.physicalSize / layout.slotSize));
+		const int levels = static_cast<int>(header.levels);
+		const int top = levels - 1;
+		if (slotsPerSide * slotsPerSide < layout.TilesX(top) * layout.TilesY(top) + this->options.uploadsPerFrame)
+		{
+			std::cout << "ERROR::VIRTUAL_TEXTURE::CACHE_TOO_SMALL: " << slotsPerSide * slotsPerSide << " slots\n";
+		}
+
+		// The page table: RGBA8 entries, one mip level per tile level
+		glGenTextures(1, &pageTable);
+		glBindTexture(GL_TEXTURE_2D, pageTable);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		TextureStorage(GL_TEXTURE_2D, levels, 4, false, layout.TilesX(0), layout.TilesY(0));
+		entries.resize(static_cast<std::size_t>(levels));
+		for (int level = 0; level < levels; level++)
+		{
+			entries[static_cast<std::size_t>(level)].resize(static_cast<std::size_t>(layout.TilesX(level)) * layout.TilesY(level));
+		}
+
+		// The cache every resident tile is copied into
+		glGenTextures(1, &physical);
+		glBindTexture(GL_TEXTURE_2D, physical);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		TextureStorage(GL_TEXTURE_2D, 1, 4, false, PhysicalSize(), PhysicalSize());
+		for (int slot = slotsPerSide * slotsPerSide - 1; slot >= 0; slot--)
+		{
+			freeSlots.push_back(slot);
+		}
+
+		// The coarsest level is read now, and never leaves
+		std::vector<unsigned char> tile(layout.tileBytes);
+		for (int ty = 0; ty < layout.TilesY(top); ty++)
+		{
+			for (int tx = 0; tx < layout.TilesX(top); tx++)
+			{
+				if (Read(file, tile.data(), tile.size(), layout.Offset(top, tx, ty)))
+				{
+					Upload(Key(top, tx, ty), tile, true);
+				}
+			}
+		}
+		RebuildPageTable();
+	}
+
+	~VirtualTexture() {
+		// the workers may still be reading
+		for (auto& [key, load] : loading)
+		{
+			load.wait();
+		}
+		if (file >= 0)
+		{
+			close(file);
+		}
+		glDeleteTextures(1, &pageTable);
+		glDeleteTextures(1, &physical);
+	}
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	explicit operator bool() const {
+		return file >= 0;
+	}
+
+	// The tiles a feedback pass asked for, as RGBA8 texels (see virtualFeedback
+	// in common/virtual.c); each is requested with its ancestors, coarsest first
+	void Feedback(const unsigned char* texels, std::size_t count) {
+		frame++;
+		std::unordered_set<std::uint32_t> wanted;
+		for (std::size_t i = 0; i < count; i++)
+		{
+			const unsigned char* texel = texels + i * 4;
+			if (texel[3] >= header.levels)
+			{
+				continue;
+			}
+			int level = texel[3];
+			int tx = texel[0] | ((texel[2] & 0x0f) << 8);
+			int ty = texel[1] | ((texel[2] >> 4) << 8);
+			for (; level < static_cast<int>(header.levels); level++, tx /= 2, ty /= 2)
+			{
+				if (tx >= layout.TilesX(level) || ty >= layout.TilesY(level) || !wanted.insert(Key(level, tx, ty)).second)
+				{
+					break;
+				}
+			}
+		}
+		requested += wanted.size();
+
+		// Seen tiles move to the front of the LRU list; missing ones are queued
+		std::vector<std::uint32_t> missing;
+		for (const std::uint32_t key : wanted)
+		{
+			const auto it = resident.find(key);
+			if (it != resident.end())
+			{
+				if (!it->second.pinned)
+				{
+					recent.splice(recent.begin(), recent, it->second.position);
+				}
+				it->second.seen = frame;
+			}
+			else if (loading.find(key) == loading.end())
+			{
+				missing.push_back(key);
+			}
+		}
+		std::sort(missing.begin(), missing.end(), [](std::uint32_t a, std::uint32_t b) { return Level(a) > Level(b); });
+		for (const std::uint32_t key : missing)
+		{
+			if (static_cast<int>(loading.size()) >= options.inFlight)
+			{
+				break;
+			}
+			loading.emplace(key, pool.Submit([this, key]() {
+				std::vector<unsigned char> tile(layout.tileBytes);
+				if (!Read(file, tile.data(), tile.size(), layout.Offset(Level(key), TileX(key), TileY(key))))
+				{
+					tile.clear();
+				}
+				return tile;
+			}));
+		}
+	}
+
+	// Copy finished tiles into the cache and bring the page table up to date
+	void Update() {
+		int uploads { 0 };
+		bool changed { false };
+		for (auto it = loading.begin(); it != loading.end() && uploads < options.uploadsPerFrame;)
+		{
+			if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				++it;
+				continue;
+			}
+			const std::uint32_t key = it->first;
+			const auto& tile = it->second.get();
+			if (tile.empty())
+			{
+				std::cout << "ERROR::VIRTUAL_TEXTURE::READ_FAILED: tile " << TileX(key) << "," << TileY(key)
+					<< " of level " << Level(key) << "\n";
+				it = loading.erase(it);
+				continue;
+			}
+			if (!Upload(key, tile, false))
+			{
+				// every slot holds a tile on screen; the tiles already read stay queued
+				// until the view settles, rather than being read again
+				break;
+			}
+			it = loading.erase(it);
+			uploads++;
+			changed = true;
+		}
+		if (changed)
+		{
+			RebuildPageTable();
+		}
+	}
+
+	// Bind the page table and the cache to two texture units
+	void Bind(unsigned int pageTableUnit, unsigned int physicalUnit) const {
+		glActiveTexture(GL_TEXTURE0 + pageTableUnit);
+		glBindTexture(GL_TEXTURE_2D, pageTable);
+		glActiveTexture(GL_TEXTURE0 + physicalUnit);
+		glBindTexture(GL_TEXTURE_2D, physical);
+	}
+
+	// Everything common/virtual.c needs, on the shader in use; feedbackScale is
+	// how many times smaller the pass using this shader renders (1 for the scene)
+	void SetUniforms(const Shader& shader, unsigned int pageTableUnit, unsigned int physicalUnit, int feedbackScale = 1) const {
+		shader.setInt("pageTable", static_cast<int>(pageTableUnit));
+		shader.setInt("physicalTiles", static_cast<int>(physicalUnit));
+		shader.setVec4("virtualSize", static_cast<float>(header.paddedWidth), static_cast<float>(header.paddedHeight),
+			static_cast<float>(header.tileSize), static_cast<float>(header.levels - 1));
+		shader.setVec4("physicalSize", static_cast<float>(layout.slotSize), static_cast<float>(header.border),
+			1.0f / static_cast<float>(PhysicalSize()), 1.0f / static_cast<float>(PhysicalSize()));
+		shader.setVec2("virtualScale", static_cast<float>(header.width) / static_cast<float>(header.paddedWidth),
+			static_cast<float>(header.height) / static_cast<float>(header.paddedHeight));
+		shader.setFloat("feedbackBias", -std::log2(static_cast<float>(std::max(1, feedbackScale))));
+	}
+
+	const Header& Info() const {
+		return header;
+	}
+
+	// Statistics
+	std::size_t Resident() const {
+		return resident.size();
+	}
+	std::size_t Slots() const {
+		return static_cast<std::size_t>(slotsPerSide) * static_cast<std::size_t>(slotsPerSide);
+	}
+	std::size_t Loading() const {
+		return loading.size();
+	}
+	std::uint64_t Requested() const {
+		return requested;
+	}
+	std::uint64_t Uploads() const {
+		return uploaded;
+	}
+	std::uint64_t Evictions() const {
+		return evictions;
+	}
+	void Print() const {
+		std::cout << "VirtualTexture: " << header.width << "x" << header.height << ", " << header.levels << " levels of "
+			<< header.tileSize << " texel tiles, " << Resident() << "/" << Slots() << " slots resident, " << Loading()
+			<< " loading, " << requested << " requested, " << uploaded << " uploaded, " << evictions << " evicted\n";
+	}
+
+private:
+	// Where the tiles of each level start in the file
+	struct Layout
+	{
+		Layout() = default;
+		explicit Layout(const Header& header)
+			: tileSize(static_cast<int>(header.tileSize)), border(static_cast<int>(header.border)),
+			slotSize(tileSize + 2 * border), tileBytes(static_cast<std::size_t>(slotSize) * slotSize * 4),
+			paddedWidth(static_cast<int>(header.paddedWidth)), paddedHeight(static_cast<int>(header.paddedHeight)) {
+			std::size_t tiles { 0 };
+			for (int level = 0; level < static_cast<int>(header.levels); level++)
+			{
+				starts.push_back(tiles);
+				tiles += static_cast<std::size_t>(TilesX(level)) * static_cast<std::size_t>(TilesY(level));
+			}
+		}
+		int TilesX(int level) const {
+			return (paddedWidth >> level) / tileSize;
+		}
+		int TilesY(int level) const {
+			return (paddedHeight >> level) / tileSize;
+		}
+		off_t Offset(int level, int tx, int ty) const {
+			const std::size_t index = starts[static_cast<std::size_t>(level)]
+				+ static_cast<std::size_t>(ty) * static_cast<std::size_t>(TilesX(level)) + static_cast<std::size_t>(tx);
+			return static_cast<off_t>(sizeof(Header) + index * tileBytes);
+		}
+
+		int tileSize { 0 };
+		int border { 0 };
+		int slotSize { 0 };
+		std::size_t tileBytes { 0 };
+		int paddedWidth { 0 };
+		int paddedHeight { 0 };
+		std::vector<std::size_t> starts;
+	};
+
+	// A tile's place in the cache
+	struct Slot
+	{
+		int slot { 0 };
+		bool pinned { false };
+		std::uint64_t seen { 0 };
+		std::list<std::uint32_t>::iterator position;
+	};
+
+	// Tiles are known by level, x and y packed into one key
+	static std::uint32_t Key(int level, int tx, int ty) {
+		return (static_cast<std::uint32_t>(level) << 24) | (static_cast<std::uint32_t>(ty) << 12) | static_cast<std::uint32_t>(tx);
+	}
+	static int Level(std::uint32_t key) {
+		return static_cast<int>(key >> 24);
+	}
+	static int TileX(std::uint32_t key) {
+		return static_cast<int>(key & 0xfff);
+	}
+	static int TileY(std::uint32_t key) {
+		return static_cast<int>((key >> 12) & 0xfff);
+	}
+
+	static bool Read(int file, void* data, std::size_t bytes, off_t offset) {
+		auto* out = static_cast<unsigned char*>(data);
+		while (bytes > 0)
+		{
+			const ssize_t got = pread(file, out, bytes, offset);
+			if (got <= 0)
+			{
+				return false;
+			}
+			out += got;
+			bytes -= static_cast<std::size_t>(got);
+			offset += got;
+		}
+		return true;
+	}
+	static bool Write(int file, const void* data, std::size_t bytes, off_t offset) {
+		const auto* in = static_cast<const unsigned char*>(data);
+		while (bytes > 0)
+		{
+			const ssize_t put = pwrite(file, in, bytes, offset);
+			if (put <= 0)
+			{
+				return false;
+			}
+			in += put;
+			bytes -= static_cast<std::size_t>(put);
+			offset += put;
+		}
+		return true;
+	}
+
+	// A level 0 tile with its border, edge texels repeated past the image; the
+	// padded area is the image's right and top edges repeated
+	static void BakeBase(const Header& header, const Source& source, int tx, int ty, unsigned char* tile) {
+		const int width = static_cast<int>(header.width);
+		const int height = static_cast<int>(header.height);
+		const int border = static_cast<int>(header.border);
+		const int slot = static_cast<int>(header.tileSize) + 2 * border;
+		const int x0 = tx * static_cast<int>(header.tileSize) - border;
+		const int y0 = ty * static_cast<int>(header.tileSize) - border;
+		const int left = std::clamp(x0, 0, width - 1);
+		const int right = std::clamp(x0 + slot - 1, 0, width - 1);
+		const int bottom = std::clamp(y0, 0, height - 1);
+		const int top = std::clamp(y0 + slot - 1, 0, height - 1);
+		const int columns = right - left + 1;
+		const int rows = top - bottom + 1;
+		std::vector<unsigned char> region(static_cast<std::size_t>(columns) * rows * 4);
+		// GL rows count up from the bottom, the source's down from the top
+		source(left, height - 1 - top, columns, rows, region.data());
+		for (int y = 0; y < slot; y++)
+		{
+			const int row = top - std::clamp(y0 + y, bottom, top);
+			for (int x = 0; x < slot; x++)
+			{
+				const int column = std::clamp(x0 + x, left, right) - left;
+				std::copy_n(region.data() + (static_cast<std::size_t>(row) * columns + column) * 4, 4,
+					tile + (static_cast<std::size_t>(y) * slot + x) * 4);
+			}
+		}
+	}
+
+	// A tile of a coarser level, each texel the average of 2x2 from the level below
+	static bool BakeLevel(int file, const Layout& layout, int level, int tx, int ty, unsigned char* tile) {
+		const int slot = layout.slotSize;
+		const int x0 = tx * layout.tileSize - layout.border;
+		const int y0 = ty * layout.tileSize - layout.border;
+		const int below = level - 1;
+		const int width = layout.paddedWidth >> below;
+		const int height = layout.paddedHeight >> below;
+
+		// The finer tiles under this one and its border, cached as they are read
+		std::map<std::uint32_t, std::vector<unsigned char>> tiles;
+		const auto texel = [&](int x, int y) -> const unsigned char* {
+			x = std::clamp(x, 0, width - 1);
+			y = std::clamp(y, 0, height - 1);
+			const int fx = x / layout.tileSize;
+			const int fy = y / layout.tileSize;
+			auto& source = tiles[Key(below, fx, fy)];
+			if (source.empty())
+			{
+				source.resize(layout.tileBytes);
+				if (!Read(file, source.data(), source.size(), layout.Offset(below, fx, fy)))
+				{
+					return nullptr;
+				}
+			}
+			const int ix = x - fx * layout.tileSize + layout.border;
+			const int iy = y - fy * layout.tileSize + layout.border;
+			return source.data() + (static_cast<std::size_t>(iy) * slot + ix) * 4;
+		};
+		const int coarseWidth = layout.paddedWidth >> level;
+		const int coarseHeight = layout.paddedHeight >> level;
+		for (int y = 0; y < slot; y++)
+		{
+			const int cy = std::clamp(y0 + y, 0, coarseHeight - 1);
+			for (int x = 0; x < slot; x++)
+			{
+				const int cx = std::clamp(x0 + x, 0, coarseWidth - 1);
+				const unsigned char* a = texel(2 * cx, 2 * cy);
+				const unsigned char* b = texel(2 * cx + 1, 2 * cy);
+				const unsigned char* c = texel(2 * cx, 2 * cy + 1);
+				const unsigned char* d = texel(2 * cx + 1, 2 * cy + 1);
+				if (a == nullptr || b == nullptr || c == nullptr || d == nullptr)
+				{
+					return false;
+				}
+				unsigned char* out = tile + (static_cast<std::size_t>(y) * slot + x) * 4;
+				for (int channel = 0; channel < 4; channel++)
+				{
+					out[channel] = static_cast<unsigned char>((a[channel] + b[channel] + c[channel] + d[channel] + 2) / 4);
+				}
+			}
+		}
+		return true;
+	}
+
+	int PhysicalSize() const {
+		return slotsPerSide * layout.slotSize;
+	}
+
+	// Copy a tile into a free slot, or the slot of the tile seen longest ago;
+	// false if every slot holds a tile the last feedback asked for
+	bool Upload(std::uint32_t key, const std::vector<unsigned char>& tile, bool pinned) {
+		int slot { -1 };
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			if (recent.empty() || resident[recent.back()].seen == frame)
+			{
+				return false;
+			}
+			const std::uint32_t victim = recent.back();
+			recent.pop_back();
+			slot = resident[victim].slot;
+			resident.erase(victim);
+			evictions++;
+		}
+		glBindTexture(GL_TEXTURE_2D, physical);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % slotsPerSide) * layout.slotSize, (slot / slotsPerSide) * layout.slotSize,
+			layout.slotSize, layout.slotSize, GL_RGBA, GL_UNSIGNED_BYTE, tile.data());
+		Slot& entry = resident[key];
+		entry.slot = slot;
+		entry.pinned = pinned;
+		entry.seen = frame;
+		if (!pinned)
+		{
+			recent.push_front(key);
+			entry.position = recent.begin();
+		}
+		uploaded++;
+		return true;
+	}
+
+	// Every entry points at its own tile if resident, otherwise at whatever its parent points to
+	void RebuildPageTable() {
+		const int levels = static_cast<int>(header.levels);
+		glBindTexture(GL_TEXTURE_2D, pageTable);
+		for (int level = levels - 1; level >= 0; level--)
+		{
+			auto& table = entries[static_cast<std::size_t>(level)];
+			const int tilesX = layout.TilesX(level);
+			const int tilesY = layout.TilesY(level);
+			for (int ty = 0; ty < tilesY; ty++)
+			{
+				for (int tx = 0; tx < tilesX; tx++)
+				{
+					std::uint32_t& entry = table[static_cast<std::size_t>(ty) * tilesX + tx];
+					const auto it = resident.find(Key(level, tx, ty));
+					if (it != resident.end())
+					{
+						const int slot = it->second.slot;
+						entry = static_cast<std::uint32_t>(slot % slotsPerSide) | (static_cast<std::uint32_t>(slot / slotsPerSide) << 8)
+							| (static_cast<std::uint32_t>(level) << 16) | 0xff000000u;
+					}
+					else if (level + 1 < levels)
+					{
+						entry = entries[static_cast<std::size_t>(level + 1)][static_cast<std::size_t>(ty / 2) * layout.TilesX(level + 1) + tx / 2];
+					}
+					else
+					{
+						entry = 0;
+					}
+				}
+			}
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, tilesX, tilesY, GL_RGBA, GL_UNSIGNED_BYTE, table.data());
+		}
+	}
+
+	VirtualTextureOptions options;
+	Header header {};
+	Layout layout;
+	int file { -1 };
+	int slotsPerSide { 0 };
+	unsigned int pageTable { 0 };
+	unsigned int physical { 0 };
+	std::vector<std::vector<std::uint32_t>> entries;
+	std::vector<int> freeSlots;
+	std::unordered_map<std::uint32_t, Slot> resident;
+	std::list<std::uint32_t> recent; // unpinned resident tiles, most recently seen first
+	// tiles being read, and tiles read but not yet uploaded; shared so a
+	// finished tile can be looked at again after a failed upload
+	std::map<std::uint32_t, std::shared_future<std::vector<unsigned char>>> loading;
+	ThreadPool pool;
+	std::uint64_t frame { 0 };
+	std::uint64_t requested { 0 };
+	std::uint64_t uploaded { 0 };
+	std::uint64_t evictions { 0 };
+};
+
+// The low resolution pass that tells a VirtualTexture what is on screen: drawn
+// into a small framebuffer, read back into one of two pixel buffers, and handed
+// over a frame later, once the copy has finished
+class VirtualFeedback
+{
+public:
+	// scale is how many times smaller than the screen the pass renders
+	VirtualFeedback(int screenWidth, int screenHeight, int scale = 8) : scale(std::max(1, scale)) {
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(1, &color);
+		glGenRenderbuffers(1, &depth);
+		glGenBuffers(2, pbos);
+		Resize(screenWidth, screenHeight);
+	}
+
+	~VirtualFeedback() {
+		glDeleteBuffers(2, pbos);
+		glDeleteRenderbuffers(1, &depth);
+		glDeleteRenderbuffers(1, &color);
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+
+	VirtualFeedback(const VirtualFeedback&) = delete;
+	VirtualFeedback& operator=(const VirtualFeedback&) = delete;
+
+	// Follow the window size
+	void Resize(int screenWidth, int screenHeight) {
+		screen[0] = screenWidth;
+		screen[1] = screenHeight;
+		width = std::max(1, screenWidth / scale);
+		height = std::max(1, screenHeight / scale);
+		glBindRenderbuffer(GL_RENDERBUFFER, color);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR::VIRTUAL_FEEDBACK::FRAMEBUFFER_INCOMPLETE\n";
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		for (const unsigned int pbo : pbos)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+			glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, nullptr, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		pending = 0;
+	}
+
+	// Draw the feedback pass between these two; alpha 255 marks texels with nothing
+	void Begin() const {
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, width, height);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+	void End(VirtualTexture& texture) {
+		const int current = static_cast<int>(frame % 2);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[current]);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		if (pending > 0)
+		{
+			// last frame's read has had a whole frame to land
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[1 - current]);
+			const auto* texels = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+				static_cast<GLsizeiptr>(width) * height * 4, GL_MAP_READ_BIT));
+			if (texels != nullptr)
+			{
+				texture.Feedback(texels, static_cast<std::size_t>(width) * height);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, screen[0], screen[1]);
+		pending = 1;
+		frame++;
+	}
+
+	int Scale() const {
+		return scale;
+	}
+
+private:
+	int scale;
+	int screen[2] { 0, 0 };
+	int width { 0 };
+	int height { 0 };
+	unsigned int framebuffer { 0 };
+	unsigned int color { 0 };
+	unsigned int depth { 0 };
+	unsigned int pbos[2] { 0, 0 };
+	int pending { 0 };
+	std::uint64_t frame { 0 };
+};
+
+#endif
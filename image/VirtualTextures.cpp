@@ -0,0 +1,356 @@
+// VirtualTextures.cpp
+//
+// Show an image far larger than the GPU memory budget through a VirtualTexture:
+// by default a 32768x32768 procedural image, or any image file given on the
+// command line; either is baked into a tiled file on the first run
+// The quad from Textures.cpp covers the window, and panning and zooming move
+// its texture coordinates; every frame a feedback pass at an eighth of the
+// resolution tells the virtual texture which tiles to stream in
+//
+// Usage: VirtualTextures.bin [image]
+// Keys: arrows or h/j/k/l pan, ] and [ zoom in and out, space tours on its own
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+
+#include <glad/glad.h> // Must be included before glfw3
+#include <GLFW/glfw3.h>
+
+#include "CreateShader.h"
+#include "Timeline.h"
+#include "VirtualTexture.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Set some global variables
+namespace {
+	// Screen height and width
+	constexpr int ScreenWidth { 800 };
+	constexpr int ScreenHeight { 800 };
+
+	// Size of the procedural image
+	constexpr int ProceduralSize { 32768 };
+
+	// The part of the image on screen: its centre, and how much of the image fits across
+	double centreX { 0.5 };
+	double centreY { 0.5 };
+	double span { 1.0 };
+	bool touring { true };
+
+	using Clock = std::chrono::steady_clock;
+
+	// Colour gradients under a grid, with finer lines every time you zoom in far enough
+	void Procedural(int x, int y, int width, int height, unsigned char* pixels)
+	{
+		for (int row = 0; row < height; row++)
+		{
+			const auto py = static_cast<std::uint32_t>(y + row);
+			for (int column = 0; column < width; column++)
+			{
+				const auto px = static_cast<std::uint32_t>(x + column);
+				unsigned char* out = pixels + (static_cast<std::size_t>(row) * width + column) * 4;
+				const bool checker = (((px >> 10) ^ (py >> 10)) & 1u) != 0;
+				out[0] = static_cast<unsigned char>(px * 255u / ProceduralSize);
+				out[1] = static_cast<unsigned char>(py * 255u / ProceduralSize);
+				out[2] = checker ? 200 : 90;
+				out[3] = 255;
+				// dark lines every 4096, 256 and 16 texels, each thinner than the last
+				if ((px & 4095u) < 32u || (py & 4095u) < 32u)
+				{
+					out[0] = out[1] = out[2] = 0;
+				}
+				else if ((px & 255u) < 4u || (py & 255u) < 4u)
+				{
+					out[0] /= 3;
+					out[1] /= 3;
+					out[2] /= 3;
+				}
+				else if ((px & 15u) == 0u || (py & 15u) == 0u)
+				{
+					out[0] = static_cast<unsigned char>(out[0] * 3 / 4);
+					out[1] = static_cast<unsigned char>(out[1] * 3 / 4);
+					out[2] = static_cast<unsigned char>(out[2] * 3 / 4);
+				}
+			}
+		}
+	}
+
+	// The texture coordinates that put the current view on the quad
+	void View(float* vertices)
+	{
+		const double half = span / 2.0;
+		const float left = static_cast<float>(centreX - half);
+		const float right = static_cast<float>(centreX + half);
+		const float bottom = static_cast<float>(centreY - half);
+		const float top = static_cast<float>(centreY + half);
+		const float coords[4][2] { { right, top }, { right, bottom }, { left, bottom }, { left, top } };
+		for (int vertex = 0; vertex < 4; vertex++)
+		{
+			vertices[vertex * 8 + 6] = coords[vertex][0];
+			vertices[vertex * 8 + 7] = coords[vertex][1];
+		}
+	}
+} // anonymous namespace
+
+// Callback function definitions
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+
+// Main function
+int main(int argc, char** argv)
+{
+	// Record where the startup time goes (with ENABLE_TIMELINE)
+	TIMELINE_PROGRAM("VirtualTextures");
+	TIMELINE_BEGIN("startup");
+
+	// Bake the image into tiles the first time it is shown
+	TIMELINE_BEGIN("bake");
+	const std::filesystem::path image = (argc > 1) ? std::filesystem::path(argv[1]) : std::filesystem::path("procedural");
+	const auto baked = VirtualTexture::PathFor(image);
+	if (!std::filesystem::exists(baked))
+	{
+		const auto start = Clock::now();
+		bool done { false };
+		if (argc > 1)
+		{
+			// the decoded image has to fit in memory; only the GPU copy is virtual
+			int width, height, channels;
+			unsigned char* data = stbi_load(image.c_str(), &width, &height, &channels, 4);
+			if (data == nullptr)
+			{
+				std::cout << "Failed to load texture " << image << "\n";
+				return EXIT_FAILURE;
+			}
+			std::cout << "Baking " << image << " (" << width << "x" << height << ") into " << baked << "\n";
+			done = VirtualTexture::Bake(baked, width, height, [&](int x, int y, int w, int h, unsigned char* pixels) {
+				for (int row = 0; row < h; row++)
+				{
+					std::copy_n(data + (static_cast<std::size_t>(y + row) * width + x) * 4, static_cast<std::size_t>(w) * 4,
+						pixels + static_cast<std::size_t>(row) * w * 4);
+				}
+			});
+			stbi_image_free(data);
+		}
+		else
+		{
+			std::cout << "Baking a " << ProceduralSize << "x" << ProceduralSize << " procedural image into " << baked << "\n";
+			done = VirtualTexture::Bake(baked, ProceduralSize, ProceduralSize, Procedural);
+		}
+		if (!done)
+		{
+			return EXIT_FAILURE;
+		}
+		const std::chrono::duration<double> elapsed = Clock::now() - start;
+		std::cout << "Baked in " << elapsed.count() << " s, " << std::filesystem::file_size(baked) / (1024 * 1024) << " MB\n";
+	}
+	TIMELINE_END();
+
+	// Initialize glfw and set some variables
+	TIMELINE_BEGIN("glfwInit");
+	glfwInit();
+	TIMELINE_END();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	// Create the window
+	TIMELINE_BEGIN("glfwCreateWindow");
+	GLFWwindow* window = glfwCreateWindow(ScreenWidth, ScreenHeight, "VirtualTextures", nullptr, nullptr);
+	TIMELINE_END();
+	if (window == nullptr)
+	{
+		std::cout << "Failed to create GLFW window\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Set some callback functions
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetKeyCallback(window, key_callback);
+
+	// Make sure GLAD loads
+	TIMELINE_BEGIN("gladLoadGLLoader");
+	const bool loaded = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	TIMELINE_END();
+	if (!loaded)
+	{
+		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+
+	// The same fragment shader as Textures.cpp, sampling the virtual texture or asking for tiles
+	Shader ourShader = Shader::Load("vs/texture.c", "fs/texture.c", { { "VIRTUAL_TEXTURE", "1" } });
+	Shader feedbackShader = Shader::Load("vs/texture.c", "fs/texture.c", { { "VIRTUAL_FEEDBACK", "1" } });
+
+	// The quad from Textures.cpp, stretched over the window
+	float vertices[] = {
+		// positions          // colors           // texture coords
+		 1.0f,  1.0f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // top right
+		 1.0f, -1.0f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // bottom right
+		-1.0f, -1.0f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // bottom left
+		-1.0f,  1.0f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f  // top left
+	};
+	unsigned int indices[] = {
+		0, 1, 3, // first triangle
+		1, 2, 3  // second triangle
+	};
+	unsigned int VBO, VAO, EBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+
+	// Only the coarsest tiles are read now; the rest stream in as they come into view
+	TIMELINE_BEGIN("VirtualTexture");
+	auto virtualTexture = std::make_unique<VirtualTexture>(baked);
+	TIMELINE_END();
+	if (!*virtualTexture)
+	{
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	auto feedback = std::make_unique<VirtualFeedback>(ScreenWidth, ScreenHeight);
+	glfwSetWindowUserPointer(window, feedback.get());
+	feedbackShader.use();
+	virtualTexture->SetUniforms(feedbackShader, 0, 1, feedback->Scale());
+	feedbackShader.setFloat("uniformOffsetX", 0.0f);
+	feedbackShader.setFloat("uniformOffsetY", 0.0f);
+	ourShader.use();
+	virtualTexture->SetUniforms(ourShader, 0, 1);
+	ourShader.setFloat("uniformOffsetX", 0.0f);
+	ourShader.setFloat("uniformOffsetY", 0.0f);
+
+	// Everything before the first frame is startup
+	TIMELINE_END();
+
+	// Render loop
+	auto last = Clock::now();
+	auto reported = last;
+	while (!glfwWindowShouldClose(window))
+	{
+		// Move the view: held keys pan and zoom, or the tour dives in and out
+		const auto now = Clock::now();
+		const double seconds = std::chrono::duration<double>(now - last).count();
+		last = now;
+		const double step = span * seconds;
+		if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS) centreX -= step;
+		if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) centreX += step;
+		if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) centreY -= step;
+		if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) centreY += step;
+		if (glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS) span *= std::exp(-seconds);
+		if (glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS) span *= std::exp(seconds);
+		if (touring)
+		{
+			const double time = glfwGetTime();
+			span = std::exp(-4.5 * (1.0 - std::cos(time * 0.25)));
+			centreX = 0.5 + 0.3 * std::sin(time * 0.05);
+			centreY = 0.5 + 0.3 * std::cos(time * 0.07);
+		}
+		span = std::clamp(span, 1.0 / 4096.0, 1.0);
+		View(vertices);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+
+		// Ask for the tiles this view needs, then copy in whatever has arrived
+		glBindVertexArray(VAO);
+		feedback->Begin();
+		feedbackShader.use();
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		feedback->End(*virtualTexture);
+		virtualTexture->Update();
+
+		// Draw with whatever is resident; missing tiles fall back to coarser ones
+		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		virtualTexture->Bind(0, 1);
+		ourShader.use();
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+
+		// Report once every few seconds
+		if (std::chrono::duration<double>(Clock::now() - reported).count() >= 5.0)
+		{
+			virtualTexture->Print();
+			reported = Clock::now();
+		}
+	}
+
+	// Clean up buffers
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	virtualTexture->Print();
+	feedback.reset();
+	virtualTexture.reset();
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
+
+// Callback function for key press
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS)
+	{
+		return;
+	}
+	switch (key)
+	{
+	// Quit
+	case GLFW_KEY_ESCAPE:
+	case GLFW_KEY_Q:
+		glfwSetWindowShouldClose(window, GL_TRUE);
+		break;
+	// Start or stop the tour
+	case GLFW_KEY_SPACE:
+		touring = !touring;
+		break;
+	// Any other movement key takes over from the tour
+	case GLFW_KEY_LEFT:
+	case GLFW_KEY_RIGHT:
+	case GLFW_KEY_UP:
+	case GLFW_KEY_DOWN:
+	case GLFW_KEY_H:
+	case GLFW_KEY_J:
+	case GLFW_KEY_K:
+	case GLFW_KEY_L:
+	case GLFW_KEY_LEFT_BRACKET:
+	case GLFW_KEY_RIGHT_BRACKET:
+		touring = false;
+		break;
+	default:
+		break;
+	}
+}
+
+// Callback function for window resize; the feedback pass follows the window
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+	glViewport(0, 0, width, height);
+	if (auto* feedback = static_cast<VirtualFeedback*>(glfwGetWindowUserPointer(window)))
+	{
+		feedback->Resize(width, height);
+	}
+}
@@ -0,0 +1,24 @@
+// Shared by every fragment shader that blends the two example textures
+
+uniform sampler2D texture1;
+
+// How much of the second texture to blend in; permutations can override it
+#ifndef MIX_FACTOR
+#define MIX_FACTOR 0.2
+#endif
+
+#ifdef COMPOSITED
+// texture1 already holds the blend, made once by CompositeCache.h
+vec4 mixTextures(vec2 coord)
+{
+	return texture(texture1, coord);
+}
+#else
+uniform sampler2D texture2;
+
+// linearly interpolate between both textures (80% container, 20% awesomeface)
+vec4 mixTextures(vec2 coord)
+{
+	return mix(texture(texture1, coord), texture(texture2, coord), MIX_FACTOR);
+}
+#endif
@@ -0,0 +1,51 @@
+// Virtual texture sampling, for fs/texture.c with VIRTUAL_TEXTURE (see VirtualTexture.h)
+// The page table has one mip level per tile level; every entry holds the cache
+// slot (xy) and level (z) of that tile, or of its nearest resident ancestor
+
+uniform sampler2D pageTable;
+uniform sampler2D physicalTiles;
+uniform vec4 virtualSize;   // xy: tiled size in texels, z: tile size, w: coarsest level
+uniform vec4 physicalSize;  // x: slot size, y: border, zw: 1 / physical texture size
+uniform vec2 virtualScale;  // the part of the tiled area the image covers
+uniform float feedbackBias; // -log2 of how much smaller the feedback pass renders
+
+// The level the screen wants here, as glsl would pick a mip level
+int virtualLevel(vec2 uv)
+{
+	vec2 texels = uv * virtualSize.xy;
+	vec2 dx = dFdx(texels);
+	vec2 dy = dFdy(texels);
+	float rho = max(dot(dx, dx), dot(dy, dy));
+	return int(clamp(0.5 * log2(max(rho, 1e-8)) + feedbackBias, 0.0, virtualSize.w));
+}
+
+// The tile under uv at a level
+ivec2 virtualTile(vec2 uv, int level)
+{
+	ivec2 tiles = ivec2(virtualSize.xy / virtualSize.z) >> level;
+	return clamp(ivec2(uv * vec2(tiles)), ivec2(0), tiles - 1);
+}
+
+vec4 sampleVirtual(vec2 coord)
+{
+	vec2 uv = coord * virtualScale;
+	int level = virtualLevel(uv);
+	vec3 entry = texelFetch(pageTable, virtualTile(uv, level), level).xyz * 255.0;
+
+	// Where uv falls inside the tile that is resident, which may be coarser
+	int resident = int(entry.z + 0.5);
+	vec2 texels = uv * virtualSize.xy / exp2(float(resident));
+	vec2 inTile = clamp(texels - vec2(virtualTile(uv, resident)) * virtualSize.z, vec2(0.0), vec2(virtualSize.z));
+	vec2 physical = floor(entry.xy + 0.5) * physicalSize.x + physicalSize.y + inTile;
+	return textureLod(physicalTiles, physical * physicalSize.zw, 0.0);
+}
+
+// What the feedback pass writes: the wanted tile, x and y in red and green with
+// their high bits in blue, and the level in alpha (a clear to alpha 1 means none)
+vec4 virtualFeedback(vec2 coord)
+{
+	vec2 uv = coord * virtualScale;
+	int level = virtualLevel(uv);
+	ivec2 tile = virtualTile(uv, level);
+	return vec4(float(tile.x & 255), float(tile.y & 255), float((tile.x >> 8) | ((tile.y >> 8) << 4)), float(level)) / 255.0;
+}
@@ -0,0 +1,21 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 ourTextureCoord;
+
+// One texture per material, or one array holding every material as a layer
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray material;
+uniform int layer;
+#else
+uniform sampler2D material;
+#endif
+
+void main()
+{
+#ifdef TEXTURE_ARRAY
+	FragColor = texture(material, vec3(ourTextureCoord, layer));
+#else
+	FragColor = texture(material, ourTextureCoord);
+#endif
+}
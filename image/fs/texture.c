@@ -4,11 +4,20 @@ out vec4 FragColor;
 in vec3 ourColor;
 in vec2 ourTextureCoord;
 
-uniform sampler2D texture1;
-uniform sampler2D texture2;
+// The two example textures, or one virtual texture (VirtualTexture.h)
+#if defined(VIRTUAL_TEXTURE) || defined(VIRTUAL_FEEDBACK)
+#include "common/virtual.c"
+#else
+#include "common/textures.c"
+#endif
 
 void main()
 {
-	// linearly interpolate between both textures (80% container, 20% awesomeface)
-	FragColor = mix(texture(texture1, ourTextureCoord), texture(texture2, ourTextureCoord), 0.2);
+#if defined(VIRTUAL_FEEDBACK)
+	FragColor = virtualFeedback(ourTextureCoord);
+#elif defined(VIRTUAL_TEXTURE)
+	FragColor = sampleVirtual(ourTextureCoord);
+#else
+	FragColor = mixTextures(ourTextureCoord);
+#endif
 }
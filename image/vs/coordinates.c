@@ -1,16 +1,25 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
 layout (location = 1) in vec2 aTexCoord; // the texture coordinates have attribute position 1
+#ifdef INSTANCED
+layout (location = 2) in mat4 aModel; // one model matrix per instance, in attributes 2 to 5
+#endif
 
 out vec2 ourTextureCoord; // output a texture position
 
 // The model, view, and projection
+#ifndef INSTANCED
 uniform mat4 model;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
+#ifdef INSTANCED
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+#else
     gl_Position = projection * view * model * vec4(aPos, 1.0);
+#endif
 	ourTextureCoord = vec2(aTexCoord.x, 1 - aTexCoord.y);
 }
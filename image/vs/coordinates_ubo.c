@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
+layout (location = 1) in vec2 aTexCoord; // the texture coordinates have attribute position 1
+#ifdef INSTANCED
+layout (location = 2) in mat4 aModel; // one model matrix per instance, in attributes 2 to 5
+#endif
+
+out vec2 ourTextureCoord; // output a texture position
+
+// The Frame and Object uniform blocks, generated from FrameBlocks.h
+#include "common/blocks.c"
+
+void main()
+{
+#ifdef INSTANCED
+	gl_Position = frame.viewProjection * aModel * vec4(aPos, 1.0);
+#else
+	gl_Position = frame.viewProjection * object.model * vec4(aPos, 1.0);
+#endif
+	ourTextureCoord = vec2(aTexCoord.x, 1 - aTexCoord.y);
+}
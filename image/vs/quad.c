@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;      // the corner of a unit quad, 0 to 1
+layout (location = 1) in vec2 aTexCoord; // the texture coordinates have attribute position 1
+
+// Where the quad goes: xy is its bottom left corner, zw its size, in clip space
+uniform vec4 quad;
+
+out vec2 ourTextureCoord; // output a texture position
+
+void main()
+{
+    gl_Position = vec4(quad.xy + aPos * quad.zw, 0.0, 1.0);
+	ourTextureCoord = aTexCoord;
+}
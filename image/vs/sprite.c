@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;      // already in clip space
+layout (location = 1) in vec2 aTexCoord; // the texture coordinates have attribute position 1
+
+out vec2 ourTextureCoord; // output a texture position
+
+void main()
+{
+    gl_Position = vec4(aPos, 0.0, 1.0);
+	ourTextureCoord = aTexCoord;
+}
@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;      // already in clip space
+layout (location = 1) in vec3 aNormal;   // the normal variable has attribute position 1
+layout (location = 2) in vec2 aTexCoord; // the texture coordinates have attribute position 2
+layout (location = 3) in vec4 aColor;    // the color variable has attribute position 3
+
+out vec3 ourColor; // output a color to the fragment shader
+
+void main()
+{
+    gl_Position = vec4(aPos, 1.0);
+	// use every attribute, so none of them is optimized away
+	ourColor = aColor.rgb * max(dot(aNormal, vec3(0.0, 0.0, 1.0)), 0.2) + vec3(aTexCoord, 0.0) * 0.1;
+}